@@ -0,0 +1,138 @@
+#include "bench.h"
+#include "browser/assets.cc"
+
+// Image variants need cef_image, requests here have no variant query.
+bool browser::parse_image_query(const std::u16string &path, const std::u16string &query, ImageVariant &variant)
+{
+    return false;
+}
+
+path browser::get_image_variant_path(const path &source, const ImageVariant &variant)
+{
+    return path();
+}
+
+bool browser::create_image_variant(const path &source, const ImageVariant &variant, const path &output)
+{
+    return false;
+}
+
+// Batches make upstream requests, they're not served here.
+cef_resource_handler_t *browser::create_batch_handler(cef_frame_t *frame)
+{
+    return nullptr;
+}
+
+// Serve a request through AssetsResourceHandler like the network stack does.
+static int64 serve(const char *url, cef_resource_type_t type, const char *range = nullptr)
+{
+    static char buffer[32 * 1024];
+
+    auto handler = new AssetsResourceHandler();
+    auto request = bench::create_request(url, type, range);
+    auto response = bench::create_response(url);
+
+    int handle_request = 0;
+    handler->open(handler, request, &handle_request, nullptr);
+
+    int64 length = 0;
+    handler->get_response_headers(handler, response, &length, nullptr);
+
+    int64 total = 0;
+    int bytes_read = 0;
+    while (handler->read(handler, buffer, sizeof(buffer), &bytes_read, nullptr))
+        total += bytes_read;
+
+    bench::release(response);
+    bench::release(request);
+    bench::release(handler);
+
+    return total;
+}
+
+static void BM_Assets_Script(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(serve("https://plugins/bench-plugin/index.js", RT_SCRIPT));
+}
+BENCHMARK(BM_Assets_Script);
+
+static void BM_Assets_ScriptNoExtension(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(serve("https://plugins/bench-plugin", RT_SCRIPT));
+}
+BENCHMARK(BM_Assets_ScriptNoExtension);
+
+static void BM_Assets_ImportCss(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(serve("https://plugins/bench-plugin/theme.css", RT_SCRIPT));
+}
+BENCHMARK(BM_Assets_ImportCss);
+
+static void BM_Assets_Image(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(serve("https://plugins/bench-plugin/assets/background.png", RT_IMAGE));
+    state.SetBytesProcessed(state.iterations() * 512 * 1024);
+}
+BENCHMARK(BM_Assets_Image);
+
+static void BM_Assets_ImageRange(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(serve("https://plugins/bench-plugin/assets/background.png", RT_IMAGE, "bytes=262144-"));
+}
+BENCHMARK(BM_Assets_ImageRange);
+
+// Identical files, the bench-plugin copy redirects to the @bench one which sorts first.
+static void BM_Assets_DuplicateImage(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(serve("https://plugins/bench-plugin/assets/background.png", RT_IMAGE)
+            + serve("https://plugins/@bench/grouped/background.png", RT_IMAGE));
+}
+BENCHMARK(BM_Assets_DuplicateImage);
+
+static void BM_Assets_NotFound(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(serve("https://plugins/missing-plugin/index.js", RT_SCRIPT));
+}
+BENCHMARK(BM_Assets_NotFound);
+
+// Versions of an import cycle requested from two roots, cleared each time.
+// They must not depend on the root, or a module is instantiated twice.
+static void BM_Modules_CycleRoots(benchmark::State &state)
+{
+    auto dir = bench::fixture_dir() / "plugins" / "bench-plugin";
+
+    auto build = [&](const char *root, uint64_t &a, uint64_t &b, std::string &code_b)
+    {
+        browser::invalidate_modules({ dir });
+
+        std::shared_ptr<const std::string> code;
+        uint64_t version;
+        browser::get_versioned_module(dir / root, code, version);
+
+        browser::get_versioned_module(dir / "cycle-a.js", code, a);
+        browser::get_versioned_module(dir / "cycle-b.js", code, b);
+        code_b = *code;
+    };
+
+    for (auto _ : state)
+    {
+        uint64_t a1, b1, a2, b2;
+        std::string code1, code2;
+        build("cycle-c.js", a1, b1, code1);
+        build("cycle-b.js", a2, b2, code2);
+
+        if (a1 != a2 || b1 != b2 || a1 != b1 || code1 != code2)
+        {
+            state.SkipWithError("cycle versions depend on the root");
+            break;
+        }
+    }
+}
+BENCHMARK(BM_Modules_CycleRoots);
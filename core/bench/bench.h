@@ -0,0 +1,50 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "pengu.h"
+#include "include/capi/cef_request_capi.h"
+#include "include/capi/cef_response_capi.h"
+#include <benchmark/benchmark.h>
+
+///
+/// Linux-hosted benchmarks for the core hot paths.
+/// 
+/// The core sources are compiled against `cef_stubs.cc` instead of libcef,
+/// the stubs only implement the CAPI symbols that the measured code touches.
+/// Suites include the translation unit under test directly,
+/// so static helpers can be measured without exporting them.
+/// 
+
+namespace bench
+{
+    ///
+    /// Get the fixture dir, it's also the loader dir of the bench binary.
+    /// Contains `config`, `datastore` and a `plugins` folder with sample files.
+    /// 
+    path fixture_dir();
+
+    ///
+    /// Create a stub request.
+    /// @param url Request URL.
+    /// @param type Resource type, e.g `RT_SCRIPT` for module imports.
+    /// @param range Optional `Range` header value.
+    /// 
+    cef_request_t *create_request(const char *url, cef_resource_type_t type, const char *range = nullptr);
+
+    ///
+    /// Create a stub response.
+    /// @param url Response URL.
+    /// 
+    cef_response_t *create_response(const char *url);
+
+    ///
+    /// Release a CAPI object.
+    /// 
+    template <typename T>
+    inline void release(T *object)
+    {
+        object->base.release(&object->base);
+    }
+}
+
+#endif
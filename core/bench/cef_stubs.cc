@@ -0,0 +1,550 @@
+#include "bench.h"
+#include <algorithm>
+#include <map>
+#include "include/capi/cef_parser_capi.h"
+#include "include/capi/cef_stream_capi.h"
+#include "include/capi/cef_task_capi.h"
+#include "include/capi/cef_v8_capi.h"
+
+// BENCHMARK HOST ONLY.
+// Minimal implementations of the CEF CAPI symbols used by the core,
+// just enough to drive the hot paths without libcef.
+
+// strings
+
+static void string_free_utf16(char16 *str)
+{
+    delete[] str;
+}
+
+static void string_free_utf8(char *str)
+{
+    delete[] str;
+}
+
+extern "C" int cef_string_utf16_set(const char16 *src, size_t src_len, cef_string_utf16_t *output, int copy)
+{
+    cef_string_utf16_clear(output);
+
+    if (copy)
+    {
+        output->str = new char16[src_len + 1];
+        memcpy(output->str, src, src_len * sizeof(char16));
+        output->str[src_len] = 0;
+        output->dtor = string_free_utf16;
+    }
+    else
+    {
+        output->str = const_cast<char16 *>(src);
+        output->dtor = nullptr;
+    }
+
+    output->length = src_len;
+    return 1;
+}
+
+extern "C" int cef_string_utf8_set(const char *src, size_t src_len, cef_string_utf8_t *output, int copy)
+{
+    cef_string_utf8_clear(output);
+
+    if (copy)
+    {
+        output->str = new char[src_len + 1];
+        memcpy(output->str, src, src_len);
+        output->str[src_len] = 0;
+        output->dtor = string_free_utf8;
+    }
+    else
+    {
+        output->str = const_cast<char *>(src);
+        output->dtor = nullptr;
+    }
+
+    output->length = src_len;
+    return 1;
+}
+
+extern "C" void cef_string_utf16_clear(cef_string_utf16_t *str)
+{
+    if (str->dtor != nullptr && str->str != nullptr)
+        str->dtor(str->str);
+
+    str->str = nullptr;
+    str->length = 0;
+    str->dtor = nullptr;
+}
+
+extern "C" void cef_string_utf8_clear(cef_string_utf8_t *str)
+{
+    if (str->dtor != nullptr && str->str != nullptr)
+        str->dtor(str->str);
+
+    str->str = nullptr;
+    str->length = 0;
+    str->dtor = nullptr;
+}
+
+extern "C" int cef_string_utf8_to_utf16(const char *src, size_t src_len, cef_string_utf16_t *output)
+{
+    std::u16string out;
+    out.reserve(src_len);
+
+    auto in = reinterpret_cast<const uint8_t *>(src);
+    for (size_t i = 0; i < src_len;)
+    {
+        uint32_t cp = in[i];
+        size_t extra = cp < 0x80 ? 0 : cp < 0xE0 ? 1 : cp < 0xF0 ? 2 : 3;
+
+        if (extra > 0)
+        {
+            cp &= 0x3F >> extra;
+            for (size_t j = 1; j <= extra && i + j < src_len; j++)
+                cp = (cp << 6) | (in[i + j] & 0x3F);
+        }
+
+        if (cp >= 0x10000)
+        {
+            cp -= 0x10000;
+            out.push_back(char16_t(0xD800 | (cp >> 10)));
+            out.push_back(char16_t(0xDC00 | (cp & 0x3FF)));
+        }
+        else
+        {
+            out.push_back(char16_t(cp));
+        }
+
+        i += extra + 1;
+    }
+
+    return cef_string_utf16_set((const char16 *)out.data(), out.length(), output, 1);
+}
+
+extern "C" int cef_string_utf16_to_utf8(const char16 *src, size_t src_len, cef_string_utf8_t *output)
+{
+    std::string out;
+    out.reserve(src_len);
+
+    for (size_t i = 0; i < src_len; i++)
+    {
+        uint32_t cp = src[i];
+
+        if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < src_len)
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (src[++i] - 0xDC00);
+
+        if (cp < 0x80)
+            out.push_back(char(cp));
+        else if (cp < 0x800)
+        {
+            out.push_back(char(0xC0 | (cp >> 6)));
+            out.push_back(char(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            out.push_back(char(0xE0 | (cp >> 12)));
+            out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(char(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out.push_back(char(0xF0 | (cp >> 18)));
+            out.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(char(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    return cef_string_utf8_set(out.data(), out.length(), output, 1);
+}
+
+extern "C" int cef_string_ascii_to_utf16(const char *src, size_t src_len, cef_string_utf16_t *output)
+{
+    return cef_string_utf8_to_utf16(src, src_len, output);
+}
+
+extern "C" cef_string_userfree_utf16_t cef_string_userfree_utf16_alloc()
+{
+    return new cef_string_utf16_t{};
+}
+
+extern "C" void cef_string_userfree_utf16_free(cef_string_userfree_utf16_t str)
+{
+    cef_string_utf16_clear(str);
+    delete str;
+}
+
+static cef_string_userfree_t userfree_from_utf8(const std::string &s)
+{
+    auto uf = cef_string_userfree_utf16_alloc();
+    cef_string_utf8_to_utf16(s.data(), s.length(), uf);
+    return uf;
+}
+
+// parser
+
+extern "C" cef_string_userfree_t cef_get_mime_type(const cef_string_t *extension)
+{
+    static const std::map<std::string, std::string> types
+    {
+        { "js", "text/javascript" },
+        { "css", "text/css" },
+        { "json", "application/json" },
+        { "html", "text/html" },
+        { "png", "image/png" },
+        { "jpg", "image/jpeg" },
+        { "jpeg", "image/jpeg" },
+        { "webp", "image/webp" },
+        { "svg", "image/svg+xml" },
+        { "woff2", "font/woff2" },
+        { "mp3", "audio/mpeg" },
+        { "webm", "video/webm" },
+    };
+
+    auto it = types.find(CefStr::borrow(extension).to_utf8());
+    return it != types.end() ? userfree_from_utf8(it->second) : nullptr;
+}
+
+extern "C" cef_string_userfree_t cef_uridecode(const cef_string_t *text,
+    int convert_to_utf8, cef_uri_unescape_rule_t unescape_rule)
+{
+    std::string in = CefStr::borrow(text).to_utf8(), out;
+    out.reserve(in.length());
+
+    for (size_t i = 0; i < in.length(); i++)
+    {
+        if (in[i] == '%' && i + 2 < in.length() && isxdigit(in[i + 1]) && isxdigit(in[i + 2]))
+        {
+            out.push_back((char)strtol(in.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        }
+        else
+        {
+            out.push_back(in[i]);
+        }
+    }
+
+    return userfree_from_utf8(out);
+}
+
+extern "C" cef_string_userfree_t cef_base64encode(const void *data, size_t data_size)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    auto in = static_cast<const uint8_t *>(data);
+    std::string out;
+
+    for (size_t i = 0; i < data_size; i += 3)
+    {
+        uint32_t n = in[i] << 16;
+        if (i + 1 < data_size) n |= in[i + 1] << 8;
+        if (i + 2 < data_size) n |= in[i + 2];
+
+        out.push_back(table[(n >> 18) & 63]);
+        out.push_back(table[(n >> 12) & 63]);
+        out.push_back(i + 1 < data_size ? table[(n >> 6) & 63] : '=');
+        out.push_back(i + 2 < data_size ? table[n & 63] : '=');
+    }
+
+    return userfree_from_utf8(out);
+}
+
+// streams
+
+struct StubStreamReader : CefRefCount<cef_stream_reader_t>
+{
+    StubStreamReader(FILE *fp, const void *data, size_t size)
+        : CefRefCount(this), fp_(fp), data_((const uint8_t *)data), size_(size), pos_(0)
+    {
+        cef_bind_method(StubStreamReader, read);
+        cef_bind_method(StubStreamReader, seek);
+        cef_bind_method(StubStreamReader, tell);
+        cef_bind_method(StubStreamReader, eof);
+        cef_bind_method(StubStreamReader, may_block);
+    }
+
+    ~StubStreamReader()
+    {
+        if (fp_ != nullptr)
+            fclose(fp_);
+    }
+
+private:
+    FILE *fp_;
+    const uint8_t *data_;
+    size_t size_;
+    size_t pos_;
+
+    size_t _read(void *ptr, size_t size, size_t n)
+    {
+        if (fp_ != nullptr)
+            return fread(ptr, size, n, fp_);
+
+        size_t count = std::min(n, (size_ - pos_) / size);
+        memcpy(ptr, data_ + pos_, count * size);
+        pos_ += count * size;
+        return count;
+    }
+
+    int _seek(int64 offset, int whence)
+    {
+        if (fp_ != nullptr)
+            return fseeko(fp_, offset, whence);
+
+        int64 base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (int64)pos_ : (int64)size_;
+        pos_ = (size_t)std::clamp<int64>(base + offset, 0, (int64)size_);
+        return 0;
+    }
+
+    int64 _tell()
+    {
+        return fp_ != nullptr ? (int64)ftello(fp_) : (int64)pos_;
+    }
+
+    int _eof()
+    {
+        return fp_ != nullptr ? feof(fp_) : pos_ >= size_;
+    }
+
+    int _may_block()
+    {
+        return fp_ != nullptr;
+    }
+};
+
+extern "C" cef_stream_reader_t *cef_stream_reader_create_for_file(const cef_string_t *fileName)
+{
+    FILE *fp = fopen(CefStr::borrow(fileName).to_utf8().c_str(), "rb");
+    return fp != nullptr ? new StubStreamReader(fp, nullptr, 0) : nullptr;
+}
+
+extern "C" cef_stream_reader_t *cef_stream_reader_create_for_data(void *data, size_t size)
+{
+    return new StubStreamReader(nullptr, data, size);
+}
+
+// requests & responses
+
+struct StubRequest : CefRefCount<cef_request_t>
+{
+    StubRequest(const char *url, cef_resource_type_t type, const char *range)
+        : CefRefCount(this), url_(url), type_(type), range_(range ? range : "")
+    {
+        cef_bind_method(StubRequest, get_url);
+        cef_bind_method(StubRequest, get_method);
+        cef_bind_method(StubRequest, get_header_by_name);
+        cef_bind_method(StubRequest, get_resource_type);
+    }
+
+private:
+    std::string url_;
+    cef_resource_type_t type_;
+    std::string range_;
+
+    cef_string_userfree_t _get_url()
+    {
+        return userfree_from_utf8(url_);
+    }
+
+    cef_string_userfree_t _get_method()
+    {
+        return userfree_from_utf8("GET");
+    }
+
+    cef_string_userfree_t _get_header_by_name(const cef_string_t *name)
+    {
+        if (CefStr::borrow(name).equal("Range") && !range_.empty())
+            return userfree_from_utf8(range_);
+        return nullptr;
+    }
+
+    cef_resource_type_t _get_resource_type()
+    {
+        return type_;
+    }
+};
+
+struct StubResponse : CefRefCount<cef_response_t>
+{
+    StubResponse(const char *url) : CefRefCount(this), url_(url), status_(0), error_(ERR_NONE)
+    {
+        cef_bind_method(StubResponse, get_status);
+        cef_bind_method(StubResponse, set_status);
+        cef_bind_method(StubResponse, get_error);
+        cef_bind_method(StubResponse, set_error);
+        cef_bind_method(StubResponse, set_status_text);
+        cef_bind_method(StubResponse, set_mime_type);
+        cef_bind_method(StubResponse, set_header_by_name);
+        cef_bind_method(StubResponse, get_url);
+    }
+
+private:
+    std::string url_;
+    int status_;
+    cef_errorcode_t error_;
+    std::u16string mime_;
+    std::vector<std::pair<std::u16string, std::u16string>> headers_;
+
+    int _get_status() { return status_; }
+    void _set_status(int status) { status_ = status; }
+    cef_errorcode_t _get_error() { return error_; }
+    void _set_error(cef_errorcode_t error) { error_ = error; }
+    void _set_status_text(const cef_string_t *text) {}
+
+    void _set_mime_type(const cef_string_t *mime)
+    {
+        CefStr::borrow(mime).copy(mime_);
+    }
+
+    void _set_header_by_name(const cef_string_t *name, const cef_string_t *value, int overwrite)
+    {
+        headers_.emplace_back(CefStr::borrow(name).to_utf16(), CefStr::borrow(value).to_utf16());
+    }
+
+    cef_string_userfree_t _get_url()
+    {
+        return userfree_from_utf8(url_);
+    }
+};
+
+cef_request_t *bench::create_request(const char *url, cef_resource_type_t type, const char *range)
+{
+    return new StubRequest(url, type, range);
+}
+
+cef_response_t *bench::create_response(const char *url)
+{
+    return new StubResponse(url);
+}
+
+// v8 values, only carry strings to feed native handlers
+
+struct StubV8Value : CefRefCount<cef_v8value_t>
+{
+    StubV8Value(const cef_string_t *value) : CefRefCount(this)
+    {
+        if (value != nullptr)
+            CefStr::borrow(value).copy(value_);
+
+        cef_bind_method(StubV8Value, is_string);
+        cef_bind_method(StubV8Value, get_string_value);
+        cef_bind_method(StubV8Value, set_value_bykey);
+        cef_bind_method(StubV8Value, set_value_byindex);
+    }
+
+private:
+    std::u16string value_;
+
+    int _is_string() { return 1; }
+
+    cef_string_userfree_t _get_string_value()
+    {
+        auto uf = cef_string_userfree_utf16_alloc();
+        cef_string_utf16_set((const char16 *)value_.data(), value_.length(), uf, 1);
+        return uf;
+    }
+
+    int _set_value_bykey(const cef_string_t *key, cef_v8value_t *value, cef_v8_propertyattribute_t attr)
+    {
+        return 1;
+    }
+
+    int _set_value_byindex(int index, cef_v8value_t *value)
+    {
+        return 1;
+    }
+};
+
+extern "C" cef_v8value_t *cef_v8value_create_undefined() { return new StubV8Value(nullptr); }
+extern "C" cef_v8value_t *cef_v8value_create_null() { return new StubV8Value(nullptr); }
+extern "C" cef_v8value_t *cef_v8value_create_bool(int value) { return new StubV8Value(nullptr); }
+extern "C" cef_v8value_t *cef_v8value_create_int(int32 value) { return new StubV8Value(nullptr); }
+extern "C" cef_v8value_t *cef_v8value_create_double(double value) { return new StubV8Value(nullptr); }
+extern "C" cef_v8value_t *cef_v8value_create_string(const cef_string_t *value) { return new StubV8Value(value); }
+extern "C" cef_v8value_t *cef_v8value_create_array(int length) { return new StubV8Value(nullptr); }
+extern "C" cef_v8value_t *cef_v8value_create_object(cef_v8accessor_t *, cef_v8interceptor_t *) { return new StubV8Value(nullptr); }
+extern "C" cef_v8value_t *cef_v8value_create_function(const cef_string_t *name, cef_v8handler_t *handler) { return new StubV8Value(name); }
+
+// Native functions are called outside of any context.
+extern "C" cef_v8context_t *cef_v8context_get_current_context() { return nullptr; }
+
+// parser, fixture plugins have no manifest
+
+extern "C" cef_value_t *cef_parse_json(const cef_string_t *json_string, cef_json_parser_options_t options)
+{
+    return nullptr;
+}
+
+// tasks, there are no CEF message loops so they run inline
+
+extern "C" int cef_post_task(cef_thread_id_t threadId, cef_task_t *task)
+{
+    task->execute(task);
+    task->base.release(&task->base);
+    return 1;
+}
+
+extern "C" int cef_post_delayed_task(cef_thread_id_t threadId, cef_task_t *task, int64 delay_ms)
+{
+    return cef_post_task(threadId, task);
+}
+
+// platform
+
+namespace platform
+{
+    const char *get_os_version()
+    {
+        return "0.0.0";
+    }
+
+    const char *get_os_build()
+    {
+        return "0";
+    }
+}
+
+// fixture
+
+path bench::fixture_dir()
+{
+    return config::loader_dir();
+}
+
+static struct Fixture
+{
+    Fixture()
+    {
+        auto dir = bench::fixture_dir();
+        auto plugins = dir / "plugins";
+        std::filesystem::create_directories(plugins / "bench-plugin" / "assets");
+        std::filesystem::create_directories(plugins / "@bench" / "grouped");
+
+        std::string config;
+        for (int i = 0; i < 16; i++)
+            config += "; padding line " + std::to_string(i) + "\n";
+        config += "use_hotkeys=true\noptimized_client=true\nsuper_potato=false\n";
+        config += "silent_mode=false\nuse_devtools=true\ndebug_port=0\n";
+        file::write_file(dir / "config", config.data(), config.length());
+
+        std::string script = "import './lib.js';\nexport function init() {}\n";
+        file::write_file(plugins / "bench-plugin" / "index.js", script.data(), script.length());
+        file::write_file(plugins / "bench-plugin" / "lib.js", script.data(), script.length());
+        file::write_file(plugins / "@bench" / "grouped" / "index.js", script.data(), script.length());
+
+        // An import cycle reached from another module.
+        std::string cycle_c = "import { a } from './cycle-a.js';\nexport const c = a;\n";
+        std::string cycle_a = "import { b } from './cycle-b.js';\nexport let a = 1;\n";
+        std::string cycle_b = "import { a } from './cycle-a.js';\nexport let b = 2;\n";
+        file::write_file(plugins / "bench-plugin" / "cycle-c.js", cycle_c.data(), cycle_c.length());
+        file::write_file(plugins / "bench-plugin" / "cycle-a.js", cycle_a.data(), cycle_a.length());
+        file::write_file(plugins / "bench-plugin" / "cycle-b.js", cycle_b.data(), cycle_b.length());
+
+        std::string css(16 * 1024, ' ');
+        file::write_file(plugins / "bench-plugin" / "theme.css", css.data(), css.length());
+
+        std::string image(512 * 1024, '\x7f');
+        file::write_file(plugins / "bench-plugin" / "assets" / "background.png", image.data(), image.length());
+        file::write_file(plugins / "@bench" / "grouped" / "background.png", image.data(), image.length());
+
+        std::string datastore = "{\"key\":\"" + std::string(64 * 1024, 'x') + "\"}";
+        file::write_file(config::datastore_path(), datastore.data(), datastore.length());
+    }
+} fixture_;
@@ -0,0 +1,67 @@
+#include "bench.h"
+
+// CefStrBase helpers are called on every hooked URL and process message.
+
+static const char16_t BOOTSTRAP_URL[] = u"https://riot:51234/bootstrap.html";
+static const char16_t INDEX_URL[] = u"https://riot:51234/index.html#/home/overview/lol-profiles";
+
+static void BM_CefStr_Equal(benchmark::State &state)
+{
+    auto name = u"@set-window-vibrancy"_s;
+    auto &str = CefStr::borrow(&name);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(str.equal("@set-window-vibrancy"));
+}
+BENCHMARK(BM_CefStr_Equal);
+
+static void BM_CefStr_StartEnd(benchmark::State &state)
+{
+    cef_string_t url{ (char16 *)BOOTSTRAP_URL, COUNT_OF(BOOTSTRAP_URL) - 1, nullptr };
+    auto &str = CefStr::borrow(&url);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(str.startw("https://riot:") && str.endw("/bootstrap.html"));
+}
+BENCHMARK(BM_CefStr_StartEnd);
+
+static void BM_CefStr_Contain(benchmark::State &state)
+{
+    cef_string_t url{ (char16 *)INDEX_URL, COUNT_OF(INDEX_URL) - 1, nullptr };
+    auto &str = CefStr::borrow(&url);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(str.contain("lol-profiles"));
+}
+BENCHMARK(BM_CefStr_Contain);
+
+static void BM_CefStr_ToUtf8(benchmark::State &state)
+{
+    std::u16string text(state.range(0), u'a');
+    auto wrapped = CefStr::wrap(text);
+    auto &str = CefStr::borrow(&wrapped);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(str.to_utf8());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CefStr_ToUtf8)->Range(64, 64 << 10);
+
+static void BM_CefStr_FromUtf8(benchmark::State &state)
+{
+    std::string text(state.range(0), 'a');
+    for (auto _ : state)
+    {
+        CefStr str(text);
+        benchmark::DoNotOptimize(str.str);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CefStr_FromUtf8)->Range(64, 64 << 10);
+
+static void BM_CefStr_FromPath(benchmark::State &state)
+{
+    path file = bench::fixture_dir() / "plugins" / "bench-plugin" / "index.js";
+    for (auto _ : state)
+    {
+        auto str = CefStr::from_path(file);
+        benchmark::DoNotOptimize(str.str);
+    }
+}
+BENCHMARK(BM_CefStr_FromPath);
@@ -0,0 +1,25 @@
+#include "bench.h"
+#include "config.cc"
+
+// Every config getter walks through get_config_map().
+
+static void BM_Config_GetMap(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(get_config_map());
+}
+BENCHMARK(BM_Config_GetMap);
+
+static void BM_Config_OptionBool(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(config::options::use_hotkeys());
+}
+BENCHMARK(BM_Config_OptionBool);
+
+static void BM_Config_PluginsDir(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(config::plugins_dir());
+}
+BENCHMARK(BM_Config_PluginsDir);
@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "renderer/v8_datastore.cc"
+
+// DataStore is loaded and saved as a whole on every change.
+
+static void BM_DataStore_Transform(benchmark::State &state)
+{
+    std::vector<uint8_t> data(state.range(0), 'x');
+    for (auto _ : state)
+    {
+        transform_data(data.data(), data.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DataStore_Transform)->Range(1 << 10, 1 << 20);
+
+static void BM_DataStore_Load(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        cef_string_t json{};
+        load_datastore(&json);
+        benchmark::DoNotOptimize(json.str);
+        cef_string_clear(&json);
+    }
+}
+BENCHMARK(BM_DataStore_Load);
+
+static void BM_DataStore_Write(benchmark::State &state)
+{
+    std::string content = "{\"key\":\"" + std::string(state.range(0), 'x') + "\"}";
+    for (auto _ : state)
+    {
+        std::string json = content;
+        write_datastore(json);
+    }
+}
+BENCHMARK(BM_DataStore_Write)->Range(1 << 10, 1 << 20);
+
+// Cost left on the renderer thread, the write happens on the pool.
+static void BM_DataStore_Save(benchmark::State &state)
+{
+    std::string content = "{\"key\":\"" + std::string(state.range(0), 'x') + "\"}";
+    for (auto _ : state)
+    {
+        cef_string_utf8_t json{};
+        cef_string_utf8_set(content.data(), content.length(), &json, 1);
+        save_datastore(&json);
+        cef_string_utf8_clear(&json);
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+}
+BENCHMARK(BM_DataStore_Save)->Range(1 << 10, 1 << 20);
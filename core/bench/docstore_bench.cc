@@ -0,0 +1,98 @@
+#include "bench.h"
+#include "renderer/v8_docstore.cc"
+
+// Plugins cache match history in document stores, queried by indexed fields.
+
+static std::string make_match(int i)
+{
+    static const char *CHAMPIONS[] = { "Ahri", "Jinx", "Lux", "Yasuo", "Zed", "Teemo", "Sona", "Garen" };
+
+    std::string doc = "{\"gameId\":" + std::to_string(1000000 + i);
+    doc.append(",\"champion\":\"").append(CHAMPIONS[i % 8]).append("\"");
+    doc.append(",\"stats\":{\"kills\":").append(std::to_string(i % 17));
+    doc.append(",\"deaths\":").append(std::to_string(i % 9)).append("}");
+    doc.append(",\"items\":[3089,3020,3157,3135,3165,3116],\"note\":\"").append(std::string(200, 'x')).append("\"}");
+    return doc;
+}
+
+static path fill_store(int count)
+{
+    auto file = bench::fixture_dir() / "docstore" / ("bench-" + std::to_string(count) + ".log");
+    std::error_code ec;
+    std::filesystem::remove(file, ec);
+
+    DocStore store;
+    store.open(file);
+    store.create_index("champion");
+    store.create_index("stats.kills");
+
+    for (int i = 0; i < count; i++)
+        store.put("match/" + std::to_string(i), make_match(i));
+
+    return file;
+}
+
+static void BM_DocStore_Put(benchmark::State &state)
+{
+    auto file = fill_store(0);
+    DocStore store;
+    store.open(file);
+
+    auto doc = make_match(1);
+    int i = 0;
+
+    for (auto _ : state)
+        store.put("match/" + std::to_string(i++ % 10000), doc);
+}
+BENCHMARK(BM_DocStore_Put);
+
+static void BM_DocStore_Get(benchmark::State &state)
+{
+    DocStore store;
+    store.open(fill_store(10000));
+
+    std::string doc;
+    int i = 0;
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(store.get("match/" + std::to_string(i++ * 7919 % 10000), doc));
+}
+BENCHMARK(BM_DocStore_Get);
+
+// Replays the log, the whole dataset stays on disk.
+static void BM_DocStore_Open(benchmark::State &state)
+{
+    auto file = fill_store((int)state.range(0));
+
+    for (auto _ : state)
+    {
+        DocStore store;
+        benchmark::DoNotOptimize(store.open(file));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DocStore_Open)->Arg(1000)->Arg(20000);
+
+// A page of 100 documents of one champion.
+static void BM_DocStore_IndexScan(benchmark::State &state)
+{
+    DocStore store;
+    store.open(fill_store(20000));
+
+    ScanRange range;
+    range.has_lower = range.has_upper = true;
+    range.lower = range.upper = IndexValue{ true, 0, "Lux" };
+
+    std::string doc;
+    for (auto _ : state)
+    {
+        size_t bytes = 0;
+        store.scan("champion", range, [&](const IndexEntry &entry)
+        {
+            store.get(entry.second, doc);
+            bytes += doc.length();
+        });
+        benchmark::DoNotOptimize(bytes);
+    }
+}
+BENCHMARK(BM_DocStore_IndexScan);
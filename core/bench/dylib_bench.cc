@@ -0,0 +1,46 @@
+#include "bench.h"
+#include "utils/dylib.cc"
+#include <random>
+
+// Pattern scanning runs over the whole libcef image at startup.
+
+static std::vector<uint8_t> make_image(size_t size)
+{
+    std::vector<uint8_t> image(size);
+    std::mt19937 rng(1234);
+    for (auto &byte : image)
+        byte = static_cast<uint8_t>(rng());
+    return image;
+}
+
+static void BM_Dylib_ScanPattern(benchmark::State &state)
+{
+    auto image = make_image(state.range(0));
+    bool wildcard;
+    auto pattern = pattern_to_bytes("55 48 89 E5 83 FA 01 74 ?? 83 FA 02 75 ??", &wildcard);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(scan_memory_pattern(image.data(), image.size(), pattern));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Dylib_ScanPattern)->Range(1 << 20, 64 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_Dylib_ScanBytes(benchmark::State &state)
+{
+    auto image = make_image(state.range(0));
+    bool wildcard;
+    auto pattern = pattern_to_bytes("41 83 F8 01 74 0B 41 83 F8 02 75 0A 45 31 C0", &wildcard);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(scan_memory_bytes(image.data(), image.size(), pattern));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Dylib_ScanBytes)->Range(1 << 20, 64 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_Dylib_FindMemory(benchmark::State &state)
+{
+    // Scan the text range of this binary, the pattern is never found.
+    for (auto _ : state)
+        benchmark::DoNotOptimize(dylib::find_memory((const void *)&make_image, "DE AD ?? EF 13 37 ?? 00 FF"));
+}
+BENCHMARK(BM_Dylib_FindMemory)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,53 @@
+#include "bench.h"
+#include "renderer/renderer.cc"
+
+// Helpers open windows and folders, they're not part of the benchmarks.
+V8HandlerFunctionEntry v8_HelperEntries[]
+{
+    { nullptr },
+};
+
+V8HandlerFunctionEntry v8_RecorderEntries[]
+{
+    { nullptr },
+};
+
+// Theme styles read plugin folders.
+void InjectPluginStyles(cef_frame_t *frame, const std::vector<path> &entries)
+{
+}
+
+void InjectSuperPotatoStyles(cef_frame_t *frame)
+{
+}
+
+static V8Value *v8_noop(V8Value *const *args, int argc)
+{
+    return nullptr;
+}
+
+static void BM_NativeV8Handler_Execute(benchmark::State &state)
+{
+    auto handler = new NativeV8Handler();
+    for (int i = 0; i < state.range(0); i++)
+        handler->map_["Function" + std::to_string(i)] = v8_noop;
+    handler->map_["SetWindowVibrancy"] = v8_noop;
+
+    auto name = u"SetWindowVibrancy"_s;
+    for (auto _ : state)
+    {
+        cef_v8value_t *retval = nullptr;
+        cef_string_t exception{};
+        benchmark::DoNotOptimize(handler->execute(handler, &name, nullptr, 0, nullptr, &retval, &exception));
+    }
+
+    bench::release(handler);
+}
+BENCHMARK(BM_NativeV8Handler_Execute)->Arg(8)->Arg(64);
+
+static void BM_Renderer_PluginEntries(benchmark::State &state)
+{
+    for (auto _ : state)
+        benchmark::DoNotOptimize(plugin::get_entries());
+}
+BENCHMARK(BM_Renderer_PluginEntries);
@@ -0,0 +1,51 @@
+#include "bench.h"
+#include "renderer/v8_search.cc"
+
+// CommandBar queries run on every keystroke, over actions registered by plugins.
+
+static const char *CHAMPIONS[] = {
+    "Ahri", "Akali", "Ashe", "Brand", "Caitlyn", "Darius", "Ezreal", "Garen",
+    "Jinx", "Lux", "Miss Fortune", "Nami", "Sona", "Teemo", "Yasuo", "Zed",
+};
+
+static const char *SKINS[] = {
+    "Star Guardian", "Arcade", "Spirit Blossom", "Project", "High Noon",
+    "Pool Party", "Blood Moon", "Coven", "Battle Academia", "Odyssey",
+};
+
+static void fill_index(SearchIndex &index, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        std::string text = SKINS[i % 10];
+        text.append(" ").append(CHAMPIONS[(i / 10) % 16]);
+        text.append(" ").append(std::to_string(i / 160));
+        text.append("\nskin chroma\nskins");
+        index.set(i, std::move(text));
+    }
+}
+
+static void BM_Search_Build(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        SearchIndex index;
+        fill_index(index, (int)state.range(0));
+        benchmark::DoNotOptimize(index);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Search_Build)->Arg(1000)->Arg(20000);
+
+static void BM_Search_Query(benchmark::State &state, const char *query)
+{
+    SearchIndex index;
+    fill_index(index, (int)state.range(0));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(index.query(query, 100));
+}
+BENCHMARK_CAPTURE(BM_Search_Query, word, "ahri")->Arg(1000)->Arg(20000);
+BENCHMARK_CAPTURE(BM_Search_Query, words, "star guardian lux")->Arg(1000)->Arg(20000);
+BENCHMARK_CAPTURE(BM_Search_Query, fuzzy, "sgahri")->Arg(1000)->Arg(20000);
+BENCHMARK_CAPTURE(BM_Search_Query, typo, "guradian")->Arg(1000)->Arg(20000);
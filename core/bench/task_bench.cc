@@ -0,0 +1,32 @@
+#include "bench.h"
+#include <condition_variable>
+#include <mutex>
+
+// Fan-out of small tasks, then wait for all of them.
+
+static void BM_Task_FanOut(benchmark::State &state)
+{
+    const int count = (int)state.range(0);
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    for (auto _ : state)
+    {
+        int remaining = count;
+        for (int i = 0; i < count; i++)
+        {
+            task::run([&] {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--remaining == 0)
+                    cv.notify_one();
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return remaining == 0; });
+    }
+
+    state.SetItemsProcessed(state.iterations() * count);
+    state.counters["workers"] = (double)task::worker_count();
+}
+BENCHMARK(BM_Task_FanOut)->Range(1, 1 << 12)->UseRealTime();
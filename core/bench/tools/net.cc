@@ -0,0 +1,451 @@
+#include "net.h"
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace net
+{
+    bool Stream::read_exact(void *buffer, size_t length)
+    {
+        auto ptr = static_cast<uint8_t *>(buffer);
+        while (length > 0)
+        {
+            size_t n = read(ptr, length);
+            if (n == 0)
+                return false;
+            ptr += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    int wait(Stream &stream, int wake_fd, int timeout_ms)
+    {
+        if (stream.pending())
+            return 1;
+
+        pollfd fds[2] = { { stream.fd(), POLLIN, 0 }, { wake_fd, POLLIN, 0 } };
+        int count = poll(fds, wake_fd >= 0 ? 2 : 1, timeout_ms);
+
+        if (count <= 0)
+            return 0;
+        if (fds[0].revents)
+            return 1;
+        return fds[1].revents ? 2 : 0;
+    }
+
+    size_t TcpStream::read(void *buffer, size_t length)
+    {
+        ssize_t n = recv(fd_, buffer, length, 0);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    bool TcpStream::write(const void *data, size_t length)
+    {
+        auto ptr = static_cast<const uint8_t *>(data);
+        while (length > 0)
+        {
+            ssize_t n = send(fd_, ptr, length, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            ptr += n;
+            length -= (size_t)n;
+        }
+        return true;
+    }
+
+    void TcpStream::close()
+    {
+        if (fd_ >= 0)
+        {
+            shutdown(fd_, SHUT_RDWR);
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    size_t BufferedStream::read(void *buffer, size_t length)
+    {
+        if (pos_ == end_)
+        {
+            // Large reads bypass the buffer.
+            if (length >= sizeof(buffer_))
+                return inner_->read(buffer, length);
+
+            end_ = inner_->read(buffer_, sizeof(buffer_));
+            pos_ = 0;
+            if (end_ == 0)
+                return 0;
+        }
+
+        size_t n = length < end_ - pos_ ? length : end_ - pos_;
+        memcpy(buffer, buffer_ + pos_, n);
+        pos_ += n;
+        return n;
+    }
+
+    static void set_nodelay(int fd)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    int listen_tcp(uint16_t port, uint16_t *bound)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        socklen_t len = sizeof(addr);
+        getsockname(fd, (sockaddr *)&addr, &len);
+        if (bound != nullptr)
+            *bound = ntohs(addr.sin_port);
+
+        return fd;
+    }
+
+    int accept_tcp(int listener)
+    {
+        while (true)
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0)
+            {
+                set_nodelay(fd);
+                return fd;
+            }
+
+            // Reset before it was accepted, or a signal, the listener is fine.
+            if (errno != EINTR && errno != ECONNABORTED)
+                return -1;
+        }
+    }
+
+    int connect_tcp(uint16_t port)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        set_nodelay(fd);
+        return fd;
+    }
+
+    static inline uint32_t rol(uint32_t value, int bits)
+    {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    void sha1(const void *data, size_t length, uint8_t digest[20])
+    {
+        uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+        std::string msg(static_cast<const char *>(data), length);
+        msg += '\x80';
+        while (msg.length() % 64 != 56)
+            msg += '\0';
+
+        uint64_t bits = (uint64_t)length * 8;
+        for (int i = 7; i >= 0; i--)
+            msg += (char)(bits >> (i * 8));
+
+        for (size_t chunk = 0; chunk < msg.length(); chunk += 64)
+        {
+            uint32_t w[80];
+            auto p = reinterpret_cast<const uint8_t *>(msg.data() + chunk);
+
+            for (int i = 0; i < 16; i++)
+                w[i] = (p[i * 4] << 24) | (p[i * 4 + 1] << 16) | (p[i * 4 + 2] << 8) | p[i * 4 + 3];
+            for (int i = 16; i < 80; i++)
+                w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; i++)
+            {
+                uint32_t f, k;
+                if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+                else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+                else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+                else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+                uint32_t temp = rol(a, 5) + f + e + k + w[i];
+                e = d; d = c; c = rol(b, 30); b = a; a = temp;
+            }
+
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+        }
+
+        for (int i = 0; i < 20; i++)
+            digest[i] = (uint8_t)(h[i / 4] >> (24 - (i % 4) * 8));
+    }
+
+    std::string base64(const void *data, size_t length)
+    {
+        static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        auto p = static_cast<const uint8_t *>(data);
+        std::string out;
+        out.reserve((length + 2) / 3 * 4);
+
+        for (size_t i = 0; i < length; i += 3)
+        {
+            uint32_t n = p[i] << 16;
+            if (i + 1 < length) n |= p[i + 1] << 8;
+            if (i + 2 < length) n |= p[i + 2];
+
+            out += table[(n >> 18) & 63];
+            out += table[(n >> 12) & 63];
+            out += i + 1 < length ? table[(n >> 6) & 63] : '=';
+            out += i + 2 < length ? table[n & 63] : '=';
+        }
+
+        return out;
+    }
+
+    bool read_http_head(Stream &stream, std::string &head)
+    {
+        head.clear();
+        char c;
+
+        while (head.length() < 16 * 1024)
+        {
+            if (stream.read(&c, 1) == 0)
+                return false;
+
+            head += c;
+            if (head.length() >= 4 && head.compare(head.length() - 4, 4, "\r\n\r\n") == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    std::string http_header(const std::string &head, const char *name)
+    {
+        size_t name_len = strlen(name);
+        size_t pos = head.find("\r\n");
+
+        while (pos != std::string::npos && pos + 2 < head.length())
+        {
+            size_t line = pos + 2;
+            size_t end = head.find("\r\n", line);
+            if (end == std::string::npos)
+                break;
+
+            if (end - line > name_len && head[line + name_len] == ':'
+                && strncasecmp(head.c_str() + line, name, name_len) == 0)
+            {
+                size_t value = line + name_len + 1;
+                while (value < end && head[value] == ' ')
+                    value++;
+                return head.substr(value, end - value);
+            }
+
+            pos = end;
+        }
+
+        return "";
+    }
+}
+
+namespace net::ws
+{
+    static std::string accept_key(const std::string &key)
+    {
+        std::string input = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        uint8_t digest[20];
+        sha1(input.data(), input.length(), digest);
+        return base64(digest, sizeof(digest));
+    }
+
+    bool accept(Stream &stream, const std::string &head, const char *protocol)
+    {
+        auto key = http_header(head, "Sec-WebSocket-Key");
+        if (key.empty())
+            return false;
+
+        std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + accept_key(key) + "\r\n";
+
+        if (protocol != nullptr)
+            response += std::string("Sec-WebSocket-Protocol: ") + protocol + "\r\n";
+
+        response += "\r\n";
+        return stream.write(response);
+    }
+
+    bool connect(Stream &stream, const char *host, const char *path, const char *protocol,
+        const char *headers)
+    {
+        static const char key[] = "cGVuZ3UtcmVwbGF5LWtleQ==";
+
+        std::string request = std::string("GET ") + path + " HTTP/1.1\r\n"
+            "Host: " + host + "\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Version: 13\r\n"
+            "Sec-WebSocket-Key: " + key + "\r\n";
+
+        if (protocol != nullptr)
+            request += std::string("Sec-WebSocket-Protocol: ") + protocol + "\r\n";
+        if (headers != nullptr)
+            request += headers;
+
+        request += "\r\n";
+
+        std::string head;
+        if (!stream.write(request) || !read_http_head(stream, head))
+            return false;
+
+        return head.compare(0, 12, "HTTP/1.1 101") == 0
+            && http_header(head, "Sec-WebSocket-Accept") == accept_key(key);
+    }
+
+    static bool send_frame(Stream &stream, uint8_t opcode, const char *data, size_t length, bool mask)
+    {
+        uint8_t header[14];
+        size_t size = 0;
+
+        header[size++] = 0x80 | opcode;
+        uint8_t mask_bit = mask ? 0x80 : 0;
+
+        if (length < 126)
+        {
+            header[size++] = mask_bit | (uint8_t)length;
+        }
+        else if (length <= 0xFFFF)
+        {
+            header[size++] = mask_bit | 126;
+            header[size++] = (uint8_t)(length >> 8);
+            header[size++] = (uint8_t)length;
+        }
+        else
+        {
+            header[size++] = mask_bit | 127;
+            for (int i = 7; i >= 0; i--)
+                header[size++] = (uint8_t)((uint64_t)length >> (i * 8));
+        }
+
+        if (!mask)
+        {
+            std::string frame((char *)header, size);
+            frame.append(data, length);
+            return stream.write(frame);
+        }
+
+        // Any key will do, nothing sits between the endpoints.
+        static const uint8_t key[4] = { 0x12, 0x34, 0x56, 0x78 };
+        memcpy(header + size, key, 4);
+        size += 4;
+
+        std::string frame((char *)header, size);
+        frame.append(data, length);
+        for (size_t i = 0; i < length; i++)
+            frame[size + i] ^= key[i % 4];
+
+        return stream.write(frame);
+    }
+
+    bool send_text(Stream &stream, const char *data, size_t length, bool mask)
+    {
+        return send_frame(stream, 0x1, data, length, mask);
+    }
+
+    bool receive(Stream &stream, std::string &message, bool mask)
+    {
+        message.clear();
+
+        while (true)
+        {
+            uint8_t header[2];
+            if (!stream.read_exact(header, 2))
+                return false;
+
+            bool fin = header[0] & 0x80;
+            uint8_t opcode = header[0] & 0x0F;
+            uint64_t length = header[1] & 0x7F;
+
+            if (length == 126)
+            {
+                uint8_t ext[2];
+                if (!stream.read_exact(ext, 2))
+                    return false;
+                length = (ext[0] << 8) | ext[1];
+            }
+            else if (length == 127)
+            {
+                uint8_t ext[8];
+                if (!stream.read_exact(ext, 8))
+                    return false;
+                length = 0;
+                for (int i = 0; i < 8; i++)
+                    length = (length << 8) | ext[i];
+            }
+
+            uint8_t key[4] = { 0 };
+            if ((header[1] & 0x80) && !stream.read_exact(key, 4))
+                return false;
+
+            std::string payload(length, '\0');
+            if (length > 0 && !stream.read_exact(payload.data(), length))
+                return false;
+
+            if (header[1] & 0x80)
+            {
+                for (size_t i = 0; i < length; i++)
+                    payload[i] ^= key[i % 4];
+            }
+
+            if (opcode == 0x8)
+            {
+                return false;
+            }
+            else if (opcode == 0x9)
+            {
+                send_frame(stream, 0xA, payload.data(), payload.length(), mask);
+                continue;
+            }
+            else if (opcode == 0xA)
+            {
+                continue;
+            }
+
+            message += payload;
+            if (fin)
+                return true;
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef _BENCH_NET_H_
+#define _BENCH_NET_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// Minimal networking used by the stand-in tools, POSIX only.
+
+namespace net
+{
+    struct Stream
+    {
+        virtual ~Stream() {}
+
+        // Read up to `length` bytes, returns 0 on close or error.
+        virtual size_t read(void *buffer, size_t length) = 0;
+        virtual bool write(const void *data, size_t length) = 0;
+        virtual void close() = 0;
+
+        // Socket fd, and whether buffered data is ready without polling it.
+        virtual int fd() const = 0;
+        virtual bool pending() const { return false; }
+
+        bool read_exact(void *buffer, size_t length);
+        bool write(const std::string &data) { return write(data.data(), data.length()); }
+    };
+
+    ///
+    /// Wait until the stream has data to read or `wake_fd` is signaled.
+    /// @returns 1 for the stream, 2 for wake_fd, 0 on timeout or error.
+    ///
+    int wait(Stream &stream, int wake_fd, int timeout_ms);
+
+    struct TcpStream : Stream
+    {
+        explicit TcpStream(int fd) : fd_(fd) {}
+        ~TcpStream() override { close(); }
+
+        size_t read(void *buffer, size_t length) override;
+        bool write(const void *data, size_t length) override;
+        void close() override;
+        int fd() const override { return fd_; }
+
+    private:
+        int fd_;
+    };
+
+    ///
+    /// Buffers reads of another stream, so parsing a head byte by byte
+    /// doesn't cost a syscall or a TLS record each.
+    ///
+    struct BufferedStream : Stream
+    {
+        explicit BufferedStream(Stream *inner) : inner_(inner), pos_(0), end_(0) {}
+        ~BufferedStream() override { delete inner_; }
+
+        size_t read(void *buffer, size_t length) override;
+        bool write(const void *data, size_t length) override { return inner_->write(data, length); }
+        void close() override { inner_->close(); }
+        int fd() const override { return inner_->fd(); }
+        bool pending() const override { return pos_ < end_ || inner_->pending(); }
+
+    private:
+        Stream *inner_;
+        char buffer_[16 * 1024];
+        size_t pos_, end_;
+    };
+
+    ///
+    /// Listen on 127.0.0.1, pass port 0 for an ephemeral port.
+    /// @returns Socket fd or -1, `bound` receives the actual port.
+    ///
+    int listen_tcp(uint16_t port, uint16_t *bound);
+    int accept_tcp(int listener);
+    int connect_tcp(uint16_t port);
+
+    void sha1(const void *data, size_t length, uint8_t digest[20]);
+    std::string base64(const void *data, size_t length);
+
+    ///
+    /// Read HTTP head until the blank line, the body is left unread.
+    ///
+    bool read_http_head(Stream &stream, std::string &head);
+
+    ///
+    /// Get a header value from HTTP head, case-insensitive name.
+    ///
+    std::string http_header(const std::string &head, const char *name);
+}
+
+namespace net::tls
+{
+    struct Context;
+
+    ///
+    /// Server context with a self-signed certificate for 127.0.0.1,
+    /// generated in memory on each run.
+    ///
+    Context *create_server();
+
+    ///
+    /// Client context, certificates are not verified.
+    ///
+    Context *create_client();
+
+    ///
+    /// Complete the handshake over a connected socket.
+    /// @returns Stream owning the socket, nullptr on failure.
+    ///
+    Stream *accept(Context *ctx, int fd);
+    Stream *connect(Context *ctx, int fd);
+}
+
+namespace net::ws
+{
+    ///
+    /// Accept an upgrade request which has already been read,
+    /// and reply with the given subprotocol.
+    ///
+    bool accept(Stream &stream, const std::string &head, const char *protocol);
+    bool connect(Stream &stream, const char *host, const char *path, const char *protocol,
+        const char *headers = nullptr);
+
+    ///
+    /// Send a text frame, clients must mask their frames.
+    ///
+    bool send_text(Stream &stream, const char *data, size_t length, bool mask);
+
+    ///
+    /// Receive a full text message, ping frames are answered.
+    /// @returns false on close or error.
+    ///
+    bool receive(Stream &stream, std::string &message, bool mask);
+}
+
+#endif
@@ -0,0 +1,566 @@
+#include "net.h"
+#include "renderer/event_record.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Replays a recording made with the `record_events` option
+// through a local WAMP stand-in of the LCU WebSocket.
+//
+// An in-process subscriber dispatches events like rcp/socket.ts does,
+// external clients may also connect to ws://127.0.0.1:<port>/.
+
+using clock_type = std::chrono::steady_clock;
+
+struct Event
+{
+    uint64_t offset_us;     // since the first record
+    std::string message;    // raw [8, "OnJsonApiEvent", {...}]
+    std::string topic;      // OnJsonApiEvent_lol-..._v1_...
+    std::string type;       // uri with ids collapsed
+};
+
+struct Client
+{
+    std::unique_ptr<net::TcpStream> stream;
+    std::mutex mutex;
+    std::set<std::string> topics;
+    bool alive = true;
+};
+
+struct TypeStats
+{
+    size_t count = 0;
+    size_t bytes = 0;
+    std::vector<double> latency_us;
+    double dispatch_cpu_us = 0;
+    double send_cpu_us = 0;
+};
+
+static std::vector<Event> events_;
+static std::vector<std::shared_ptr<Client>> clients_;
+static std::mutex clients_mutex_;
+static std::atomic<int64_t> start_ns_{0};
+static double speed_ = 1;
+
+static int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock_type::now().time_since_epoch()).count();
+}
+
+static double thread_cpu_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int64_t scheduled_ns(const Event &event)
+{
+    return start_ns_ + (int64_t)(event.offset_us * 1000 / speed_);
+}
+
+static std::string json_string_field(const std::string &json, const char *name)
+{
+    std::string key = std::string("\"") + name + "\":\"";
+    size_t pos = json.find(key);
+    if (pos == std::string::npos)
+        return "";
+
+    pos += key.length();
+    size_t end = json.find('"', pos);
+    return end == std::string::npos ? "" : json.substr(pos, end - pos);
+}
+
+// Collapse numeric and uuid segments, so per-id endpoints group together.
+static std::string event_type(const std::string &uri)
+{
+    std::string type;
+    size_t pos = 0;
+
+    while (pos < uri.length())
+    {
+        size_t end = uri.find('/', pos + 1);
+        if (end == std::string::npos)
+            end = uri.length();
+
+        std::string segment = uri.substr(pos, end - pos);
+        const char *s = segment.c_str() + (segment[0] == '/');
+
+        bool is_id = *s != '\0' && strspn(s, "0123456789") == strlen(s);
+        is_id |= strlen(s) == 36 && strspn(s, "0123456789abcdefABCDEF-") == 36;
+
+        type += is_id ? "/{id}" : segment;
+        pos = end;
+    }
+
+    return type;
+}
+
+static std::string event_topic(const std::string &uri)
+{
+    std::string topic = "OnJsonApiEvent";
+    for (char c : uri)
+        topic += c == '/' ? '_' : (char)tolower(c);
+    return topic;
+}
+
+static bool load_recording(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == nullptr)
+        return false;
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[64 * 1024];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+        data.insert(data.end(), chunk, chunk + n);
+    fclose(fp);
+
+    uint64_t start_ms;
+    if (!event_record::get_header(data.data(), data.size(), &start_ms))
+        return false;
+
+    size_t pos = EVENT_RECORD_HEADER_SIZE;
+    uint64_t offset = 0;
+    bool first = true;
+
+    while (pos < data.size())
+    {
+        uint64_t delta, size;
+        size_t a = event_record::get_varint(&data[pos], data.size() - pos, &delta);
+        if (a == 0) break;
+        size_t b = event_record::get_varint(&data[pos + a], data.size() - pos - a, &size);
+        if (b == 0 || pos + a + b + size > data.size()) break;
+
+        // Time before the first event is spent loading the client.
+        offset += first ? 0 : delta;
+        first = false;
+
+        Event event;
+        event.offset_us = offset;
+        event.message.assign((const char *)&data[pos + a + b], size);
+
+        auto uri = json_string_field(event.message, "uri");
+        event.topic = event_topic(uri);
+        event.type = uri.empty() ? "(unknown)" : event_type(uri);
+
+        events_.push_back(std::move(event));
+        pos += a + b + size;
+    }
+
+    return !events_.empty();
+}
+
+// Topic control messages: [5, "topic"] and [6, "topic"].
+static void handle_control(Client &client, const std::string &message)
+{
+    int type = atoi(message.c_str() + (message[0] == '['));
+    size_t open = message.find('"');
+    size_t close = message.find('"', open + 1);
+    if (open == std::string::npos || close == std::string::npos)
+        return;
+
+    auto topic = message.substr(open + 1, close - open - 1);
+    std::lock_guard<std::mutex> lock(client.mutex);
+
+    if (type == 5)
+        client.topics.insert(topic);
+    else if (type == 6)
+        client.topics.erase(topic);
+}
+
+static void serve_client(std::shared_ptr<Client> client)
+{
+    std::string head, message;
+    if (!net::read_http_head(*client->stream, head)
+        || !net::ws::accept(*client->stream, head, "wamp"))
+    {
+        client->alive = false;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        clients_.push_back(client);
+    }
+
+    while (net::ws::receive(*client->stream, message, false))
+        handle_control(*client, message);
+
+    std::lock_guard<std::mutex> lock(client->mutex);
+    client->alive = false;
+}
+
+static void accept_loop(int listener)
+{
+    while (true)
+    {
+        int fd = net::accept_tcp(listener);
+        if (fd < 0)
+            break;
+
+        auto client = std::make_shared<Client>();
+        client->stream = std::make_unique<net::TcpStream>(fd);
+        std::thread(serve_client, client).detach();
+    }
+}
+
+static size_t client_count()
+{
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    return clients_.size();
+}
+
+static size_t subscribed_count(const char *topic)
+{
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    size_t count = 0;
+
+    for (auto &client : clients_)
+    {
+        std::lock_guard<std::mutex> client_lock(client->mutex);
+        count += client->alive && client->topics.count(topic);
+    }
+
+    return count;
+}
+
+static void publish(const Event &event)
+{
+    std::vector<std::shared_ptr<Client>> clients;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        clients = clients_;
+    }
+
+    // Specific topics receive the payload under their own name.
+    std::string specific;
+
+    for (auto &client : clients)
+    {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        if (!client->alive)
+            continue;
+
+        if (client->topics.count("OnJsonApiEvent"))
+        {
+            auto &msg = event.message;
+            client->alive = net::ws::send_text(*client->stream, msg.data(), msg.length(), false);
+        }
+
+        if (client->alive && client->topics.count(event.topic))
+        {
+            if (specific.empty())
+            {
+                size_t data = event.message.find(',', event.message.find(',') + 1);
+                specific = "[8,\"" + event.topic + "\"" + event.message.substr(data);
+            }
+            client->alive = net::ws::send_text(*client->stream, specific.data(), specific.length(), false);
+        }
+    }
+}
+
+// Decodes the message like JSON.parse, values are materialized
+// so the cost tracks payload shape and not just its size.
+struct JsonDecoder
+{
+    const char *p, *end;
+    std::vector<std::string> strings;
+    std::vector<double> numbers;
+
+    void ws() { while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++; }
+
+    bool string()
+    {
+        std::string out;
+        p++;
+        while (p < end && *p != '"')
+        {
+            if (*p == '\\' && p + 1 < end)
+            {
+                p++;
+                switch (*p)
+                {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u': out += (char)strtol(std::string(p + 1, 4).c_str(), nullptr, 16); p += 4; break;
+                    default: out += *p; break;
+                }
+                p++;
+            }
+            else
+            {
+                out += *p++;
+            }
+        }
+        if (p >= end) return false;
+        p++;
+        strings.push_back(std::move(out));
+        return true;
+    }
+
+    bool value()
+    {
+        ws();
+        if (p >= end) return false;
+
+        if (*p == '{' || *p == '[')
+        {
+            char close = *p == '{' ? '}' : ']';
+            bool object = *p == '{';
+            p++; ws();
+            if (p < end && *p == close) { p++; return true; }
+
+            while (p < end)
+            {
+                if (object)
+                {
+                    ws();
+                    if (p >= end || *p != '"' || !string()) return false;
+                    ws();
+                    if (p >= end || *p++ != ':') return false;
+                }
+                if (!value()) return false;
+                ws();
+                if (p < end && *p == ',') { p++; continue; }
+                if (p < end && *p == close) { p++; return true; }
+                return false;
+            }
+            return false;
+        }
+        else if (*p == '"')
+        {
+            return string();
+        }
+        else if (strncmp(p, "true", 4) == 0 || strncmp(p, "null", 4) == 0) { p += 4; return true; }
+        else if (strncmp(p, "false", 5) == 0) { p += 5; return true; }
+
+        char *next;
+        numbers.push_back(strtod(p, &next));
+        if (next == p) return false;
+        p = next;
+        return true;
+    }
+};
+
+struct SubscriberResult
+{
+    std::map<std::string, TypeStats> stats;
+    size_t received = 0;
+    size_t malformed = 0;
+};
+
+// Mirrors handleMessage in rcp/socket.ts.
+static void run_subscriber(uint16_t port, SubscriberResult *result, std::atomic<int> *state)
+{
+    net::TcpStream stream(net::connect_tcp(port));
+    if (stream.fd() < 0 || !net::ws::connect(stream, "127.0.0.1", "/", "wamp"))
+    {
+        *state = -1;
+        return;
+    }
+
+    std::string subscribe = "[5,\"OnJsonApiEvent\"]";
+    net::ws::send_text(stream, subscribe.data(), subscribe.length(), true);
+    *state = 1;
+
+    std::unordered_map<std::string, size_t> listeners;
+    std::string message;
+
+    while (result->received < events_.size() && net::ws::receive(stream, message, true))
+    {
+        auto &event = events_[result->received++];
+        auto &stats = result->stats[event.type];
+
+        double cpu = thread_cpu_us();
+
+        JsonDecoder json{ message.data(), message.data() + message.length(), {}, {} };
+        if (!json.value() || json.strings.empty())
+            result->malformed++;
+        else
+            listeners[json.strings[0]]++;
+
+        stats.dispatch_cpu_us += thread_cpu_us() - cpu;
+        stats.latency_us.push_back((now_ns() - scheduled_ns(event)) / 1e3);
+    }
+}
+
+static double percentile(std::vector<double> &values, double p)
+{
+    if (values.empty())
+        return 0;
+
+    size_t index = std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: pengu_replay <recording.pgrec> [options]\n"
+        "  --speed <1-100>   replay speed factor, default 1\n"
+        "  --port <port>     listen port, default ephemeral\n"
+        "  --clients <n>     wait for n external clients before replaying\n"
+        "  --json <path>     write the report as JSON\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *json_path = nullptr;
+    uint16_t port = 0;
+    int external = 0;
+
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--speed") && i + 1 < argc)
+            speed_ = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+            port = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--clients") && i + 1 < argc)
+            external = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+            json_path = argv[++i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (speed_ < 1 || speed_ > 100)
+    {
+        fprintf(stderr, "speed must be between 1 and 100\n");
+        return 1;
+    }
+
+    if (!load_recording(argv[1]))
+    {
+        fprintf(stderr, "failed to load recording: %s\n", argv[1]);
+        return 1;
+    }
+
+    int listener = net::listen_tcp(port, &port);
+    if (listener < 0)
+    {
+        fprintf(stderr, "failed to listen on port %d\n", port);
+        return 1;
+    }
+
+    std::thread(accept_loop, listener).detach();
+    printf("listening on ws://127.0.0.1:%d/\n", port);
+
+    SubscriberResult subscriber;
+    std::atomic<int> state{0};
+    std::thread subscriber_thread(run_subscriber, port, &subscriber, &state);
+
+    while (state == 0 || (state == 1 && subscribed_count("OnJsonApiEvent") < 1))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    if (state < 0)
+    {
+        fprintf(stderr, "subscriber failed to connect\n");
+        subscriber_thread.join();
+        return 1;
+    }
+
+    while (client_count() < (size_t)external + 1)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    printf("replaying %zu events at %gx\n", events_.size(), speed_);
+
+    std::map<std::string, TypeStats> stats;
+    std::vector<double> send_lag_us;
+    start_ns_ = now_ns() + 10 * 1000 * 1000;
+
+    for (auto &event : events_)
+    {
+        std::this_thread::sleep_until(clock_type::time_point(
+            std::chrono::nanoseconds(scheduled_ns(event))));
+
+        send_lag_us.push_back((now_ns() - scheduled_ns(event)) / 1e3);
+
+        double cpu = thread_cpu_us();
+        publish(event);
+
+        auto &type = stats[event.type];
+        type.count++;
+        type.bytes += event.message.length();
+        type.send_cpu_us += thread_cpu_us() - cpu;
+    }
+
+    subscriber_thread.join();
+    double duration_ms = (now_ns() - start_ns_) / 1e6;
+
+    for (auto &[name, type] : subscriber.stats)
+    {
+        stats[name].latency_us = std::move(type.latency_us);
+        stats[name].dispatch_cpu_us = type.dispatch_cpu_us;
+    }
+
+    printf("\n%-56s %7s %10s %9s %9s %9s %10s %10s\n", "event type", "count", "bytes",
+        "p50 us", "p99 us", "max us", "cpu us/ev", "send us/ev");
+
+    for (auto &[name, type] : stats)
+    {
+        printf("%-56s %7zu %10zu %9.1f %9.1f %9.1f %10.2f %10.2f\n", name.c_str(), type.count, type.bytes,
+            percentile(type.latency_us, 0.5), percentile(type.latency_us, 0.99), percentile(type.latency_us, 1),
+            type.dispatch_cpu_us / type.count, type.send_cpu_us / type.count);
+    }
+
+    printf("\n%zu/%zu events dispatched in %.1f ms, %zu malformed, send lag p99 %.1f us\n",
+        subscriber.received, events_.size(), duration_ms, subscriber.malformed, percentile(send_lag_us, 0.99));
+
+    if (json_path != nullptr)
+    {
+        FILE *fp = fopen(json_path, "w");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "failed to write %s\n", json_path);
+            return 1;
+        }
+
+        fprintf(fp, "{\n  \"speed\": %g,\n  \"events\": %zu,\n  \"dispatched\": %zu,\n  \"malformed\": %zu,\n"
+            "  \"duration_ms\": %.3f,\n  \"types\": [", speed_, events_.size(), subscriber.received,
+            subscriber.malformed, duration_ms);
+
+        bool first = true;
+        for (auto &[name, type] : stats)
+        {
+            fprintf(fp, "%s\n    { \"type\": \"%s\", \"count\": %zu, \"bytes\": %zu, \"latency_p50_us\": %.3f, "
+                "\"latency_p99_us\": %.3f, \"latency_max_us\": %.3f, \"dispatch_cpu_us\": %.3f, \"send_cpu_us\": %.3f }",
+                first ? "" : ",", name.c_str(), type.count, type.bytes, percentile(type.latency_us, 0.5),
+                percentile(type.latency_us, 0.99), percentile(type.latency_us, 1), type.dispatch_cpu_us,
+                type.send_cpu_us);
+            first = false;
+        }
+
+        fprintf(fp, "\n  ]\n}\n");
+        fclose(fp);
+    }
+
+    return subscriber.received == events_.size() ? 0 : 1;
+}
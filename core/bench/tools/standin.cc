@@ -0,0 +1,935 @@
+#include "net.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Local stand-in for the LCU and Riot Client, speaking the subset the core
+// touches: basic auth, JSON endpoints, large responses and WAMP event pushes
+// over HTTPS. Load profiles drive it and assert on throughput and latency.
+//
+//   pengu_standin serve [profile] [--port <port>] [--token <token>]
+//   pengu_standin run <profile> [--json <path>]
+
+using clock_type = std::chrono::steady_clock;
+
+static int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        clock_type::now().time_since_epoch()).count();
+}
+
+// ---- Profile -------------------------------------------------------------
+
+struct ProfileRequest
+{
+    std::string method;
+    std::string target;
+    size_t body = 0;
+    int expect = 200;
+    bool auth = true;
+    int weight = 1;
+};
+
+struct ProfileEvents
+{
+    std::string uri;
+    size_t size = 1024;
+    double rate = 0;        // events per second
+    int burst = 0;          // or bursts of events
+    double every_ms = 1000; // every interval
+};
+
+struct ProfileAssert
+{
+    std::string metric;
+    std::string op;
+    double value;
+    std::string text;
+};
+
+struct Profile
+{
+    std::string name;
+    int connections = 4;
+    double duration_ms = 5000;
+    std::vector<ProfileRequest> requests;
+    std::vector<ProfileEvents> events;
+    std::vector<ProfileAssert> asserts;
+};
+
+// Durations are in ms, "500us", "20ms" and "2s" are accepted,
+// sizes take "k" and "m" suffixes.
+static double parse_quantity(const std::string &text)
+{
+    char *unit;
+    double value = strtod(text.c_str(), &unit);
+
+    if (!strcmp(unit, "us")) return value / 1000;
+    if (!strcmp(unit, "s")) return value * 1000;
+    if (!strcmp(unit, "k")) return value * 1024;
+    if (!strcmp(unit, "m")) return value * 1024 * 1024;
+    return value;
+}
+
+static std::vector<std::string> split(const std::string &line)
+{
+    std::vector<std::string> words;
+    size_t pos = 0;
+
+    while ((pos = line.find_first_not_of(" \t\r\n", pos)) != std::string::npos)
+    {
+        size_t end = line.find_first_of(" \t\r\n", pos);
+        if (end == std::string::npos)
+            end = line.length();
+        words.push_back(line.substr(pos, end - pos));
+        pos = end;
+    }
+
+    return words;
+}
+
+static bool load_profile(const char *path, Profile &profile)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "failed to open profile: %s\n", path);
+        return false;
+    }
+
+    const char *slash = strrchr(path, '/');
+    profile.name = slash ? slash + 1 : path;
+
+    char buffer[1024];
+    int number = 0;
+
+    while (fgets(buffer, sizeof(buffer), fp))
+    {
+        number++;
+        std::string line(buffer);
+        line = line.substr(0, line.find('#'));
+
+        auto words = split(line);
+        if (words.empty())
+            continue;
+
+        bool ok = true;
+        auto &cmd = words[0];
+
+        if (cmd == "connections" && words.size() == 2)
+        {
+            profile.connections = atoi(words[1].c_str());
+        }
+        else if (cmd == "duration" && words.size() == 2)
+        {
+            profile.duration_ms = parse_quantity(words[1]);
+        }
+        else if (cmd == "request" && words.size() >= 3)
+        {
+            ProfileRequest req;
+            req.method = words[1];
+            req.target = words[2];
+
+            for (size_t i = 3; i < words.size() && ok; i++)
+            {
+                auto &w = words[i];
+                if (!w.compare(0, 5, "body=")) req.body = (size_t)parse_quantity(w.substr(5));
+                else if (!w.compare(0, 7, "expect=")) req.expect = atoi(w.c_str() + 7);
+                else if (!w.compare(0, 7, "weight=")) req.weight = std::max(1, atoi(w.c_str() + 7));
+                else if (w == "auth=none") req.auth = false;
+                else ok = false;
+            }
+
+            profile.requests.push_back(req);
+        }
+        else if (cmd == "events" && words.size() >= 3)
+        {
+            ProfileEvents ev;
+            ev.uri = words[1];
+
+            for (size_t i = 2; i < words.size() && ok; i++)
+            {
+                auto &w = words[i];
+                if (!w.compare(0, 5, "rate=")) ev.rate = atof(w.c_str() + 5);
+                else if (!w.compare(0, 6, "burst=")) ev.burst = atoi(w.c_str() + 6);
+                else if (!w.compare(0, 6, "every=")) ev.every_ms = parse_quantity(w.substr(6));
+                else if (!w.compare(0, 5, "size=")) ev.size = (size_t)parse_quantity(w.substr(5));
+                else ok = false;
+            }
+
+            ok &= ev.rate > 0 || ev.burst > 0;
+            profile.events.push_back(ev);
+        }
+        else if (cmd == "assert" && words.size() == 4)
+        {
+            static const std::set<std::string> ops = { "<", "<=", ">", ">=", "==" };
+            ok = ops.count(words[2]) > 0;
+            profile.asserts.push_back({ words[1], words[2], parse_quantity(words[3]),
+                words[1] + " " + words[2] + " " + words[3] });
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            fprintf(stderr, "%s:%d: invalid line: %s", path, number, buffer);
+            fclose(fp);
+            return false;
+        }
+    }
+
+    fclose(fp);
+    return true;
+}
+
+// ---- Server --------------------------------------------------------------
+
+struct WampSession
+{
+    net::Stream *stream;
+    std::mutex mutex;
+    std::deque<std::string> queue;
+    std::set<std::string> topics;
+    int wake[2];
+    std::atomic<size_t> published{0};
+};
+
+struct Response
+{
+    int status = 200;
+    std::string body;
+    const char *type = "application/json";
+    bool chunked = false;
+};
+
+static uint16_t port_ = 0;
+static std::string token_;
+static std::string authorization_;
+static net::tls::Context *server_tls_;
+static std::mutex sessions_mutex_;
+static std::vector<std::shared_ptr<WampSession>> sessions_;
+static std::mutex large_mutex_;
+static std::map<size_t, std::string> large_bodies_;
+
+static std::string query_param(const std::string &target, const char *name)
+{
+    size_t query = target.find('?');
+    if (query == std::string::npos)
+        return "";
+
+    std::string key = std::string(name) + "=";
+    size_t pos = query + 1;
+
+    while (pos < target.length())
+    {
+        size_t end = target.find('&', pos);
+        if (end == std::string::npos)
+            end = target.length();
+
+        if (!target.compare(pos, key.length(), key))
+            return target.substr(pos + key.length(), end - pos - key.length());
+
+        pos = end + 1;
+    }
+
+    return "";
+}
+
+static std::string champ_select_session()
+{
+    static const char *positions[] = { "top", "jungle", "middle", "bottom", "utility" };
+    std::string team;
+    for (int i = 0; i < 5; i++)
+    {
+        char member[256];
+        snprintf(member, sizeof(member),
+            "%s{\"cellId\":%d,\"championId\":%d,\"championPickIntent\":0,\"summonerId\":%d,"
+            "\"assignedPosition\":\"%s\",\"spell1Id\":4,\"spell2Id\":14,\"team\":1}",
+            i ? "," : "", i, 100 + i, 20000 + i, positions[i]);
+        team += member;
+    }
+
+    return "{\"actions\":[],\"allowBattleBoost\":false,\"allowRerolling\":false,\"benchChampions\":[],"
+        "\"isSpectating\":false,\"localPlayerCellId\":0,\"myTeam\":[" + team + "],\"theirTeam\":[],"
+        "\"timer\":{\"adjustedTimeLeftInPhase\":30000,\"phase\":\"BAN_PICK\"}}";
+}
+
+// Responses of the endpoints plugins and the core commonly hit.
+static const std::map<std::string, std::string> &fixtures()
+{
+    static const std::map<std::string, std::string> map = {
+        { "/riotclient/region-locale",
+          "{\"locale\":\"en_US\",\"region\":\"NA\",\"webLanguage\":\"en\",\"webRegion\":\"na\"}" },
+        { "/riotclient/ux-state",
+          "\"ShowMain\"" },
+        { "/lol-summoner/v1/current-summoner",
+          "{\"accountId\":200001,\"displayName\":\"Pengu\",\"gameName\":\"Pengu\",\"tagLine\":\"NA1\","
+          "\"profileIconId\":29,\"puuid\":\"01234567-89ab-cdef-0123-456789abcdef\",\"summonerId\":20000,"
+          "\"summonerLevel\":30}" },
+        { "/lol-gameflow/v1/gameflow-phase",
+          "\"ChampSelect\"" },
+        { "/lol-gameflow/v1/session",
+          "{\"phase\":\"ChampSelect\",\"gameData\":{\"gameId\":0,\"isCustomGame\":false,\"queue\":{\"id\":420,"
+          "\"type\":\"RANKED_SOLO_5x5\"}},\"map\":{\"id\":11,\"name\":\"Summoner's Rift\"}}" },
+        { "/lol-champ-select/v1/session",
+          champ_select_session() },
+        { "/product-session/v1/external-sessions",
+          "{\"league_of_legends\":{\"exitCode\":0,\"launchConfiguration\":{\"arguments\":[]},"
+          "\"productId\":\"league_of_legends\",\"version\":\"14.1\"}}" },
+    };
+
+    return map;
+}
+
+// JSON array of strings, so it goes through the same parsing as real data.
+static const std::string &large_body(size_t size)
+{
+    std::lock_guard<std::mutex> lock(large_mutex_);
+    auto &body = large_bodies_[size];
+
+    if (body.empty())
+    {
+        body = "[";
+        while (body.length() + 68 < size)
+            body += "\"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef\",";
+        body += "\"\"]";
+    }
+
+    return body;
+}
+
+static Response route(const std::string &method, const std::string &target,
+    const std::string &body, bool authorized)
+{
+    Response res;
+    auto path = target.substr(0, target.find('?'));
+
+    if (!authorized)
+    {
+        res.status = 401;
+        res.body = "{\"errorCode\":\"RPC_ERROR\",\"httpStatus\":401,\"message\":\"Unauthorized\"}";
+        return res;
+    }
+
+    if (path == "/bench/large")
+    {
+        res.body = large_body((size_t)parse_quantity(query_param(target, "size")));
+        res.chunked = query_param(target, "chunked") == "1";
+    }
+    else if (path == "/bench/echo" && (method == "POST" || method == "PUT"))
+    {
+        res.body = body;
+    }
+    else if (path == "/bench/delay")
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(
+            (int64_t)(parse_quantity(query_param(target, "time")) * 1000)));
+        res.body = "{}";
+    }
+    else if (method == "PUT" || method == "PATCH" || method == "DELETE")
+    {
+        res.status = 204;
+    }
+    else if (auto it = fixtures().find(path); method == "GET" && it != fixtures().end())
+    {
+        res.body = it->second;
+    }
+    else
+    {
+        res.status = 404;
+        res.body = "{\"errorCode\":\"RPC_ERROR\",\"httpStatus\":404,\"message\":\"Invalid URI format\"}";
+    }
+
+    return res;
+}
+
+static const char *status_text(int status)
+{
+    switch (status)
+    {
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 401: return "Unauthorized";
+        case 404: return "Not Found";
+        default: return "Error";
+    }
+}
+
+static bool write_response(net::Stream &stream, const Response &res)
+{
+    char head[256];
+
+    if (!res.chunked)
+    {
+        snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n",
+            res.status, status_text(res.status), res.type, res.body.length());
+        return stream.write(std::string(head) + res.body);
+    }
+
+    // Without a length, like proxied responses of unknown size.
+    snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n\r\n",
+        res.status, status_text(res.status), res.type);
+    if (!stream.write(head, strlen(head)))
+        return false;
+
+    for (size_t pos = 0; pos < res.body.length(); pos += 16 * 1024)
+    {
+        size_t size = std::min<size_t>(16 * 1024, res.body.length() - pos);
+        snprintf(head, sizeof(head), "%zx\r\n", size);
+        if (!stream.write(head + res.body.substr(pos, size) + "\r\n"))
+            return false;
+    }
+
+    return stream.write("0\r\n\r\n", 5);
+}
+
+static void publish(const std::string &uri, const std::string &data)
+{
+    std::string topic = "OnJsonApiEvent";
+    for (char c : uri)
+        topic += c == '/' ? '_' : (char)tolower(c);
+
+    std::string payload = ",{\"data\":" + data + ",\"eventType\":\"Update\",\"uri\":\"" + uri + "\"}]";
+
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    for (auto &session : sessions_)
+    {
+        std::lock_guard<std::mutex> session_lock(session->mutex);
+
+        if (session->topics.count("OnJsonApiEvent"))
+            session->queue.push_back("[8,\"OnJsonApiEvent\"" + payload);
+        else if (session->topics.count(topic))
+            session->queue.push_back("[8,\"" + topic + "\"" + payload);
+        else
+            continue;
+
+        session->published++;
+        char c = 0;
+        (void)!write(session->wake[1], &c, 1);
+    }
+}
+
+static void run_wamp(net::Stream &stream)
+{
+    auto session = std::make_shared<WampSession>();
+    session->stream = &stream;
+    if (pipe(session->wake) != 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions_.push_back(session);
+    }
+
+    std::string message;
+    bool alive = true;
+
+    // Reads and writes stay on this thread, TLS streams aren't thread-safe.
+    while (alive)
+    {
+        int ready = net::wait(stream, session->wake[0], 1000);
+
+        if (ready == 1)
+        {
+            if (!(alive = net::ws::receive(stream, message, false)))
+                break;
+
+            int type = atoi(message.c_str() + 1);
+            size_t open = message.find('"'), close = message.find('"', open + 1);
+            if (open == std::string::npos || close == std::string::npos)
+                continue;
+
+            std::lock_guard<std::mutex> lock(session->mutex);
+            auto topic = message.substr(open + 1, close - open - 1);
+            if (type == 5) session->topics.insert(topic);
+            if (type == 6) session->topics.erase(topic);
+        }
+        else if (ready == 2)
+        {
+            char drain[256];
+            (void)!read(session->wake[0], drain, sizeof(drain));
+
+            std::deque<std::string> queue;
+            {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                queue.swap(session->queue);
+            }
+
+            for (auto &msg : queue)
+                if (!(alive = net::ws::send_text(stream, msg.data(), msg.length(), false)))
+                    break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions_.erase(std::find(sessions_.begin(), sessions_.end(), session));
+    }
+
+    close(session->wake[0]);
+    close(session->wake[1]);
+}
+
+static void serve_connection(int fd)
+{
+    auto tls = net::tls::accept(server_tls_, fd);
+    if (tls == nullptr)
+        return;
+
+    net::BufferedStream stream(tls);
+    std::string head, body;
+
+    while (net::read_http_head(stream, head))
+    {
+        size_t sp1 = head.find(' '), sp2 = head.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos)
+            break;
+
+        auto method = head.substr(0, sp1);
+        auto target = head.substr(sp1 + 1, sp2 - sp1 - 1);
+        bool authorized = net::http_header(head, "Authorization") == authorization_;
+
+        if (!strcasecmp(net::http_header(head, "Upgrade").c_str(), "websocket"))
+        {
+            if (authorized && net::ws::accept(stream, head, "wamp"))
+                run_wamp(stream);
+            else
+                write_response(stream, route(method, target, "", false));
+            break;
+        }
+
+        body.resize(atoll(net::http_header(head, "Content-Length").c_str()));
+        if (!body.empty() && !stream.read_exact(body.data(), body.length()))
+            break;
+
+        if (!write_response(stream, route(method, target, body, authorized)))
+            break;
+
+        if (!strcasecmp(net::http_header(head, "Connection").c_str(), "close"))
+            break;
+    }
+}
+
+static bool start_server(uint16_t port)
+{
+    server_tls_ = net::tls::create_server();
+    if (server_tls_ == nullptr)
+    {
+        fprintf(stderr, "failed to create TLS context\n");
+        return false;
+    }
+
+    int listener = net::listen_tcp(port, &port_);
+    if (listener < 0)
+    {
+        fprintf(stderr, "failed to listen on port %d\n", port);
+        return false;
+    }
+
+    auto credentials = "riot:" + token_;
+    authorization_ = "Basic " + net::base64(credentials.data(), credentials.length());
+
+    std::thread([listener] {
+        while (true)
+        {
+            int fd = net::accept_tcp(listener);
+            if (fd >= 0)
+                std::thread(serve_connection, fd).detach();
+            // Out of descriptors, clients reconnect once some are closed.
+            else if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            else
+                break;
+        }
+    }).detach();
+
+    return true;
+}
+
+static std::string event_data(size_t size)
+{
+    char head[64];
+    snprintf(head, sizeof(head), "{\"sent\":%lld,\"fill\":\"", (long long)now_ns());
+
+    std::string data(head);
+    if (size > data.length() + 2)
+        data.append(size - data.length() - 2, 'x');
+    return data + "\"}";
+}
+
+// Pushes events until `deadline`, forever with 0.
+static void run_events(const ProfileEvents &ev, int64_t deadline)
+{
+    auto interval_ns = (int64_t)(ev.burst > 0 ? ev.every_ms * 1e6 : 1e9 / ev.rate);
+    int count = ev.burst > 0 ? ev.burst : 1;
+    int64_t next = now_ns();
+
+    while (deadline == 0 || next < deadline)
+    {
+        std::this_thread::sleep_until(clock_type::time_point(std::chrono::nanoseconds(next)));
+
+        for (int i = 0; i < count; i++)
+            publish(ev.uri, event_data(ev.size));
+
+        next += interval_ns;
+    }
+}
+
+// ---- Load ----------------------------------------------------------------
+
+struct Sample
+{
+    size_t request;
+    double ms;
+    size_t bytes;
+    bool error;
+    bool connected;
+};
+
+struct EventResult
+{
+    std::vector<double> latency_ms;
+    std::atomic<bool> ready{false};
+};
+
+static net::tls::Context *client_tls_;
+
+static net::Stream *connect_server()
+{
+    int fd = net::connect_tcp(port_);
+    if (fd < 0)
+        return nullptr;
+
+    auto tls = net::tls::connect(client_tls_, fd);
+    return tls ? new net::BufferedStream(tls) : nullptr;
+}
+
+static bool read_body(net::Stream &stream, const std::string &head, std::string &body)
+{
+    body.clear();
+
+    if (strcasecmp(net::http_header(head, "Transfer-Encoding").c_str(), "chunked"))
+    {
+        body.resize(atoll(net::http_header(head, "Content-Length").c_str()));
+        return body.empty() || stream.read_exact(body.data(), body.length());
+    }
+
+    while (true)
+    {
+        std::string line;
+        char c;
+        while (stream.read(&c, 1) == 1 && c != '\n')
+            line += c;
+
+        size_t size = strtoul(line.c_str(), nullptr, 16);
+        if (size == 0)
+            return stream.read_exact(&c, 1) && stream.read_exact(&c, 1);
+
+        size_t pos = body.length();
+        body.resize(pos + size + 2);
+        if (!stream.read_exact(&body[pos], size + 2))
+            return false;
+        body.resize(pos + size);
+    }
+}
+
+static void run_worker(const Profile &profile, int index, int64_t deadline, std::vector<Sample> *samples)
+{
+    // Weighted round robin, each worker starts at a different offset.
+    std::vector<size_t> order;
+    for (size_t i = 0; i < profile.requests.size(); i++)
+        order.insert(order.end(), profile.requests[i].weight, i);
+
+    std::unique_ptr<net::Stream> stream;
+    std::string head, body, request_body;
+    size_t next = index;
+
+    while (now_ns() < deadline)
+    {
+        if (!stream)
+            stream.reset(connect_server());
+
+        if (!stream)
+        {
+            samples->push_back({ order[next % order.size()], 0, 0, true, false });
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        size_t id = order[next++ % order.size()];
+        auto &req = profile.requests[id];
+        request_body.assign(req.body, 'x');
+
+        char buffer[512];
+        snprintf(buffer, sizeof(buffer), "%s %s HTTP/1.1\r\nHost: 127.0.0.1:%d\r\n%s%s%sContent-Length: %zu\r\n\r\n",
+            req.method.c_str(), req.target.c_str(), port_,
+            req.auth ? "Authorization: " : "", req.auth ? authorization_.c_str() : "", req.auth ? "\r\n" : "",
+            req.body);
+
+        int64_t start = now_ns();
+        bool ok = stream->write(buffer + request_body)
+            && net::read_http_head(*stream, head)
+            && read_body(*stream, head, body);
+
+        int status = ok ? atoi(head.c_str() + 9) : 0;
+        samples->push_back({ id, (now_ns() - start) / 1e6, body.length(), status != req.expect, true });
+
+        if (!ok)
+            stream.reset();
+    }
+}
+
+static void run_subscriber(EventResult *result, int64_t deadline)
+{
+    std::unique_ptr<net::Stream> stream(connect_server());
+    auto auth = "Authorization: " + authorization_ + "\r\n";
+
+    if (!stream || !net::ws::connect(*stream, "127.0.0.1", "/", "wamp", auth.c_str()))
+    {
+        result->ready = true;
+        return;
+    }
+
+    std::string message = "[5,\"OnJsonApiEvent\"]";
+    net::ws::send_text(*stream, message.data(), message.length(), true);
+
+    // Subscription is processed before the first event goes out.
+    for (bool subscribed = false; !subscribed; )
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+
+        for (auto &session : sessions_)
+        {
+            std::lock_guard<std::mutex> session_lock(session->mutex);
+            subscribed |= session->topics.count("OnJsonApiEvent") > 0;
+        }
+    }
+    result->ready = true;
+
+    while (now_ns() < deadline)
+    {
+        if (net::wait(*stream, -1, 100) != 1)
+            continue;
+        if (!net::ws::receive(*stream, message, true))
+            break;
+
+        auto sent = strstr(message.c_str(), "\"sent\":");
+        if (sent != nullptr)
+            result->latency_ms.push_back((now_ns() - atoll(sent + 7)) / 1e6);
+    }
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+
+    size_t index = std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+static bool check(const ProfileAssert &a, double actual)
+{
+    if (a.op == "<") return actual < a.value;
+    if (a.op == "<=") return actual <= a.value;
+    if (a.op == ">") return actual > a.value;
+    if (a.op == ">=") return actual >= a.value;
+    return actual == a.value;
+}
+
+static int run_profile(const Profile &profile, const char *json_path)
+{
+    client_tls_ = net::tls::create_client();
+
+    int64_t deadline = now_ns() + (int64_t)(profile.duration_ms * 1e6);
+    int64_t start = now_ns();
+
+    EventResult events;
+    std::thread subscriber;
+    if (!profile.events.empty())
+    {
+        // Events keep coming a little longer, so late ones aren't lost.
+        subscriber = std::thread(run_subscriber, &events, deadline + 500 * 1000 * 1000);
+        while (!events.ready)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<std::thread> threads;
+    for (auto &ev : profile.events)
+        threads.emplace_back(run_events, std::cref(ev), deadline);
+
+    std::vector<std::vector<Sample>> samples(profile.requests.empty() ? 0 : profile.connections);
+    for (int i = 0; i < (int)samples.size(); i++)
+        threads.emplace_back(run_worker, std::cref(profile), i, deadline, &samples[i]);
+
+    for (auto &t : threads)
+        t.join();
+    double elapsed_ms = (now_ns() - start) / 1e6;
+
+    size_t sent = 0;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (auto &session : sessions_)
+            sent += session->published;
+    }
+
+    if (subscriber.joinable())
+        subscriber.join();
+
+    // Aggregate
+    std::map<std::string, double> metrics;
+    std::vector<double> all;
+    std::vector<std::vector<double>> per_request(profile.requests.size());
+    size_t errors = 0, connect_errors = 0, bytes = 0;
+
+    for (auto &list : samples)
+    {
+        for (auto &s : list)
+        {
+            errors += s.error;
+            connect_errors += !s.connected;
+            bytes += s.bytes;
+            if (!s.error)
+            {
+                all.push_back(s.ms);
+                per_request[s.request].push_back(s.ms);
+            }
+        }
+    }
+
+    metrics["requests"] = (double)(all.size() + errors);
+    metrics["errors"] = (double)errors;
+    metrics["connect_errors"] = (double)connect_errors;
+    metrics["rps"] = all.size() / (elapsed_ms / 1000);
+    metrics["mbps"] = bytes / 1e6 / (elapsed_ms / 1000);
+    metrics["p50"] = percentile(all, 0.5);
+    metrics["p90"] = percentile(all, 0.9);
+    metrics["p99"] = percentile(all, 0.99);
+    metrics["max"] = percentile(all, 1);
+
+    // Profiles without events don't report a stream that never ran.
+    if (!profile.events.empty())
+    {
+        metrics["events_sent"] = (double)sent;
+        metrics["events_received"] = (double)events.latency_ms.size();
+        metrics["events_lost"] = (double)(sent - std::min(sent, events.latency_ms.size()));
+        metrics["event_p50"] = percentile(events.latency_ms, 0.5);
+        metrics["event_p99"] = percentile(events.latency_ms, 0.99);
+        metrics["event_max"] = percentile(events.latency_ms, 1);
+    }
+
+    printf("profile %s: %d connections, %.0f ms\n\n", profile.name.c_str(), profile.connections, elapsed_ms);
+    printf("%-7s %-48s %8s %9s %9s\n", "method", "target", "count", "p50 ms", "p99 ms");
+    for (size_t i = 0; i < profile.requests.size(); i++)
+    {
+        auto &req = profile.requests[i];
+        printf("%-7s %-48s %8zu %9.3f %9.3f\n", req.method.c_str(), req.target.c_str(),
+            per_request[i].size(), percentile(per_request[i], 0.5), percentile(per_request[i], 0.99));
+    }
+
+    printf("\n");
+    for (auto &[name, value] : metrics)
+        printf("  %-16s %.3f\n", name.c_str(), value);
+
+    int failed = 0;
+    printf("\n");
+    for (auto &a : profile.asserts)
+    {
+        auto it = metrics.find(a.metric);
+        bool ok = it != metrics.end() && check(a, it->second);
+        failed += !ok;
+        printf("  %s  %s (actual %.3f)\n", ok ? "PASS" : "FAIL", a.text.c_str(),
+            it != metrics.end() ? it->second : 0.0);
+    }
+
+    if (json_path != nullptr)
+    {
+        FILE *fp = fopen(json_path, "w");
+        if (fp != nullptr)
+        {
+            fprintf(fp, "{\n  \"profile\": \"%s\",\n  \"failed\": %d", profile.name.c_str(), failed);
+            for (auto &[name, value] : metrics)
+                fprintf(fp, ",\n  \"%s\": %.3f", name.c_str(), value);
+            fprintf(fp, "\n}\n");
+            fclose(fp);
+        }
+    }
+
+    return failed == 0 ? 0 : 1;
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: pengu_standin serve [profile] [--port <port>] [--token <token>]\n"
+        "       pengu_standin run <profile> [--json <path>]\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || (strcmp(argv[1], "serve") && strcmp(argv[1], "run")))
+    {
+        usage();
+        return 1;
+    }
+
+    bool serve = !strcmp(argv[1], "serve");
+    const char *profile_path = nullptr;
+    const char *json_path = nullptr;
+    uint16_t port = 0;
+    token_ = "pengu-standin";
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--port") && i + 1 < argc)
+            port = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--token") && i + 1 < argc)
+            token_ = argv[++i];
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+            json_path = argv[++i];
+        else if (argv[i][0] != '-' && profile_path == nullptr)
+            profile_path = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    Profile profile;
+    if ((profile_path != nullptr || !serve) && (profile_path == nullptr || !load_profile(profile_path, profile)))
+        return 1;
+
+    if (!start_server(port))
+        return 1;
+
+    if (!serve)
+        return run_profile(profile, json_path);
+
+    // Same arguments the client gets, e.g. for the riotclient domain.
+    printf("--riotclient-app-port=%d --riotclient-auth-token=%s\n", port_, token_.c_str());
+    fflush(stdout);
+
+    for (auto &ev : profile.events)
+        std::thread(run_events, std::cref(ev), 0).detach();
+
+    while (true)
+        pause();
+}
@@ -0,0 +1,153 @@
+#include "net.h"
+#include <errno.h>
+#include <unistd.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+namespace net::tls
+{
+    struct Context
+    {
+        SSL_CTX *ctx;
+    };
+
+    // Interrupted or waiting on the other direction, not a closed connection.
+    static bool should_retry(SSL *ssl, int result)
+    {
+        int error = SSL_get_error(ssl, result);
+        return error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE
+            || (error == SSL_ERROR_SYSCALL && errno == EINTR);
+    }
+
+    struct TlsStream : Stream
+    {
+        TlsStream(SSL *ssl, int fd) : ssl_(ssl), fd_(fd) {}
+        ~TlsStream() override { close(); }
+
+        size_t read(void *buffer, size_t length) override
+        {
+            while (true)
+            {
+                int n = SSL_read(ssl_, buffer, (int)length);
+                if (n > 0)
+                    return (size_t)n;
+                if (!should_retry(ssl_, n))
+                    return 0;
+            }
+        }
+
+        bool write(const void *data, size_t length) override
+        {
+            auto ptr = static_cast<const uint8_t *>(data);
+            while (length > 0)
+            {
+                int n = SSL_write(ssl_, ptr, (int)length);
+                if (n <= 0 && should_retry(ssl_, n))
+                    continue;
+                if (n <= 0)
+                    return false;
+                ptr += n;
+                length -= (size_t)n;
+            }
+            return true;
+        }
+
+        void close() override
+        {
+            if (ssl_ != nullptr)
+            {
+                SSL_shutdown(ssl_);
+                SSL_free(ssl_);
+                ::close(fd_);
+                ssl_ = nullptr;
+                fd_ = -1;
+            }
+        }
+
+        int fd() const override { return fd_; }
+        bool pending() const override { return ssl_ != nullptr && SSL_pending(ssl_) > 0; }
+
+    private:
+        SSL *ssl_;
+        int fd_;
+    };
+
+    static bool use_self_signed(SSL_CTX *ctx)
+    {
+        EVP_PKEY *key = EVP_EC_gen("P-256");
+        X509 *cert = X509_new();
+        if (key == nullptr || cert == nullptr)
+            return false;
+
+        X509_set_version(cert, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 60 * 60 * 24);
+        X509_set_pubkey(cert, key);
+
+        auto name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"127.0.0.1", -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, key, EVP_sha256());
+
+        bool ok = SSL_CTX_use_certificate(ctx, cert) == 1
+            && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+
+        X509_free(cert);
+        EVP_PKEY_free(key);
+        return ok;
+    }
+
+    Context *create_server()
+    {
+        SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+        if (ctx == nullptr || !use_self_signed(ctx))
+        {
+            SSL_CTX_free(ctx);
+            return nullptr;
+        }
+
+        return new Context{ ctx };
+    }
+
+    Context *create_client()
+    {
+        SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+        if (ctx == nullptr)
+            return nullptr;
+
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+        return new Context{ ctx };
+    }
+
+    static Stream *handshake(Context *ctx, int fd, bool server)
+    {
+        SSL *ssl = SSL_new(ctx->ctx);
+        SSL_set_fd(ssl, fd);
+
+        int result;
+        do
+            result = server ? SSL_accept(ssl) : SSL_connect(ssl);
+        while (result != 1 && should_retry(ssl, result));
+
+        if (result != 1)
+        {
+            SSL_free(ssl);
+            ::close(fd);
+            return nullptr;
+        }
+
+        return new TlsStream(ssl, fd);
+    }
+
+    Stream *accept(Context *ctx, int fd)
+    {
+        return handshake(ctx, fd, true);
+    }
+
+    Stream *connect(Context *ctx, int fd)
+    {
+        return handshake(ctx, fd, false);
+    }
+}
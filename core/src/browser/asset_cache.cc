@@ -0,0 +1,356 @@
+#include "browser.h"
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include "include/capi/cef_stream_capi.h"
+
+// BROWSER PROCESS ONLY.
+
+// Content-addressed cache of plugin files. Paths map to a content hash,
+// identical files share one body in memory, one ETag and one canonical URL.
+
+// Bodies kept in memory, least recently used ones are dropped first.
+static constexpr size_t MEMORY_BUDGET = 64 * 1024 * 1024;
+static constexpr int64_t MAX_BODY_SIZE = 4 * 1024 * 1024;
+
+struct PathEntry
+{
+    int64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+};
+
+struct ContentEntry
+{
+    int64_t size;
+    path canonical;
+    std::shared_ptr<const std::string> body;
+    std::list<uint64_t>::iterator lru;
+};
+
+static std::mutex mutex_;
+static std::unordered_map<std::u16string, PathEntry> paths_;
+static std::unordered_map<uint64_t, ContentEntry> contents_;
+static std::list<uint64_t> lru_;
+static size_t memory_used_ = 0;
+
+static uint64_t fnv64_1a(const void *data, size_t length, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= static_cast<const uint8_t *>(data)[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static bool hash_file(const path &file, uint64_t &hash, std::string *body)
+{
+    std::error_code ec;
+    file::File fp;
+    if (!fp.open(file, ec))
+        return false;
+
+    char buffer[64 * 1024];
+    size_t read;
+    hash = 0xcbf29ce484222325ull;
+
+    while ((read = fp.read(buffer, sizeof(buffer), ec)) > 0)
+    {
+        hash = fnv64_1a(buffer, read, hash);
+        if (body != nullptr)
+            body->append(buffer, read);
+    }
+
+    return !ec;
+}
+
+static void evict_bodies()
+{
+    while (memory_used_ > MEMORY_BUDGET && !lru_.empty())
+    {
+        auto &entry = contents_[lru_.back()];
+        memory_used_ -= entry.body->size();
+        entry.body = nullptr;
+        entry.lru = lru_.end();
+        lru_.pop_back();
+    }
+}
+
+bool browser::get_cached_asset(const path &file, CachedAsset &asset)
+{
+    std::error_code ec;
+    int64_t size = (int64_t)std::filesystem::file_size(file, ec);
+    if (ec) return false;
+    int64_t mtime = std::filesystem::last_write_time(file, ec).time_since_epoch().count();
+    if (ec) return false;
+
+    auto key = file.u16string();
+    bool keep_body = size <= MAX_BODY_SIZE;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = paths_.find(key);
+
+        auto found = it != paths_.end() && it->second.size == size && it->second.mtime == mtime
+            ? contents_.find(it->second.hash) : contents_.end();
+
+        if (found != contents_.end())
+        {
+            auto &content = found->second;
+            if (content.body != nullptr || !keep_body)
+            {
+                if (content.body != nullptr)
+                    lru_.splice(lru_.begin(), lru_, content.lru);
+
+                asset.hash = it->second.hash;
+                asset.size = size;
+                asset.canonical = content.canonical;
+                asset.body = content.body;
+                return true;
+            }
+        }
+    }
+
+    // Read it outside the lock.
+    uint64_t hash;
+    auto body = std::make_shared<std::string>();
+    if (!hash_file(file, hash, keep_body ? body.get() : nullptr))
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &entry = paths_[key];
+
+    // Changed file, drop the old content if this path was its canonical.
+    if (entry.hash != hash)
+    {
+        auto old = contents_.find(entry.hash);
+        if (old != contents_.end() && old->second.canonical == file)
+        {
+            if (old->second.body != nullptr)
+            {
+                memory_used_ -= old->second.body->size();
+                lru_.erase(old->second.lru);
+            }
+            contents_.erase(old);
+        }
+    }
+
+    entry = PathEntry{ size, mtime, hash };
+
+    auto [it, inserted] = contents_.try_emplace(hash);
+    auto &content = it->second;
+
+    // The smallest path is canonical, it doesn't depend on request order.
+    if (inserted || file < content.canonical)
+    {
+        content.size = size;
+        content.canonical = file;
+    }
+
+    if (inserted)
+        content.lru = lru_.end();
+
+    if (keep_body && content.body == nullptr)
+    {
+        content.body = std::move(body);
+        lru_.push_front(hash);
+        content.lru = lru_.begin();
+        memory_used_ += content.body->size();
+    }
+    else if (content.body != nullptr)
+    {
+        lru_.splice(lru_.begin(), lru_, content.lru);
+    }
+
+    asset.hash = hash;
+    asset.size = size;
+    asset.canonical = content.canonical;
+    asset.body = content.body;
+
+    evict_bodies();
+    return true;
+}
+
+static bool is_under(const path &file, const path &dir)
+{
+    auto rel = file.lexically_relative(dir);
+    return !rel.empty() && *rel.begin() != "..";
+}
+
+void browser::invalidate_assets(const std::vector<path> &files)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto it = paths_.begin(); it != paths_.end(); )
+    {
+        path file = it->first;
+        bool changed = std::any_of(files.begin(), files.end(),
+            [&file](const path &dir) { return is_under(file, dir); });
+
+        if (!changed)
+        {
+            ++it;
+            continue;
+        }
+
+        // The content goes with its canonical path, others may still share it.
+        auto content = contents_.find(it->second.hash);
+        if (content != contents_.end() && content->second.canonical == file)
+        {
+            if (content->second.body != nullptr)
+            {
+                memory_used_ -= content->second.body->size();
+                lru_.erase(content->second.lru);
+            }
+            contents_.erase(content);
+        }
+
+        it = paths_.erase(it);
+    }
+}
+
+// Stream reader over a shared body, the memory is not copied.
+class SharedBodyReader : public CefRefCount<cef_stream_reader_t>
+{
+public:
+    SharedBodyReader(std::shared_ptr<const std::string> body)
+        : CefRefCount(this)
+        , body_(std::move(body))
+        , offset_(0)
+    {
+        cef_bind_method(SharedBodyReader, read);
+        cef_bind_method(SharedBodyReader, seek);
+        cef_bind_method(SharedBodyReader, tell);
+        cef_bind_method(SharedBodyReader, eof);
+        cef_bind_method(SharedBodyReader, may_block);
+    }
+
+private:
+    std::shared_ptr<const std::string> body_;
+    int64 offset_;
+
+    size_t _read(void *ptr, size_t size, size_t n)
+    {
+        size_t available = body_->size() - (size_t)offset_;
+        size_t count = std::min(n, size > 0 ? available / size : 0);
+
+        memcpy(ptr, body_->data() + offset_, count * size);
+        offset_ += (int64)(count * size);
+        return count;
+    }
+
+    int _seek(int64 offset, int whence)
+    {
+        int64 base = whence == SEEK_SET ? 0
+            : whence == SEEK_CUR ? offset_ : (int64)body_->size();
+
+        if (base + offset < 0 || base + offset > (int64)body_->size())
+            return -1;
+
+        offset_ = base + offset;
+        return 0;
+    }
+
+    int64 _tell()
+    {
+        return offset_;
+    }
+
+    int _eof()
+    {
+        return offset_ >= (int64)body_->size();
+    }
+
+    int _may_block()
+    {
+        return 0;
+    }
+};
+
+cef_stream_reader_t *browser::create_asset_reader(const CachedAsset &asset)
+{
+    return new SharedBodyReader(asset.body);
+}
+
+// Stream reader with positional reads, for files too large to keep in memory.
+class FileReader : public CefRefCount<cef_stream_reader_t>
+{
+public:
+    FileReader()
+        : CefRefCount(this)
+        , size_(0)
+        , offset_(0)
+    {
+        cef_bind_method(FileReader, read);
+        cef_bind_method(FileReader, seek);
+        cef_bind_method(FileReader, tell);
+        cef_bind_method(FileReader, eof);
+        cef_bind_method(FileReader, may_block);
+    }
+
+    bool open(const path &file)
+    {
+        std::error_code ec;
+        if (!file_.open(file, ec))
+            return false;
+
+        size_ = file_.size(ec);
+        return size_ >= 0;
+    }
+
+private:
+    file::File file_;
+    int64 size_;
+    int64 offset_;
+
+    size_t _read(void *ptr, size_t size, size_t n)
+    {
+        if (size == 0)
+            return 0;
+
+        std::error_code ec;
+        size_t available = (size_t)(size_ - offset_);
+        size_t read = file_.read_at(ptr, std::min(n, available / size) * size, offset_, ec);
+
+        offset_ += (int64)read;
+        return read / size;
+    }
+
+    int _seek(int64 offset, int whence)
+    {
+        int64 base = whence == SEEK_SET ? 0
+            : whence == SEEK_CUR ? offset_ : size_;
+
+        if (base + offset < 0 || base + offset > size_)
+            return -1;
+
+        offset_ = base + offset;
+        return 0;
+    }
+
+    int64 _tell()
+    {
+        return offset_;
+    }
+
+    int _eof()
+    {
+        return offset_ >= size_;
+    }
+
+    int _may_block()
+    {
+        return 1;
+    }
+};
+
+cef_stream_reader_t *browser::create_file_reader(const path &file)
+{
+    auto reader = new FileReader();
+    if (reader->open(file))
+        return reader;
+
+    delete reader;
+    return nullptr;
+}
@@ -42,12 +42,19 @@ static const std::unordered_set<uint32> KNOWN_ASSETS_SET
     "eot"_hash, "ttf"_hash, "otf"_hash,
 };
 
+// Larger duplicates redirect to one URL, so the browser caches them once.
+static constexpr int64_t CANONICAL_REDIRECT_SIZE = 64 * 1024;
+
 static const auto SCRIPT_IMPORT_CSS = R"(
 (async function () {
+    const url = import.meta.url.replace(/\?.*$/, '');
+    // Already injected with the theme sheet.
+    if (window[Symbol.for('pengu.styles')]?.has(url))
+        return;
+
     if (document.readyState !== 'complete')
         await new Promise(res => document.addEventListener('DOMContentLoaded', res));
 
-    const url = import.meta.url.replace(/\?.*$/, '');
     const link = document.createElement('link');
     link.setAttribute('rel', 'stylesheet');
     link.setAttribute('href', url);
@@ -83,6 +90,9 @@ public:
         , offset_(0)
         , length_(0)
         , no_cache_(false)
+        , content_hash_(0)
+        , module_(false)
+        , versioned_(false)
     {
         cef_bind_method(AssetsResourceHandler, open);
         cef_bind_method(AssetsResourceHandler, get_response_headers);
@@ -103,6 +113,173 @@ private:
     std::string range_header_;
     std::u16string mime_;
     bool no_cache_;
+    uint64_t content_hash_;
+    std::string if_none_match_;
+    std::string etag_;
+    std::u16string redirect_;
+    bool module_;
+    bool versioned_;
+
+    // UI chunks split from the preload script, loaded on first use.
+    static cef_stream_reader_t *open_builtin(const std::u16string &name)
+    {
+        if (name != u"views.js")
+            return nullptr;
+
+#ifdef _DEBUG
+        path views_path = config::loader_dir() / "../plugins/dist/views.js";
+        return cef_stream_reader_create_for_file(&CefStr::from_path(views_path));
+#else
+#   include "../../plugins/dist/views.g.h"
+        return cef_stream_reader_create_for_data((void *)_views_script, _views_script_size);
+#endif
+    }
+
+    void prepare_stream(const std::u16string &path, bool js_mime)
+    {
+        size_t pos;
+        if (stream_ != nullptr)
+        {
+            stream_->seek(stream_, 0, SEEK_END);
+            length_ = stream_->tell(stream_);
+            stream_->seek(stream_, 0, SEEK_SET);
+
+            if (js_mime)
+            {
+                // Already known JavaScript module.
+                mime_.assign(u"text/javascript");
+                no_cache_ = true;
+            }
+            else if ((pos = path.rfind(u'.')) != std::u16string::npos)
+            {
+                // Get MIME type from file extension.
+                auto ext = path.substr(pos + 1);
+                CefScopedStr type{ cef_get_mime_type(&CefStr::wrap(ext)) };
+                type.copy(mime_);
+            }
+        }
+    }
+
+    // Serve a file from the content-addressed cache.
+    void open_cached(const std::u16string &path, bool can_redirect)
+    {
+        browser::CachedAsset asset;
+        if (!browser::get_cached_asset(path, asset))
+            return;
+
+        content_hash_ = asset.hash;
+
+        // Redirect to the canonical copy, only for binary assets
+        // since relative URLs in scripts and styles depend on the location.
+        auto canonical = asset.canonical.u16string();
+        if (can_redirect && asset.size >= CANONICAL_REDIRECT_SIZE && canonical != path && is_known_asset(path))
+        {
+            browser::CachedAsset target;
+            if (browser::get_cached_asset(asset.canonical, target) && target.hash == asset.hash)
+            {
+                auto plugins_dir = config::plugins_dir().u16string();
+                if (canonical.starts_with(plugins_dir))
+                {
+                    redirect_.assign(u"https://plugins");
+                    encode_path(redirect_, canonical.substr(plugins_dir.length()));
+                    return;
+                }
+            }
+        }
+
+        if (asset.body != nullptr)
+            stream_ = browser::create_asset_reader(asset);
+        else
+            stream_ = browser::create_file_reader(path);
+
+        browser::record_asset(path);
+    }
+
+    void open_module(const std::u16string &path)
+    {
+        std::shared_ptr<const std::string> code;
+        uint64_t version;
+
+        if (browser::get_versioned_module(path, code, version))
+        {
+            module_ = true;
+            content_hash_ = version;
+            stream_ = browser::create_asset_reader(browser::CachedAsset{ version, (int64_t)code->size(), {}, code });
+            browser::record_asset(path);
+        }
+    }
+
+    // Startup bundle, revalidated like entries, or not found while it's being built.
+    bool open_bundle(bool source_map)
+    {
+        browser::StartupBundle bundle;
+        if (!browser::get_startup_bundle(bundle))
+            return false;
+
+        auto &body = source_map ? bundle.source_map : bundle.code;
+        stream_ = browser::create_asset_reader(browser::CachedAsset{ bundle.version, (int64_t)body->size(), {}, body });
+        content_hash_ = bundle.version;
+        module_ = !source_map;
+        no_cache_ = source_map;
+
+        return !source_map;
+    }
+
+    static bool is_module(const std::u16string &path)
+    {
+        return path.ends_with(u".js") || path.ends_with(u".mjs");
+    }
+
+    // `v=` is added to versioned imports.
+    static bool has_version(const std::u16string &query)
+    {
+        return query.starts_with(u"v=") || query.find(u"&v=") != std::u16string::npos;
+    }
+
+    static bool is_known_asset(const std::u16string &path)
+    {
+        size_t pos = path.rfind(u'.');
+        if (pos == std::u16string::npos)
+            return false;
+
+        auto ext = path.substr(pos + 1);
+        return KNOWN_ASSETS_SET.find(fnv32_1a(ext.c_str(), ext.length())) != KNOWN_ASSETS_SET.end();
+    }
+
+    static void encode_path(std::u16string &out, const std::u16string &path)
+    {
+        static const char hex[] = "0123456789ABCDEF";
+        auto utf8 = CefStr(path).to_utf8();
+
+        for (unsigned char c : utf8)
+        {
+            if (isalnum(c) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~' || c == '@')
+                out.push_back(c);
+            else if (c == '\\')
+                out.push_back('/');
+            else
+            {
+                out.push_back('%');
+                out.push_back(hex[c >> 4]);
+                out.push_back(hex[c & 15]);
+            }
+        }
+    }
+
+    void open_variant(std::u16string source, browser::ImageVariant variant, path output, cef_callback_t *callback)
+    {
+        base.add_ref(&base);
+        task::run([this, source = std::move(source), variant, output = std::move(output), callback]
+        {
+            // Serve the source if it can't be encoded.
+            auto file = browser::create_image_variant(source, variant, output) ? output.u16string() : source;
+            stream_ = browser::create_file_reader(file);
+            prepare_stream(file, false);
+
+            callback->cont(callback);
+            base.release(&base);
+        });
+    }
 
     int _open(cef_request_t* request, int* handle_request, cef_callback_t* callback)
     {
@@ -125,8 +302,30 @@ private:
         // Decode URI.
         decode_uri(path);
 
-        // Get final path.
-        path = config::plugins_dir().u16string().append(path);
+        CefScopedStr if_none_match{ request->get_header_by_name(request, &u"If-None-Match"_s) };
+        if (!if_none_match.empty())
+            if_none_match_.assign(if_none_match.to_utf8());
+
+        // get range header
+        CefScopedStr range{ request->get_header_by_name(request, &u"Range"_s) };
+        if (!range.empty())
+        {
+            // save it
+            range_header_.assign(range.to_utf8());
+        }
+
+        // Reserved path for built-in chunks.
+        if (path == u"/@/bundle.js" || path == u"/@/bundle.js.map")
+            js_mime = open_bundle(path.ends_with(u".map"));
+        else if (path.starts_with(u"/@/"))
+            js_mime = (stream_ = open_builtin(path.substr(3))) != nullptr;
+
+        // Get final path, shared dependencies are served from their owner plugin.
+        ::path shared;
+        if (path.starts_with(u"/@shared/") && browser::resolve_shared_path(CefStr(path.substr(9)).to_utf8(), shared))
+            path = shared.u16string();
+        else
+            path = config::plugins_dir().u16string().append(path);
 
         // Trailing slash.
         if (path[path.length() - 1] == '/' || path[path.length() - 1] == '\\')
@@ -151,7 +350,10 @@ private:
             }
         }
 
-        if (file::is_file(path))
+        // One spelling per file, like import targets and watcher paths.
+        path = ::path(path).lexically_normal().u16string();
+
+        if (stream_ == nullptr && file::is_file(path))
         {
             const char *module_code = nullptr;
             if (request->get_resource_type(request) == RT_SCRIPT)
@@ -172,45 +374,42 @@ private:
                 }
             }
 
+            browser::ImageVariant variant;
+
             if (module_code != nullptr)
             {
                 js_mime = true;
                 stream_ = cef_stream_reader_create_for_data((void *)module_code, strlen(module_code));
             }
-            else
+            else if (is_module(path))
             {
-                stream_ = cef_stream_reader_create_for_file(&CefStr::wrap(path));
+                js_mime = true;
+                versioned_ = has_version(query_part);
+                open_module(path);
             }
-        }
-
-        if (stream_ != nullptr)
-        {
-            stream_->seek(stream_, 0, SEEK_END);
-            length_ = stream_->tell(stream_);
-            stream_->seek(stream_, 0, SEEK_SET);
-
-            if (js_mime)
+            else if (browser::parse_image_query(path, query_part, variant))
             {
-                // Already known JavaScript module.
-                mime_.assign(u"text/javascript");
-                no_cache_ = true;
+                auto output = browser::get_image_variant_path(path, variant);
+                if (file::is_file(output))
+                {
+                    path = output.u16string();
+                    stream_ = browser::create_file_reader(path);
+                }
+                else
+                {
+                    // Encode it on the task pool, continue later.
+                    open_variant(path, variant, output, callback);
+                    *handle_request = 0;
+                    return 1;
+                }
             }
-            else if ((pos = path.rfind(u'.')) != std::u16string::npos)
+            else
             {
-                // Get MIME type from file extension.
-                auto ext = path.substr(pos + 1);
-                CefScopedStr type{ cef_get_mime_type(&CefStr::wrap(ext)) };
-                type.copy(mime_);
+                open_cached(path, query_part.empty() && request->get_resource_type(request) != RT_SCRIPT);
             }
         }
 
-        // get range header
-        CefScopedStr range{ request->get_header_by_name(request, &u"Range"_s) };
-        if (!range.empty())
-        {
-            // save it
-            range_header_.assign(range.to_utf8());
-        }
+        prepare_stream(path, js_mime);
 
         *handle_request = 1;
         //callback->cont(callback);
@@ -221,6 +420,20 @@ private:
     {
         response->set_header_by_name(response, &u"Access-Control-Allow-Origin"_s, &u"*"_s, 1);
 
+        if (!redirect_.empty())
+        {
+            response->set_status(response, 307);
+            response->set_header_by_name(response, &u"Location"_s, &CefStr::wrap(redirect_), 1);
+            // The canonical copy may be edited or removed later.
+            response->set_header_by_name(response, &u"Cache-Control"_s, &u"no-cache"_s, 1);
+
+            if (redirectUrl != nullptr)
+                cef_string_set((const char16 *)redirect_.data(), redirect_.length(), redirectUrl, 1);
+
+            *response_length = 0;
+            return;
+        }
+
         // File not found.
         if (stream_ == nullptr)
         {
@@ -238,14 +451,30 @@ private:
             if (!mime_.empty())
                 response->set_mime_type(response, &CefStr::wrap(mime_));
 
-            if (no_cache_ || mime_ == u"text/javascript")
+            if (module_ && !versioned_)
+            {
+                // Entry modules are revalidated, their imports are versioned.
+                response->set_header_by_name(response, &u"Cache-Control"_s, &u"no-cache"_s, 1);
+                set_etag(response);
+            }
+            else if (!module_ && (no_cache_ || mime_ == u"text/javascript"))
+            {
                 response->set_header_by_name(response, &u"Cache-Control"_s, &u"no-store"_s, 1);
+            }
             else
             {
                 response->set_header_by_name(response, &u"Cache-Control"_s, &u"max-age=31536000, immutable"_s, 1);
                 set_etag(response);
             }
 
+            if (!etag_.empty() && if_none_match_ == etag_)
+            {
+                response->set_status(response, 304);
+                response->set_status_text(response, &u"Not Modified"_s);
+                *response_length = 0;
+                return;
+            }
+
             if (!range_header_.empty())
             {
                 std::string contentRange;
@@ -361,13 +590,24 @@ private:
         return true;
     }
 
-    static void set_etag(cef_response_t *response)
+    // Content hash for cached files, identical files share it.
+    void set_etag(cef_response_t *response)
     {
-        CefScopedStr url = response->get_url(response);
-        uint32_t hash = fnv32_1a(url.str, url.length);
-
         char etag[64];
-        size_t etag_length = snprintf(etag, sizeof(etag) - 1, "\"%08x\"", hash);
+        size_t etag_length;
+
+        if (content_hash_ != 0)
+        {
+            etag_length = snprintf(etag, sizeof(etag) - 1, "\"%016llx\"", (unsigned long long)content_hash_);
+        }
+        else
+        {
+            CefScopedStr url = response->get_url(response);
+            uint32_t hash = fnv32_1a(url.str, url.length);
+            etag_length = snprintf(etag, sizeof(etag) - 1, "\"%08x\"", hash);
+        }
+
+        etag_.assign(etag, etag_length);
 
         auto name = u"ETag"_s;
         CefStr value{ etag, etag_length };
@@ -400,6 +640,10 @@ struct AssetsSchemeHandlerFactory : CefRefCount<cef_scheme_handler_factory_t>
         const cef_string_t* scheme_name,
         struct _cef_request_t* request)
     {
+        CefScopedStr url{ request->get_url(request) };
+        if (url.to_utf16() == u"https://plugins/@/batch")
+            return browser::create_batch_handler(frame);
+
         return new AssetsResourceHandler();
     }
 };
@@ -411,4 +655,7 @@ void browser::register_plugins_domain(cef_request_context_t *ctx)
     auto factory = new AssetsSchemeHandlerFactory();
 
     ctx->register_scheme_handler_factory(ctx, &scheme, &domain, factory);
+
+    // Link it before the first page load.
+    build_startup_bundle();
 }
\ No newline at end of file
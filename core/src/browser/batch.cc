@@ -0,0 +1,334 @@
+#include "browser.h"
+#include "coro.h"
+#include "include/capi/cef_parser_capi.h"
+
+// BROWSER PROCESS ONLY.
+
+// POST https://plugins/@/batch
+// [{ "method": "GET", "uri": "/lol-summoner/v1/current-summoner" }, { "uri": "https://riotclient/..." }]
+//
+// Plugins fire bursts of small requests at startup, each one pays the whole
+// renderer request pipeline. A batch is one request, its items run here
+// concurrently, and results are streamed back as NDJSON lines in completion
+// order: {"id":0,"status":200,"body":"..."}
+//
+// Relative URIs go to the LCU from the page's frame, with the page's credentials.
+// https://riotclient/ URIs go to the Riot Client with its own credentials.
+
+static constexpr size_t MAX_ITEMS = 64;
+static constexpr size_t MAX_BATCH_BODY = 64 * 1024;
+
+static void append_json_string(std::string &out, const std::string &value)
+{
+    static const char HEX[] = "0123456789abcdef";
+
+    out.push_back('"');
+    for (unsigned char c : value)
+    {
+        switch (c)
+        {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (c < 0x20)
+                {
+                    out.append("\\u00");
+                    out.push_back(HEX[c >> 4]);
+                    out.push_back(HEX[c & 15]);
+                }
+                else
+                {
+                    out.push_back((char)c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+static std::string read_post_data(cef_request_t *request)
+{
+    std::string data;
+
+    auto post_data = request->get_post_data(request);
+    if (post_data == nullptr)
+        return data;
+
+    size_t count = post_data->get_element_count(post_data);
+    std::vector<cef_post_data_element_t *> elements(count);
+    post_data->get_elements(post_data, &count, elements.data());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        auto element = elements[i];
+        size_t size = element->get_bytes_count(element);
+
+        if (element->get_type(element) == PDE_TYPE_BYTES && data.length() + size <= MAX_BATCH_BODY)
+        {
+            size_t offset = data.length();
+            data.resize(offset + size);
+            element->get_bytes(element, size, &data[offset]);
+        }
+
+        element->base.release(&element->base);
+    }
+
+    post_data->base.release(&post_data->base);
+    return data;
+}
+
+static std::string get_string(cef_dictionary_value_t *dict, const cef_string_t *key)
+{
+    if (dict->get_type(dict, key) != VTYPE_STRING)
+        return "";
+
+    CefScopedStr value{ dict->get_string(dict, key) };
+    return value.to_utf8();
+}
+
+// Scheme, host and port of the frame URL.
+static std::string get_origin(cef_frame_t *frame)
+{
+    CefScopedStr url{ frame->get_url(frame) };
+    auto str = url.to_utf8();
+
+    size_t start = str.find("://");
+    if (start == std::string::npos)
+        return "";
+
+    size_t end = str.find('/', start + 3);
+    return str.substr(0, end);
+}
+
+struct BatchResourceHandler : CefRefCount<cef_resource_handler_t>
+{
+    BatchResourceHandler(cef_frame_t *frame)
+        : CefRefCount(this), frame_(frame), remaining_(0), bytes_read_(0), status_(200), canceled_(false),
+          pending_out_(nullptr), pending_length_(0), pending_callback_(nullptr)
+    {
+        cef_bind_method(BatchResourceHandler, open);
+        cef_bind_method(BatchResourceHandler, get_response_headers);
+        cef_bind_method(BatchResourceHandler, read);
+        cef_bind_method(BatchResourceHandler, cancel);
+    }
+
+    ~BatchResourceHandler()
+    {
+        for (auto request : requests_)
+            request->base.release(&request->base);
+
+        if (frame_ != nullptr)
+            frame_->base.release(&frame_->base);
+    }
+
+private:
+    cef_frame_t *frame_;    // owned
+    std::vector<coro::UrlRequest *> requests_;
+    size_t remaining_;
+
+    std::string output_;
+    size_t bytes_read_;
+    int status_;
+    bool canceled_;
+
+    // A read waiting for more results.
+    void *pending_out_;
+    int pending_length_;
+    cef_resource_read_callback_t *pending_callback_;
+
+    int _open(struct _cef_request_t *request, int *handle_request, struct _cef_callback_t *callback)
+    {
+        *handle_request = 1;
+
+        CefScopedStr method{ request->get_method(request) };
+        if (method.to_utf8() != "POST" || frame_ == nullptr)
+        {
+            status_ = 405;
+            return 1;
+        }
+
+        auto body = read_post_data(request);
+        CefStr json{ body.data(), body.length() };
+
+        auto value = cef_parse_json(&json, JSON_PARSER_RFC);
+        if (value == nullptr || value->get_type(value) != VTYPE_LIST)
+        {
+            if (value != nullptr)
+                value->base.release(&value->base);
+
+            status_ = 400;
+            return 1;
+        }
+
+        auto list = value->get_list(value);
+        auto origin = get_origin(frame_);
+        size_t count = std::min(list->get_size(list), MAX_ITEMS);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            std::string item_method = "GET", uri;
+            if (list->get_type(list, i) == VTYPE_DICTIONARY)
+            {
+                auto item = list->get_dictionary(list, i);
+                uri = get_string(item, &u"uri"_s);
+
+                auto m = get_string(item, &u"method"_s);
+                if (!m.empty())
+                    item_method = std::move(m);
+
+                item->base.release(&item->base);
+            }
+
+            start_item((int)i, item_method, uri, origin);
+        }
+
+        list->base.release(&list->base);
+        value->base.release(&value->base);
+        return 1;
+    }
+
+    void start_item(int id, const std::string &method, const std::string &uri, const std::string &origin)
+    {
+        cef_request_t *request = nullptr;
+        CefStr method_str{ method };
+
+        if (uri.starts_with("https://riotclient/"))
+        {
+            if (config::options::use_riotclient())
+                request = browser::create_riotclient_request(CefStr(uri).to_utf16(), &method_str, nullptr, nullptr);
+        }
+        else if (uri.starts_with("/") && !uri.starts_with("//"))
+        {
+            auto url = CefStr(origin + uri);
+            request = cef_request_create();
+            request->set(request, &url, &method_str, nullptr, nullptr);
+        }
+
+        if (request == nullptr)
+        {
+            add_result(id, 0, "unsupported uri");
+            return;
+        }
+
+        auto url_request = coro::UrlRequest::create(frame_, request);
+        requests_.push_back(url_request);
+        remaining_++;
+
+        wait_item(id, url_request);
+    }
+
+    coro::detached wait_item(int id, coro::UrlRequest *request)
+    {
+        base.add_ref(&base);
+        co_await request->complete();
+
+        remaining_--;
+        if (!canceled_)
+        {
+            auto response = request->get_response();
+            int status = response != nullptr && request->status() == UR_SUCCESS
+                ? response->get_status(response) : 0;
+
+            add_result(id, status, request->body());
+        }
+
+        base.release(&base);
+    }
+
+    void add_result(int id, int status, const std::string &body)
+    {
+        output_.append("{\"id\":").append(std::to_string(id));
+        output_.append(",\"status\":").append(std::to_string(status));
+        output_.append(",\"body\":");
+        append_json_string(output_, body);
+        output_.append("}\n");
+
+        flush_pending();
+    }
+
+    void _get_response_headers(struct _cef_response_t *response, int64 *response_length, cef_string_t *redirectUrl)
+    {
+        response->set_status(response, status_);
+        response->set_mime_type(response, &u"application/x-ndjson"_s);
+        response->set_header_by_name(response, &u"Access-Control-Allow-Origin"_s, &u"*"_s, 1);
+        response->set_header_by_name(response, &u"Cache-Control"_s, &u"no-store"_s, 1);
+
+        // Streamed, results arrive in completion order.
+        *response_length = status_ == 200 ? -1 : 0;
+    }
+
+    int _read(void *data_out, int bytes_to_read, int *bytes_read, cef_resource_read_callback_t *callback)
+    {
+        *bytes_read = copy_data(data_out, bytes_to_read);
+
+        if (*bytes_read > 0)
+            return 1;
+
+        if (remaining_ == 0 || status_ != 200)
+            return 0;
+
+        // Wait for more results, data_out stays valid until the callback.
+        pending_out_ = data_out;
+        pending_length_ = bytes_to_read;
+        pending_callback_ = callback;
+        base.add_ref(&base);
+        return 1;
+    }
+
+    void flush_pending()
+    {
+        if (pending_callback_ == nullptr)
+            return;
+
+        int read = copy_data(pending_out_, pending_length_);
+        if (read == 0 && remaining_ > 0)
+            return;
+
+        auto callback = pending_callback_;
+        pending_callback_ = nullptr;
+
+        // Zero bytes completes the response.
+        if (!canceled_)
+            callback->cont(callback, read);
+
+        base.release(&base);
+    }
+
+    void _cancel()
+    {
+        canceled_ = true;
+        for (auto request : requests_)
+            request->cancel();
+
+        // The last completion would flush, but not after a cancel.
+        if (pending_callback_ != nullptr)
+        {
+            pending_callback_ = nullptr;
+            base.release(&base);
+        }
+    }
+
+    int copy_data(void *data_out, int bytes_to_read)
+    {
+        int read = (int)std::min<size_t>(bytes_to_read, output_.length() - bytes_read_);
+
+        memcpy(data_out, output_.c_str() + bytes_read_, read);
+        bytes_read_ += read;
+
+        // Compact once everything was read.
+        if (bytes_read_ == output_.length())
+        {
+            output_.clear();
+            bytes_read_ = 0;
+        }
+
+        return read;
+    }
+};
+
+cef_resource_handler_t *browser::create_batch_handler(cef_frame_t *frame)
+{
+    return new BatchResourceHandler(frame);
+}
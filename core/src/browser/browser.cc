@@ -196,6 +196,8 @@ static void CEF_CALLBACK Hooked_OnBeforeCommandLineProcessing(
         command_line->append_switch(command_line, &u"disable-smooth-scrolling"_s);
         command_line->append_switch(command_line, &u"wm-window-animations-disabled"_s);
         command_line->append_switch_with_value(command_line, &u"animation-duration-scale"_s, &u"0"_s);
+        // Reduced motion for Blink and the client CSS media queries.
+        command_line->append_switch(command_line, &u"force-prefers-reduced-motion"_s);
     }
 
     command_line->base.release(&command_line->base);
@@ -231,6 +233,30 @@ static int Hooked_CefInitialize(const struct _cef_main_args_t* args,
     //    return handler;
     //};
 
+    // Warm libcef and the asset cache while CEF starts.
+    browser::prefetch_startup();
+    browser::prefetch_assets();
+
+    // Plugin edits are served without a client restart.
+    watcher::subscribe(config::plugins_dir(), [](const std::vector<path> &files)
+    {
+        browser::invalidate_assets(files);
+        browser::invalidate_modules(files);
+        browser::build_startup_bundle();
+    });
+
+    watcher::subscribe(config::loader_dir(), [](const std::vector<path> &files)
+    {
+        auto config_file = config::loader_dir() / "config";
+        if (std::find(files.begin(), files.end(), config_file) != files.end()
+            || std::find(files.begin(), files.end(), config::loader_dir()) != files.end())
+        {
+            // Disabled plugins are left out of the bundle.
+            config::reload();
+            browser::build_startup_bundle();
+        }
+    });
+
     return CefInitialize(args, settings, app, windows_sandbox_info);
 }
 
@@ -3,6 +3,8 @@
 #include "include/capi/cef_browser_capi.h"
 #include "include/capi/cef_frame_capi.h"
 #include "include/capi/cef_request_context_capi.h"
+#include "include/capi/cef_resource_handler_capi.h"
+#include "include/capi/cef_stream_capi.h"
 
 namespace browser
 {
@@ -14,5 +16,142 @@ namespace browser
     void register_riotclient_domain(cef_request_context_t *ctx);
     void set_riotclient_credentials(const char *port, const char *token);
 
+    ///
+    /// Create a request to the Riot Client with its credentials.
+    /// @param url A `https://riotclient/` URL.
+    /// @param body Post data or null, the reference is taken.
+    ///
+    cef_request_t *create_riotclient_request(const std::u16string &url, const cef_string_t *method,
+        cef_post_data_t *body, cef_string_multimap_t headers);
+
+    ///
+    /// Create the handler of the reserved `https://plugins/@/batch` endpoint.
+    /// It runs a list of LCU and Riot Client requests concurrently and streams
+    /// their results back as NDJSON.
+    ///
+    cef_resource_handler_t *create_batch_handler(cef_frame_t *frame);
+
     void register_plugins_domain(cef_request_context_t *ctx);
+
+    struct CachedAsset
+    {
+        uint64_t hash;
+        int64_t size;
+        path canonical;                             // first of the identical files by path order
+        std::shared_ptr<const std::string> body;    // null if it's too large to keep in memory
+    };
+
+    ///
+    /// Look up a file in the content-addressed asset cache, reading it on a miss.
+    /// @returns false if the file can't be read.
+    ///
+    bool get_cached_asset(const path &file, CachedAsset &asset);
+
+    ///
+    /// Create a stream reader over a cached body without copying it.
+    ///
+    cef_stream_reader_t *create_asset_reader(const CachedAsset &asset);
+
+    ///
+    /// Create a stream reader with positional reads of a file, it's not loaded in memory.
+    /// @returns null if the file can't be opened.
+    ///
+    cef_stream_reader_t *create_file_reader(const path &file);
+
+    ///
+    /// Drop cached files under changed paths.
+    /// @param files Changed files or dirs.
+    ///
+    void invalidate_assets(const std::vector<path> &files);
+
+    ///
+    /// Record a plugin file served in this session, it's prefetched on the next launch.
+    ///
+    void record_asset(const path &file);
+
+    ///
+    /// Read the files served in the last session into the asset cache, on the task pool.
+    ///
+    void prefetch_assets();
+
+    ///
+    /// Page in libcef, the embedded preload and the datastore on the task pool.
+    /// Called from CefInitialize, DllMain holds the loader lock. The page cache
+    /// is shared, renderers get them warm too.
+    ///
+    void prefetch_startup();
+
+    ///
+    /// Get a JS module with its relative imports rewritten to versioned URLs.
+    /// @param code Output module code, shared with the module cache.
+    /// @param version Output version, a hash of the content and the imported versions.
+    /// @returns false if the file can't be read.
+    ///
+    bool get_versioned_module(const path &file, std::shared_ptr<const std::string> &code, uint64_t &version);
+
+    ///
+    /// Resolve an import specifier of a module in `dir` to a JS file in the plugins dir.
+    /// @param url Output `https://plugins/@shared/` URL if the file is a shared dependency, or empty.
+    /// @returns false if it's not a local JS module.
+    ///
+    bool resolve_import(const path &dir, const std::string &spec, path &target, std::string &url);
+
+    ///
+    /// Map a shared dependency URL to its file.
+    /// @param rest Decoded path after `/@shared/`, e.g `solid-js@1.7.8/web.js`.
+    /// @returns false if no shared dependency matches.
+    ///
+    bool resolve_shared_path(const std::string &rest, path &file);
+
+    ///
+    /// Drop cached modules under changed paths, everything if files were added or removed.
+    /// @param files Changed files or dirs.
+    ///
+    void invalidate_modules(const std::vector<path> &files);
+
+    struct StartupBundle
+    {
+        uint64_t version;
+        std::shared_ptr<const std::string> code;
+        std::shared_ptr<const std::string> source_map;
+    };
+
+    ///
+    /// Mark the startup bundle out of date and link it again on the task pool,
+    /// called by the plugins watcher. A build in progress links once more.
+    ///
+    void build_startup_bundle();
+
+    ///
+    /// Get the startup bundle, without touching the plugins folder.
+    /// @returns false if it's not built or out of date, plugins are loaded per-module then.
+    ///
+    bool get_startup_bundle(StartupBundle &bundle);
+
+    struct ImageVariant
+    {
+        enum Format { PNG, JPEG };
+
+        int width = 0;      // 0 keeps the ratio
+        int height = 0;
+        int quality = 0;    // JPEG only, 0 for default
+        Format format = PNG;
+    };
+
+    ///
+    /// Parse image variant parameters (w, h, q, format) of a PNG/JPEG URL.
+    /// @returns false if the path isn't an image or there's no variant parameter.
+    ///
+    bool parse_image_query(const std::u16string &path, const std::u16string &query, ImageVariant &variant);
+
+    ///
+    /// Get the cache file of an image variant, keyed by source identity and parameters.
+    ///
+    path get_image_variant_path(const path &source, const ImageVariant &variant);
+
+    ///
+    /// Decode, resize and encode a variant to `output`, slow, call it on the task pool.
+    /// @returns true if success.
+    ///
+    bool create_image_variant(const path &source, const ImageVariant &variant, const path &output);
 }
\ No newline at end of file
@@ -0,0 +1,1219 @@
+#include "browser.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+// BROWSER PROCESS ONLY.
+
+// Startup bundle, the module graphs of enabled plugins are linked into one
+// script at https://plugins/@/bundle.js, so the loader makes one request and
+// V8 compiles one unit instead of a few hundred.
+// Modules are wrapped in async functions, imports read the namespaces of
+// their dependencies and exports become getters on the module namespace.
+// Importers read bindings once the dependency has run, so plugins using what
+// can't be linked (cycles, destructured or reassigned exports, import
+// attributes) are left out and loaded per-module by the preload.
+
+enum TokenType
+{
+    T_IDENT,
+    T_STRING,
+    T_TEMPLATE,
+    T_REGEX,
+    T_NUMBER,
+    T_PUNCT,
+};
+
+struct Token
+{
+    TokenType type;
+    size_t begin;
+    size_t end;
+    int depth;          // bracket depth, closing brackets have the depth of their opening
+    bool newline;       // a line break precedes it
+};
+
+struct Edit
+{
+    size_t begin;
+    size_t end;
+    std::string text;
+};
+
+struct Module
+{
+    path file;
+    std::string url;
+    bool ok = false;
+
+    std::string source;
+    std::vector<Edit> edits;
+    std::string header;             // bindings, evaluated before the body
+    std::vector<size_t> deps;       // static imports, evaluated first
+    std::vector<size_t> lazy;       // dynamic imports
+};
+
+struct Bundle
+{
+    uint64_t version;
+    std::shared_ptr<const std::string> code;
+    std::shared_ptr<const std::string> source_map;
+};
+
+static std::mutex mutex_;
+static std::shared_ptr<const Bundle> bundle_;
+static bool building_ = false;
+static bool stale_ = true;         // plugins changed since the bundle was linked
+
+static uint64_t fnv64_1a(const void *data, size_t length, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= static_cast<const uint8_t *>(data)[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static bool is_ident(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '$' || (unsigned char)c >= 0x80;
+}
+
+class Tokenizer
+{
+public:
+    Tokenizer(const std::string &code, std::vector<Token> &tokens)
+        : code_(code), tokens_(tokens), i_(0), newline_(false) {}
+
+    // false on unbalanced brackets or unterminated literals.
+    bool run()
+    {
+        size_t n = code_.length();
+        while (i_ < n)
+        {
+            char c = code_[i_];
+
+            if (c == '\n')
+            {
+                newline_ = true;
+                i_++;
+            }
+            else if (isspace((unsigned char)c))
+            {
+                i_++;
+            }
+            else if (c == '/' && i_ + 1 < n && code_[i_ + 1] == '/')
+            {
+                size_t end = code_.find('\n', i_);
+                i_ = end == std::string::npos ? n : end;
+            }
+            else if (c == '/' && i_ + 1 < n && code_[i_ + 1] == '*')
+            {
+                size_t end = code_.find("*/", i_ + 2);
+                if (end == std::string::npos)
+                    return false;
+                if (memchr(code_.data() + i_, '\n', end - i_) != nullptr)
+                    newline_ = true;
+                i_ = end + 2;
+            }
+            else if (c == '"' || c == '\'')
+            {
+                size_t j = i_ + 1;
+                while (j < n && code_[j] != c)
+                {
+                    if (code_[j] == '\n')
+                        return false;
+                    j += code_[j] == '\\' ? 2 : 1;
+                }
+                if (j >= n)
+                    return false;
+                push(T_STRING, i_, j + 1);
+                i_ = j + 1;
+            }
+            else if (c == '`')
+            {
+                if (!scan_template(i_, i_ + 1))
+                    return false;
+            }
+            else if (isdigit((unsigned char)c) || (c == '.' && i_ + 1 < n && isdigit((unsigned char)code_[i_ + 1])))
+            {
+                size_t j = i_ + 1;
+                while (j < n && (is_ident(code_[j]) || code_[j] == '.')) j++;
+                push(T_NUMBER, i_, j);
+                i_ = j;
+            }
+            else if (is_ident(c) || (c == '#' && i_ + 1 < n && is_ident(code_[i_ + 1])))
+            {
+                size_t j = i_ + 1;
+                while (j < n && is_ident(code_[j])) j++;
+                push(T_IDENT, i_, j);
+                i_ = j;
+            }
+            else if (c == '/' && regex_allowed())
+            {
+                bool in_class = false;
+                size_t j = i_ + 1;
+                for (; j < n && code_[j] != '\n'; j++)
+                {
+                    if (code_[j] == '\\') j++;
+                    else if (code_[j] == '[') in_class = true;
+                    else if (code_[j] == ']') in_class = false;
+                    else if (code_[j] == '/' && !in_class) break;
+                }
+                if (j >= n || code_[j] != '/')
+                    return false;
+                for (j++; j < n && is_ident(code_[j]); j++);
+                push(T_REGEX, i_, j);
+                i_ = j;
+            }
+            else if (c == '(' || c == '[' || c == '{')
+            {
+                push(T_PUNCT, i_, i_ + 1);
+                stack_.push_back(c);
+                i_++;
+            }
+            else if (c == ')' || c == ']' || c == '}')
+            {
+                if (stack_.empty())
+                    return false;
+
+                char open = stack_.back();
+                stack_.pop_back();
+
+                // End of a template substitution.
+                if (c == '}' && open == '`')
+                {
+                    if (!scan_template(i_, i_ + 1))
+                        return false;
+                    continue;
+                }
+
+                if (open != (c == ')' ? '(' : c == ']' ? '[' : '{'))
+                    return false;
+
+                push(T_PUNCT, i_, i_ + 1);
+                i_++;
+            }
+            else
+            {
+                push(T_PUNCT, i_, i_ + 1);
+                i_++;
+            }
+        }
+
+        return stack_.empty();
+    }
+
+private:
+    const std::string &code_;
+    std::vector<Token> &tokens_;
+    std::vector<char> stack_;
+    size_t i_;
+    bool newline_;
+
+    void push(TokenType type, size_t begin, size_t end)
+    {
+        tokens_.push_back(Token{ type, begin, end, (int)stack_.size(), newline_ });
+        newline_ = false;
+    }
+
+    // A template chunk from ` or } to ${ or `.
+    bool scan_template(size_t start, size_t j)
+    {
+        size_t n = code_.length();
+        while (j < n && code_[j] != '`')
+        {
+            if (code_[j] == '\\')
+                j += 2;
+            else if (code_[j] == '$' && j + 1 < n && code_[j + 1] == '{')
+            {
+                push(T_TEMPLATE, start, j + 2);
+                stack_.push_back('`');
+                i_ = j + 2;
+                return true;
+            }
+            else
+                j++;
+        }
+
+        if (j >= n)
+            return false;
+
+        push(T_TEMPLATE, start, j + 1);
+        i_ = j + 1;
+        return true;
+    }
+
+    bool regex_allowed() const
+    {
+        if (tokens_.empty())
+            return true;
+
+        const auto &last = tokens_.back();
+        if (last.type == T_PUNCT)
+            return code_[last.begin] != ')' && code_[last.begin] != ']';
+
+        if (last.type == T_IDENT)
+        {
+            auto word = std::string_view(code_).substr(last.begin, last.end - last.begin);
+            return word == "return" || word == "typeof" || word == "case" || word == "in"
+                || word == "of" || word == "yield" || word == "await" || word == "void"
+                || word == "delete" || word == "instanceof" || word == "new" || word == "throw"
+                || word == "else" || word == "do";
+        }
+
+        return false;
+    }
+};
+
+static void append_js_string(std::string &out, const std::string &str)
+{
+    out.push_back('"');
+    for (unsigned char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out.push_back('\\');
+            out.push_back((char)c);
+        }
+        else if (c < 0x20)
+        {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\u%04x", c);
+            out.append(hex);
+        }
+        else
+            out.push_back((char)c);
+    }
+    out.push_back('"');
+}
+
+static void append_encoded(std::string &out, const std::string &str)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    for (unsigned char c : str)
+    {
+        if (isalnum(c) || strchr("/-_.~@", c) != nullptr)
+            out.push_back((char)c);
+        else
+        {
+            out.push_back('%');
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 15]);
+        }
+    }
+}
+
+class Linker
+{
+public:
+    std::deque<Module> modules;
+
+    // Add a module and its graph, returns its id.
+    size_t add(const path &file, const std::string &url)
+    {
+        auto key = file.u16string();
+        auto it = ids_.find(key);
+        if (it != ids_.end())
+            return it->second;
+
+        size_t id = modules.size();
+        ids_.emplace(key, id);
+
+        auto &module = modules.emplace_back();
+        module.file = file;
+        module.url = url;
+        module.ok = parse(module);
+
+        return id;
+    }
+
+private:
+    std::unordered_map<std::u16string, size_t> ids_;
+
+    const std::string *code_;
+    const std::vector<Token> *tokens_;
+
+    std::string text(size_t k) const
+    {
+        const auto &t = (*tokens_)[k];
+        return code_->substr(t.begin, t.end - t.begin);
+    }
+
+    bool is(size_t k, const char *word) const
+    {
+        return k < tokens_->size() && (*tokens_)[k].type == T_IDENT && text(k) == word;
+    }
+
+    bool punct(size_t k, char c) const
+    {
+        return k < tokens_->size() && (*tokens_)[k].type == T_PUNCT && (*code_)[(*tokens_)[k].begin] == c;
+    }
+
+    bool type(size_t k, TokenType type) const
+    {
+        return k < tokens_->size() && (*tokens_)[k].type == type;
+    }
+
+    // Index of the closing bracket of the opening one at `k`.
+    size_t find_close(size_t k) const
+    {
+        int depth = (*tokens_)[k].depth;
+        for (size_t j = k + 1; j < tokens_->size(); j++)
+            if ((*tokens_)[j].depth <= depth)
+                return j;
+        return tokens_->size();
+    }
+
+    // Specifier of a string token, without escapes.
+    bool get_specifier(size_t k, std::string &spec) const
+    {
+        spec = text(k);
+        spec = spec.substr(1, spec.length() - 2);
+        return spec.find('\\') == std::string::npos;
+    }
+
+    // Import attributes change how a module is loaded, leave it to the browser.
+    bool has_attributes(size_t k) const
+    {
+        return (is(k, "with") || is(k, "assert")) && !(*tokens_)[k].newline && punct(k + 1, '{');
+    }
+
+    // Whether a line break at `k` ends the statement.
+    bool ends_statement(size_t k) const
+    {
+        const auto &prev = (*tokens_)[k - 1];
+        const auto &next = (*tokens_)[k];
+
+        if (prev.type == T_PUNCT && strchr("=+-*/%&|^<>!?:,.~", (*code_)[prev.begin]) != nullptr)
+            return false;
+        if (prev.type == T_IDENT && (is(k - 1, "new") || is(k - 1, "typeof") || is(k - 1, "void")
+            || is(k - 1, "delete") || is(k - 1, "await") || is(k - 1, "yield")))
+            return false;
+        if (next.type == T_PUNCT && strchr(".,?:+-*/%&|^=<>[(", (*code_)[next.begin]) != nullptr)
+            return false;
+        if (next.type == T_TEMPLATE || is(k, "in") || is(k, "instanceof"))
+            return false;
+
+        return true;
+    }
+
+    bool adjacent(size_t k) const
+    {
+        return k + 1 < tokens_->size() && (*tokens_)[k].end == (*tokens_)[k + 1].begin;
+    }
+
+    // Whether an assignment operator starts at `k`, compound ones included.
+    bool is_assignment(size_t k) const
+    {
+        size_t j = k;
+        while (type(j, T_PUNCT) && strchr("+-*/%&|^<>?", (*code_)[(*tokens_)[j].begin]) != nullptr && adjacent(j))
+            j++;
+
+        if (!punct(j, '='))
+            return false;
+        if (j - k == 1 && (punct(k, '<') || punct(k, '>')))
+            return false;
+
+        return !(adjacent(j) && (punct(j + 1, '=') || punct(j + 1, '>')));
+    }
+
+    // Whether the identifier at `k` is incremented or decremented.
+    bool is_update(size_t k) const
+    {
+        for (char c : { '+', '-' })
+        {
+            if (k >= 2 && punct(k - 2, c) && punct(k - 1, c) && adjacent(k - 2))
+                return true;
+            if (punct(k + 1, c) && punct(k + 2, c) && adjacent(k + 1) && !(*tokens_)[k + 1].newline)
+                return true;
+        }
+        return false;
+    }
+
+    bool is_open(size_t k) const
+    {
+        const auto &t = (*tokens_)[k];
+        if (t.type == T_TEMPLATE)
+            return (*code_)[t.end - 1] == '{';
+        return punct(k, '(') || punct(k, '[') || punct(k, '{');
+    }
+
+    // Declared names of the let, const or var at `k`, false on destructuring patterns.
+    bool get_declarators(size_t k, std::vector<size_t> &names) const
+    {
+        int depth = (*tokens_)[k].depth;
+        size_t d = k + 1;
+
+        while (true)
+        {
+            if (!type(d, T_IDENT))
+                return false;
+            names.push_back(d++);
+
+            if (punct(d, '='))
+            {
+                for (d++; d < tokens_->size(); d++)
+                {
+                    const auto &t = (*tokens_)[d];
+                    if (t.depth == depth && (punct(d, ',') || punct(d, ';')))
+                        break;
+                    if (t.depth == depth && t.newline && ends_statement(d))
+                        break;
+                }
+            }
+
+            if (!punct(d, ','))
+                return true;
+            d++;
+        }
+    }
+
+    // Whether any of the exported locals is assigned outside its declaration.
+    // Shadowing locals count too, the module is just left unlinked then.
+    bool reassigns(const std::vector<std::string> &locals) const
+    {
+        const auto &tokens = *tokens_;
+        std::vector<size_t> close(tokens.size(), tokens.size()), open;
+        std::vector<bool> declared(tokens.size(), false);
+
+        for (size_t k = 0; k < tokens.size(); k++)
+        {
+            while (open.size() > (size_t)tokens[k].depth)
+            {
+                close[open.back()] = k;
+                open.pop_back();
+            }
+            if (is_open(k))
+                open.push_back(k);
+
+            if ((is(k, "let") || is(k, "const") || is(k, "var")) && !(k > 0 && punct(k - 1, '.')))
+            {
+                std::vector<size_t> names;
+                get_declarators(k, names);
+                for (size_t n : names) declared[n] = true;
+            }
+        }
+
+        open.clear();
+        for (size_t k = 0; k < tokens.size(); k++)
+        {
+            open.resize(tokens[k].depth);
+
+            if (tokens[k].type == T_IDENT && !declared[k] && !(k > 0 && punct(k - 1, '.'))
+                && std::find(locals.begin(), locals.end(), text(k)) != locals.end())
+            {
+                if (is_assignment(k + 1) || is_update(k))
+                    return true;
+
+                // for (x of ...)
+                if ((is(k + 1, "of") || is(k + 1, "in")) && punct(k - 1, '(')
+                    && (is(k - 2, "for") || (is(k - 2, "await") && is(k - 3, "for"))))
+                    return true;
+
+                // Destructuring assignments, [x] = ... or ({ x } = ...).
+                for (size_t o : open)
+                    if ((punct(o, '[') || punct(o, '{')) && (is_assignment(close[o] + 1) || is(close[o] + 1, "of")))
+                        return true;
+            }
+
+            if (is_open(k))
+                open.push_back(k);
+        }
+
+        return false;
+    }
+
+    void blank(Module &module, size_t begin, size_t end, std::string text = "")
+    {
+        // Keep line breaks, so lines of the body match the source.
+        for (size_t i = begin; i < end; i++)
+            if (module.source[i] == '\n')
+                text.push_back('\n');
+
+        module.edits.push_back(Edit{ begin, end, std::move(text) });
+    }
+
+    // Add a local JS dependency, false if the browser must load it.
+    bool link(Module &module, const std::string &spec, size_t &id)
+    {
+        path target;
+        std::string url;
+        if (!browser::resolve_import(module.file.parent_path(), spec, target, url))
+            return false;
+
+        if (url.empty())
+        {
+            url = "https://plugins/";
+            append_encoded(url, target.lexically_relative(config::plugins_dir()).generic_string());
+        }
+
+        // Parsing the dependency reuses the cursor.
+        auto code = code_;
+        auto tokens = tokens_;
+        id = add(target, url);
+        code_ = code;
+        tokens_ = tokens;
+
+        return true;
+    }
+
+    // Expression of a dependency namespace, imported by the browser if it can't be linked.
+    std::string get_namespace(Module &module, const std::string &spec)
+    {
+        size_t id;
+        if (link(module, spec, id))
+        {
+            if (std::find(module.deps.begin(), module.deps.end(), id) == module.deps.end())
+                module.deps.push_back(id);
+            return "__pengu$.ns[" + std::to_string(id) + "]";
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "__pengu$e%zu", module.header.length());
+
+        module.header.append("const ").append(name).append(" = await __pengu$meta.import(");
+        append_js_string(module.header, spec);
+        module.header.append(");");
+        return name;
+    }
+
+    void add_getter(std::string &getters, const std::string &name, const std::string &expr)
+    {
+        append_js_string(getters, name);
+        getters.append(": () => ").append(expr).append(", ");
+    }
+
+    // import ... from '...';
+    bool parse_import(Module &module, size_t &k)
+    {
+        size_t j = k + 1;
+        std::string spec, local_default, local_ns, names;
+
+        if (type(j, T_STRING))
+        {
+            if (!get_specifier(j++, spec))
+                return false;
+        }
+        else
+        {
+            if (type(j, T_IDENT) && !is(j, "from"))
+            {
+                local_default = text(j++);
+                if (punct(j, ','))
+                    j++;
+            }
+
+            if (punct(j, '*'))
+            {
+                if (!is(j + 1, "as") || !type(j + 2, T_IDENT))
+                    return false;
+                local_ns = text(j + 2);
+                j += 3;
+            }
+            else if (punct(j, '{'))
+            {
+                for (j++; j < tokens_->size() && !punct(j, '}'); )
+                {
+                    if (!type(j, T_IDENT) && !type(j, T_STRING))
+                        return false;
+
+                    auto name = text(j++);
+                    auto local = name;
+
+                    if (is(j, "as") && type(j + 1, T_IDENT))
+                    {
+                        local = text(j + 1);
+                        j += 2;
+                    }
+                    else if (name[0] == '"' || name[0] == '\'')
+                        return false;
+
+                    names.append(name == local ? name : name + ": " + local).append(", ");
+
+                    if (punct(j, ','))
+                        j++;
+                }
+                j++;
+            }
+
+            if (!is(j, "from") || !type(j + 1, T_STRING) || !get_specifier(j + 1, spec))
+                return false;
+            j += 2;
+        }
+
+        if (has_attributes(j))
+            return false;
+        if (punct(j, ';'))
+            j++;
+
+        auto ns = get_namespace(module, spec);
+        if (!local_default.empty())
+            module.header.append("const ").append(local_default).append(" = ").append(ns).append(".default;");
+        if (!local_ns.empty())
+            module.header.append("const ").append(local_ns).append(" = ").append(ns).append(";");
+        if (!names.empty())
+            module.header.append("const { ").append(names).append("} = ").append(ns).append(";");
+
+        blank(module, (*tokens_)[k].begin, (*tokens_)[j - 1].end);
+        k = j;
+        return true;
+    }
+
+    // export ...
+    bool parse_export(Module &module, size_t &k, std::string &getters, std::string &stars,
+        std::vector<std::string> &locals)
+    {
+        size_t j = k + 1;
+        size_t begin = (*tokens_)[k].begin;
+
+        if (punct(j, '*'))
+        {
+            std::string spec, name;
+            if (is(j + 1, "as"))
+            {
+                if (!type(j + 2, T_IDENT) && !type(j + 2, T_STRING))
+                    return false;
+                name = text(j + 2);
+                j += 2;
+            }
+
+            if (!is(j + 1, "from") || !type(j + 2, T_STRING) || !get_specifier(j + 2, spec))
+                return false;
+            j += 3;
+
+            if (has_attributes(j))
+                return false;
+            if (punct(j, ';'))
+                j++;
+
+            auto ns = get_namespace(module, spec);
+            if (name.empty())
+                stars.append("__pengu$.star(__pengu$ns, ").append(ns).append(");");
+            else
+                add_getter(getters, name[0] == '"' || name[0] == '\'' ? name.substr(1, name.length() - 2) : name, ns);
+
+            blank(module, begin, (*tokens_)[j - 1].end);
+        }
+        else if (punct(j, '{'))
+        {
+            std::vector<std::pair<std::string, std::string>> list;
+            for (j++; j < tokens_->size() && !punct(j, '}'); )
+            {
+                if (!type(j, T_IDENT) && !type(j, T_STRING))
+                    return false;
+
+                auto local = text(j++);
+                auto name = local;
+
+                if (is(j, "as") && (type(j + 1, T_IDENT) || type(j + 1, T_STRING)))
+                {
+                    name = text(j + 1);
+                    j += 2;
+                }
+
+                if (name[0] == '"' || name[0] == '\'')
+                    name = name.substr(1, name.length() - 2);
+
+                list.emplace_back(local, name);
+                if (punct(j, ','))
+                    j++;
+            }
+            j++;
+
+            std::string ns;
+            if (is(j, "from"))
+            {
+                std::string spec;
+                if (!type(j + 1, T_STRING) || !get_specifier(j + 1, spec))
+                    return false;
+                j += 2;
+
+                if (has_attributes(j))
+                    return false;
+                ns = get_namespace(module, spec);
+            }
+
+            for (const auto &[local, name] : list)
+            {
+                bool quoted = local[0] == '"' || local[0] == '\'';
+                if (ns.empty() && quoted)
+                    return false;
+                if (ns.empty())
+                    locals.push_back(local);
+
+                add_getter(getters, name, ns.empty() ? local
+                    : quoted ? ns + "[" + local + "]" : ns + "." + local);
+            }
+
+            if (punct(j, ';'))
+                j++;
+            blank(module, begin, (*tokens_)[j - 1].end);
+        }
+        else if (is(j, "default"))
+        {
+            j++;
+            size_t f = is(j, "async") && is(j + 1, "function") && !(*tokens_)[j + 1].newline ? j + 1 : j;
+            bool is_class = is(f, "class");
+
+            if (is(f, "function") || is_class)
+            {
+                size_t g = f + 1;
+                if (punct(g, '*'))
+                    g++;
+
+                if (type(g, T_IDENT) && !(is_class && is(g, "extends")))
+                {
+                    // Named declaration, keep it hoisted.
+                    add_getter(getters, "default", text(g));
+                    locals.push_back(text(g));
+                    blank(module, begin, (*tokens_)[j].begin);
+                    k = j;
+                    return true;
+                }
+
+                // Anonymous, it becomes an expression and needs its own end.
+                size_t open = g;
+                if (is_class)
+                {
+                    int depth = (*tokens_)[f].depth;
+                    while (open < tokens_->size() && !(punct(open, '{') && (*tokens_)[open].depth == depth))
+                        open++;
+                }
+                else
+                {
+                    if (!punct(open, '('))
+                        return false;
+                    open = find_close(open) + 1;
+                }
+
+                if (!punct(open, '{'))
+                    return false;
+
+                size_t close = find_close(open);
+                if (close >= tokens_->size())
+                    return false;
+
+                size_t end = (*tokens_)[close].end;
+                module.edits.push_back(Edit{ end, end, ";" });
+            }
+
+            module.header.append("let __pengu$default;");
+            add_getter(getters, "default", "__pengu$default");
+            blank(module, begin, (*tokens_)[j].begin, "__pengu$default = ");
+        }
+        else if (is(j, "function") || is(j, "class") || (is(j, "async") && is(j + 1, "function")))
+        {
+            size_t g = j + (is(j, "async") ? 2 : 1);
+            if (punct(g, '*'))
+                g++;
+            if (!type(g, T_IDENT))
+                return false;
+
+            add_getter(getters, text(g), text(g));
+            locals.push_back(text(g));
+            blank(module, begin, (*tokens_)[j].begin);
+        }
+        else if (is(j, "const") || is(j, "let") || is(j, "var"))
+        {
+            // Destructuring patterns aren't supported.
+            std::vector<size_t> names;
+            if (!get_declarators(j, names))
+                return false;
+
+            for (size_t n : names)
+            {
+                add_getter(getters, text(n), text(n));
+                locals.push_back(text(n));
+            }
+
+            blank(module, begin, (*tokens_)[j].begin);
+        }
+        else
+        {
+            return false;
+        }
+
+        k = j;
+        return true;
+    }
+
+    bool parse(Module &module)
+    {
+        void *buffer; size_t length;
+        if (!file::read_file(module.file, &buffer, &length))
+            return false;
+
+        module.source.assign((const char *)buffer, length);
+        free(buffer);
+
+        std::vector<Token> tokens;
+        if (!Tokenizer(module.source, tokens).run())
+            return false;
+
+        code_ = &module.source;
+        tokens_ = &tokens;
+
+        std::string getters, stars;
+        std::vector<std::string> locals;
+        size_t k = 0;
+
+        while (k < tokens.size())
+        {
+            const auto &t = tokens[k];
+            bool member = k > 0 && punct(k - 1, '.');
+
+            if (member || t.type != T_IDENT)
+            {
+                k++;
+            }
+            else if (is(k, "import") && punct(k + 1, '.') && is(k + 2, "meta"))
+            {
+                blank(module, t.begin, tokens[k + 2].end, "__pengu$meta");
+                k += 3;
+            }
+            else if (is(k, "import") && punct(k + 1, '('))
+            {
+                size_t close = find_close(k + 1);
+
+                // A method named import.
+                if (punct(close + 1, '{'))
+                {
+                    k++;
+                    continue;
+                }
+
+                // Linked modules are evaluated on demand.
+                std::string spec;
+                size_t id;
+                if (type(k + 2, T_STRING) && (punct(k + 3, ')') || punct(k + 3, ','))
+                    && get_specifier(k + 2, spec) && link(module, spec, id))
+                {
+                    module.lazy.push_back(id);
+                    module.edits.push_back(Edit{ t.begin, tokens[k + 2].end, "__pengu$.load(" + std::to_string(id) });
+                    k += 3;
+                    continue;
+                }
+
+                module.edits.push_back(Edit{ t.begin, t.end, "__pengu$meta.import" });
+                k++;
+            }
+            else if (t.depth == 0 && is(k, "import"))
+            {
+                if (!parse_import(module, k))
+                    return false;
+            }
+            else if (t.depth == 0 && is(k, "export"))
+            {
+                if (!parse_export(module, k, getters, stars, locals))
+                    return false;
+            }
+            else
+            {
+                k++;
+            }
+        }
+
+        // Importers would keep the old value.
+        if (!locals.empty() && reassigns(locals))
+            return false;
+
+        if (!getters.empty())
+            module.header.insert(0, "__pengu$.exports(__pengu$ns, { " + getters + "});");
+        module.header.append(stars);
+
+        return true;
+    }
+};
+
+// Mark modules on static import cycles, they need live bindings.
+static void mark_cycles(std::deque<Module> &modules)
+{
+    std::vector<int> state(modules.size(), 0);      // 0 new, 1 visiting, 2 done
+    std::vector<std::pair<size_t, size_t>> stack;
+
+    for (size_t root = 0; root < modules.size(); root++)
+    {
+        if (state[root] != 0)
+            continue;
+
+        stack.emplace_back(root, 0);
+        state[root] = 1;
+
+        while (!stack.empty())
+        {
+            auto &[id, next] = stack.back();
+            if (next < modules[id].deps.size())
+            {
+                size_t dep = modules[id].deps[next++];
+                if (state[dep] == 1)
+                    modules[dep].ok = false;
+                else if (state[dep] == 0)
+                {
+                    state[dep] = 1;
+                    stack.emplace_back(dep, 0);
+                }
+            }
+            else
+            {
+                state[id] = 2;
+                stack.pop_back();
+            }
+        }
+    }
+}
+
+static void collect(const std::deque<Module> &modules, size_t id, std::vector<bool> &seen)
+{
+    std::vector<size_t> stack{ id };
+    while (!stack.empty())
+    {
+        size_t top = stack.back();
+        stack.pop_back();
+
+        if (seen[top])
+            continue;
+        seen[top] = true;
+
+        for (size_t dep : modules[top].deps) stack.push_back(dep);
+        for (size_t dep : modules[top].lazy) stack.push_back(dep);
+    }
+}
+
+static void append_vlq(std::string &out, int value)
+{
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    unsigned int v = value < 0 ? ((unsigned int)-value << 1) | 1 : (unsigned int)value << 1;
+    do
+    {
+        unsigned int digit = v & 31;
+        v >>= 5;
+        out.push_back(base64[v ? digit | 32 : digit]);
+    } while (v);
+}
+
+static const auto SCRIPT_BUNDLE_RUNTIME = R"(const __pengu$ = (() => {
+  const defs = [], ns = [], pending = [];
+  const load = (id) => pending[id] ??= (async () => {
+    const [deps, url, fn] = defs[id];
+    await Promise.all(deps.map(load));
+    const resolve = (s) => /^\.{0,2}\//.test(s) ? new URL(s, url).href : s;
+    await fn(ns[id], { url, resolve, import: (s, o) => import(resolve(s), o) });
+    return ns[id];
+  })();
+  const define = (id, deps, url, fn) => {
+    defs[id] = [deps, url, fn];
+    ns[id] = Object.create(null, { [Symbol.toStringTag]: { value: 'Module' } });
+  };
+  const exports = (target, getters) => {
+    for (const key in getters)
+      Object.defineProperty(target, key, { get: getters[key], enumerable: true });
+  };
+  const star = (target, source) => {
+    for (const key of Object.keys(source))
+      if (key !== 'default' && !(key in target))
+        Object.defineProperty(target, key, { get: () => source[key], enumerable: true });
+  };
+  return { ns, load, define, exports, star };
+})();
+)";
+
+static std::shared_ptr<Bundle> link_bundle()
+{
+    auto bundle = std::make_shared<Bundle>();
+    auto plugins_dir = config::plugins_dir();
+
+    Linker linker;
+    std::vector<std::pair<std::string, size_t>> entries;
+
+    for (const auto &entry : plugin::get_entries())
+    {
+        if (plugin::is_disabled(entry))
+            continue;
+
+        auto name = entry.generic_string();
+        std::string url = "https://plugins/";
+        append_encoded(url, name);
+
+        entries.emplace_back(name, linker.add(plugins_dir / entry, url));
+    }
+
+    auto &modules = linker.modules;
+    mark_cycles(modules);
+
+    // Reachable modules of each entry, a module loaded by the browser must not
+    // be linked for another plugin, or it would have two instances.
+    std::vector<std::vector<bool>> graphs;
+    std::vector<bool> linked(entries.size(), true);
+
+    for (auto &[name, id] : entries)
+    {
+        graphs.emplace_back(modules.size(), false);
+        collect(modules, id, graphs.back());
+    }
+
+    for (bool changed = true; changed; )
+    {
+        changed = false;
+        std::vector<bool> native(modules.size(), false);
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (!linked[i]) for (size_t m = 0; m < modules.size(); m++)
+                if (graphs[i][m]) native[m] = true;
+        }
+
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            if (!linked[i]) continue;
+            for (size_t m = 0; m < modules.size(); m++)
+            {
+                if (graphs[i][m] && (!modules[m].ok || native[m]))
+                {
+                    linked[i] = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<bool> included(modules.size(), false);
+    for (size_t i = 0; i < entries.size(); i++)
+        if (linked[i]) for (size_t m = 0; m < modules.size(); m++)
+            if (graphs[i][m]) included[m] = true;
+
+    // Output, a line of the body is a line of the source.
+    std::string code = SCRIPT_BUNDLE_RUNTIME;
+    std::string mappings, sources;
+    size_t lines = std::count(code.begin(), code.end(), '\n');
+    mappings.append(lines, ';');
+
+    int source_index = 0, prev_source = 0, prev_line = 0;
+
+    for (size_t id = 0; id < modules.size(); id++)
+    {
+        auto &module = modules[id];
+        if (!included[id])
+            continue;
+
+        code.append("__pengu$.define(").append(std::to_string(id)).append(", [");
+        for (size_t i = 0; i < module.deps.size(); i++)
+            code.append(i > 0 ? ", " : "").append(std::to_string(module.deps[i]));
+        code.append("], ");
+        append_js_string(code, module.url);
+        code.append(", async (__pengu$ns, __pengu$meta) => {").append(module.header).append("\n");
+
+        std::stable_sort(module.edits.begin(), module.edits.end(),
+            [](const Edit &a, const Edit &b) { return a.begin < b.begin; });
+
+        size_t offset = 0;
+        for (const auto &edit : module.edits)
+        {
+            if (edit.begin < offset)
+                continue;
+            code.append(module.source, offset, edit.begin - offset).append(edit.text);
+            offset = edit.end;
+        }
+        code.append(module.source, offset, std::string::npos);
+        code.append("\n});\n");
+
+        // Wrapper line, body lines, closing line.
+        size_t body_lines = std::count(module.source.begin(), module.source.end(), '\n') + 1;
+        mappings.push_back(';');
+        for (size_t line = 0; line < body_lines; line++)
+        {
+            mappings.push_back('A');
+            append_vlq(mappings, source_index - prev_source);
+            append_vlq(mappings, (int)line - prev_line);
+            mappings.append("A;");
+            prev_source = source_index;
+            prev_line = (int)line;
+        }
+        mappings.push_back(';');
+
+        if (source_index++ > 0)
+            sources.push_back(',');
+        append_js_string(sources, module.url);
+    }
+
+    code.append("const entries = { ");
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (!linked[i]) continue;
+        append_js_string(code, entries[i].first);
+        code.append(": ").append(std::to_string(entries[i].second)).append(", ");
+    }
+    code.append("};\nexport const load = (entry) => entry in entries ? __pengu$.load(entries[entry]) : null;\n");
+
+    bundle->version = fnv64_1a(code.data(), code.length());
+    if (bundle->version == 0)
+        bundle->version = 1;
+
+    code.append("//# sourceMappingURL=bundle.js.map\n");
+    bundle->code = std::make_shared<const std::string>(std::move(code));
+    bundle->source_map = std::make_shared<const std::string>(
+        R"({"version":3,"file":"bundle.js","sources":[)" + sources
+        + R"(],"names":[],"mappings":")" + mappings + "\"}");
+
+    return bundle;
+}
+
+void browser::build_startup_bundle()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stale_ = true;
+        if (building_ || !config::options::startup_bundle())
+            return;
+        building_ = true;
+    }
+
+    task::run([]
+    {
+        while (true)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stale_ = false;
+            }
+
+            auto bundle = link_bundle();
+
+            // Linked again if plugins changed meanwhile.
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!stale_)
+            {
+                bundle_ = std::move(bundle);
+                building_ = false;
+                return;
+            }
+        }
+    }, task::PRIORITY_LOW);
+}
+
+bool browser::get_startup_bundle(StartupBundle &out)
+{
+    std::shared_ptr<const Bundle> bundle;
+    bool building;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stale_)
+            bundle = bundle_;
+        building = building_;
+    }
+
+    if (bundle == nullptr)
+    {
+        if (!building)
+            build_startup_bundle();
+        return false;
+    }
+
+    out.version = bundle->version;
+    out.code = bundle->code;
+    out.source_map = bundle->source_map;
+    return true;
+}
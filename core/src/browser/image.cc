@@ -0,0 +1,280 @@
+#include "browser.h"
+#include "include/capi/cef_image_capi.h"
+#include "include/capi/cef_values_capi.h"
+
+// BROWSER PROCESS ONLY.
+
+// Image variants, e.g. https://plugins/my-theme/bg.jpg?w=1280&format=jpeg
+// Sources are decoded and encoded by cef_image, resampling is done here
+// with an area filter which doesn't alias on large downscales.
+
+static constexpr int MAX_VARIANT_SIZE = 8192;
+static constexpr auto CACHE_MAX_AGE = std::chrono::hours(24 * 7);
+
+static bool is_jpeg_ext(const std::u16string &ext)
+{
+    return ext == u"jpg" || ext == u"jpeg" || ext == u"jfif" || ext == u"pjpeg" || ext == u"pjp";
+}
+
+static std::u16string get_ext(const std::u16string &path)
+{
+    std::u16string ext;
+    size_t pos = path.rfind(u'.');
+
+    if (pos != std::u16string::npos)
+    {
+        for (size_t i = pos + 1; i < path.length(); i++)
+            ext.push_back(path[i] < 128 ? (char16_t)tolower(path[i]) : path[i]);
+    }
+
+    return ext;
+}
+
+bool browser::parse_image_query(const std::u16string &path, const std::u16string &query, ImageVariant &variant)
+{
+    auto ext = get_ext(path);
+    bool jpeg = is_jpeg_ext(ext);
+
+    if (!jpeg && ext != u"png")
+        return false;
+
+    variant = ImageVariant{};
+    variant.format = jpeg ? ImageVariant::JPEG : ImageVariant::PNG;
+
+    bool found = false;
+    size_t pos = 0;
+
+    while (pos < query.length())
+    {
+        size_t end = query.find(u'&', pos);
+        if (end == std::u16string::npos)
+            end = query.length();
+
+        auto param = query.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t eq = param.find(u'=');
+        if (eq == std::u16string::npos)
+            continue;
+
+        auto key = param.substr(0, eq);
+        std::string value;
+        for (size_t i = eq + 1; i < param.length(); i++)
+            value.push_back(param[i] < 128 ? (char)tolower(param[i]) : '?');
+
+        if (key == u"w" || key == u"h" || key == u"q")
+        {
+            int number = atoi(value.c_str());
+            if (number <= 0)
+                continue;
+
+            if (key == u"w")
+                variant.width = std::min(number, MAX_VARIANT_SIZE);
+            else if (key == u"h")
+                variant.height = std::min(number, MAX_VARIANT_SIZE);
+            else
+                variant.quality = std::min(number, 100);
+
+            found = true;
+        }
+        else if (key == u"format")
+        {
+            // No WebP encoder is exposed by CEF, keep the source format.
+            if (value == "png")
+                variant.format = ImageVariant::PNG;
+            else if (value == "jpeg" || value == "jpg")
+                variant.format = ImageVariant::JPEG;
+
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+path browser::get_image_variant_path(const path &source, const ImageVariant &variant)
+{
+    std::error_code ec;
+    auto size = std::filesystem::file_size(source, ec);
+    auto time = std::filesystem::last_write_time(source, ec).time_since_epoch().count();
+
+    // Source identity, a changed file gets new variants.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](const void *data, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= static_cast<const uint8_t *>(data)[i];
+            hash *= 0x100000001b3ull;
+        }
+    };
+
+    auto name = source.generic_u16string();
+    mix(name.data(), name.length() * sizeof(char16_t));
+    mix(&size, sizeof(size));
+    mix(&time, sizeof(time));
+
+    char file[96];
+    snprintf(file, sizeof(file), "%016llx-%dx%d-q%d.%s", (unsigned long long)hash,
+        variant.width, variant.height, variant.quality,
+        variant.format == ImageVariant::JPEG ? "jpg" : "png");
+
+    return config::loader_dir() / "cache" / "images" / file;
+}
+
+// Area-average resize of a row, RGBA premultiplied.
+static void resample_row(const uint8_t *in, int src_len, float *out, int dst_len)
+{
+    float scale = (float)src_len / dst_len;
+
+    for (int i = 0; i < dst_len; i++)
+    {
+        float start = i * scale, end = start + scale;
+        float acc[4] = { 0, 0, 0, 0 };
+
+        for (int s = (int)start; s < src_len && s < end; s++)
+        {
+            float weight = std::min(end, (float)(s + 1)) - std::max(start, (float)s);
+            const uint8_t *px = in + (size_t)s * 4;
+            for (int c = 0; c < 4; c++)
+                acc[c] += px[c] * weight;
+        }
+
+        for (int c = 0; c < 4; c++)
+            out[(size_t)i * 4 + c] = acc[c] / scale;
+    }
+}
+
+// Source rows are resampled as they're read and summed into the output row
+// they cover, only two rows of floats are kept whatever the source size.
+static std::vector<uint8_t> resize_rgba(const uint8_t *pixels, int width, int height, int out_width, int out_height)
+{
+    std::vector<float> row((size_t)out_width * 4), acc(row.size());
+    std::vector<uint8_t> out((size_t)out_width * out_height * 4);
+
+    float scale = (float)height / out_height;
+    int cached = -1;
+
+    for (int y = 0; y < out_height; y++)
+    {
+        float start = y * scale, end = start + scale;
+        std::fill(acc.begin(), acc.end(), 0.0f);
+
+        for (int s = (int)start; s < height && s < end; s++)
+        {
+            // A row on the boundary of two output rows is resampled once.
+            if (s != cached)
+            {
+                resample_row(pixels + (size_t)s * width * 4, width, row.data(), out_width);
+                cached = s;
+            }
+
+            float weight = std::min(end, (float)(s + 1)) - std::max(start, (float)s);
+            for (size_t i = 0; i < acc.size(); i++)
+                acc[i] += row[i] * weight;
+        }
+
+        uint8_t *px = out.data() + (size_t)y * out_width * 4;
+        for (size_t i = 0; i < acc.size(); i++)
+            px[i] = (uint8_t)std::min(255.0f, acc[i] / scale + 0.5f);
+    }
+
+    return out;
+}
+
+// Remove variants not encoded for a while, and those of changed sources.
+static void prune_cache(const path &cache_dir, const path &keep)
+{
+    std::error_code ec;
+    auto deadline = std::filesystem::file_time_type::clock::now() - CACHE_MAX_AGE;
+
+    for (const auto &entry : std::filesystem::directory_iterator(cache_dir, ec))
+    {
+        if (entry.path() == keep)
+            continue;
+
+        auto time = entry.last_write_time(ec);
+        if (!ec && time < deadline)
+            std::filesystem::remove(entry.path(), ec);
+    }
+}
+
+static bool get_binary(cef_binary_value_t *binary, std::string &out)
+{
+    if (binary == nullptr)
+        return false;
+
+    out.resize(binary->get_size(binary));
+    binary->get_data(binary, out.data(), out.size(), 0);
+    binary->base.release(&binary->base);
+
+    return !out.empty();
+}
+
+bool browser::create_image_variant(const path &source, const ImageVariant &variant, const path &output)
+{
+    // Decoded straight from the mapped file, no copy.
+    std::error_code ec;
+    file::MappedFile mapped;
+    if (!mapped.open(source, ec) || mapped.size() == 0)
+        return false;
+
+    auto image = cef_image_create();
+    bool jpeg = is_jpeg_ext(get_ext(source.u16string()));
+
+    int ok = jpeg ? image->add_jpeg(image, 1.0f, mapped.data(), mapped.size())
+        : image->add_png(image, 1.0f, mapped.data(), mapped.size());
+    mapped.close();
+
+    std::string pixels;
+    int width = 0, height = 0;
+
+    if (!ok || !get_binary(image->get_as_bitmap(image, 1.0f,
+        CEF_COLOR_TYPE_RGBA_8888, CEF_ALPHA_TYPE_PREMULTIPLIED, &width, &height), pixels))
+    {
+        image->base.release(&image->base);
+        return false;
+    }
+
+    image->base.release(&image->base);
+
+    // Fit in the box keeping the aspect ratio, never upscale.
+    double scale = 1.0;
+    if (variant.width > 0)
+        scale = std::min(scale, (double)variant.width / width);
+    if (variant.height > 0)
+        scale = std::min(scale, (double)variant.height / height);
+
+    int out_width = std::max(1, (int)(width * scale + 0.5));
+    int out_height = std::max(1, (int)(height * scale + 0.5));
+
+    if (out_width != width || out_height != height)
+    {
+        auto resized = resize_rgba((const uint8_t *)pixels.data(), width, height, out_width, out_height);
+        pixels.assign((const char *)resized.data(), resized.size());
+    }
+
+    auto result = cef_image_create();
+    result->add_bitmap(result, 1.0f, out_width, out_height,
+        CEF_COLOR_TYPE_RGBA_8888, CEF_ALPHA_TYPE_PREMULTIPLIED, pixels.data(), pixels.size());
+
+    std::string encoded;
+    int quality = variant.quality > 0 ? variant.quality : 90;
+
+    ok = get_binary(variant.format == ImageVariant::JPEG
+        ? result->get_as_jpeg(result, 1.0f, quality, &width, &height)
+        : result->get_as_png(result, 1.0f, 1, &width, &height), encoded);
+
+    result->base.release(&result->base);
+
+    if (!ok)
+        return false;
+
+    // Readers never see a partial variant.
+    std::filesystem::create_directories(output.parent_path(), ec);
+    bool written = file::write_file_atomic(output, encoded.data(), encoded.length());
+    prune_cache(output.parent_path(), output);
+
+    // Another request may have written it first.
+    return written || file::is_file(output);
+}
@@ -0,0 +1,557 @@
+#include "browser.h"
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+// BROWSER PROCESS ONLY.
+
+// Versioned JS modules. Relative imports of a module are rewritten to
+// `lib.js?v=<version>`, the version hashes the content of the module and
+// the versions of its imports (a Merkle tree), so versioned URLs can be
+// cached forever and an edit changes every URL on the path to the entry.
+// Modules in an import cycle share one version, so their URLs don't depend
+// on which module was requested first.
+// Entries stay unversioned and revalidate with their ETag.
+//
+// Modules are cached until the plugins watcher invalidates them.
+
+// Shared dependencies (package.json "pengu.shared") are imported by bare
+// specifiers, they're rewritten to one URL per library under
+// `https://plugins/@shared/<name>@<version>/`, so every plugin gets the same
+// instance and it's compiled once.
+
+struct Import
+{
+    size_t begin;       // specifier range in the source
+    size_t end;
+    path target;
+    std::string url;    // replaces the specifier if not empty
+};
+
+struct ModuleEntry
+{
+    std::u16string key;
+    uint64_t content_hash = 0;
+    std::string source;
+    std::vector<Import> imports;
+
+    // Rewritten with these import versions, kept across invalidations.
+    std::shared_ptr<const std::string> code;
+    std::vector<uint64_t> import_versions;
+
+    // 0 until built, reset when any module changes.
+    uint64_t version = 0;
+};
+
+static std::mutex mutex_;
+static std::unordered_map<std::u16string, ModuleEntry> modules_;
+
+static uint64_t fnv64_1a(const void *data, size_t length, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= static_cast<const uint8_t *>(data)[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static bool is_ident(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' || c == '$' || (unsigned char)c >= 0x80;
+}
+
+static size_t skip_space(const std::string &code, size_t i)
+{
+    while (i < code.length())
+    {
+        size_t end;
+        if (isspace((unsigned char)code[i]))
+            i++;
+        else if (code.compare(i, 2, "//") == 0)
+            i = (end = code.find('\n', i)) == std::string::npos ? code.length() : end;
+        else if (code.compare(i, 2, "/*") == 0)
+            i = (end = code.find("*/", i + 2)) == std::string::npos ? code.length() : end + 2;
+        else
+            break;
+    }
+    return i;
+}
+
+static size_t skip_string(const std::string &code, size_t i)
+{
+    char quote = code[i++];
+    while (i < code.length() && code[i] != quote)
+    {
+        if (code[i] == '\\')
+            i++;
+        else if (code[i] == '\n' && quote != '`')
+            break;
+        i++;
+    }
+    return i + 1;
+}
+
+// Find static and dynamic import specifiers, it's a tokenizer
+// that only knows strings, comments, templates and regex literals.
+static void find_specifiers(const std::string &code, std::vector<std::pair<size_t, size_t>> &out)
+{
+    size_t i = 0, n = code.length();
+    char prev = 0;      // last significant char
+    bool after_keyword = false;
+
+    while (i < n)
+    {
+        char c = code[i];
+
+        if (isspace((unsigned char)c))
+        {
+            i++;
+        }
+        else if (c == '/' && i + 1 < n && (code[i + 1] == '/' || code[i + 1] == '*'))
+        {
+            i = skip_space(code, i);
+        }
+        else if (c == '"' || c == '\'' || c == '`')
+        {
+            i = skip_string(code, i);
+            prev = c;
+            after_keyword = false;
+        }
+        else if (c == '/')
+        {
+            // Regex literal if it can't be a division.
+            if (prev == 0 || after_keyword || strchr("(,=:[!&|?{};+-*%<>~^", prev) != nullptr)
+            {
+                bool in_class = false;
+                for (i++; i < n && code[i] != '\n'; i++)
+                {
+                    if (code[i] == '\\') i++;
+                    else if (code[i] == '[') in_class = true;
+                    else if (code[i] == ']') in_class = false;
+                    else if (code[i] == '/' && !in_class) break;
+                }
+                i++;
+                while (i < n && is_ident(code[i])) i++;
+                prev = '/';
+            }
+            else
+            {
+                prev = c;
+                i++;
+            }
+            after_keyword = false;
+        }
+        else if (is_ident(c))
+        {
+            size_t start = i;
+            while (i < n && is_ident(code[i])) i++;
+
+            auto word = std::string_view(code).substr(start, i - start);
+            bool member = prev == '.';
+
+            if (!member && (word == "import" || word == "from"))
+            {
+                size_t j = skip_space(code, i);
+
+                // import('...'), not import.meta
+                if (word == "import" && j < n && code[j] == '(')
+                    j = skip_space(code, j + 1);
+
+                if (j < n && (code[j] == '"' || code[j] == '\''))
+                {
+                    size_t end = skip_string(code, j);
+                    if (end <= n && code[end - 1] == code[j])
+                        out.emplace_back(j + 1, end - 1);
+                }
+            }
+
+            after_keyword = word == "return" || word == "typeof" || word == "case"
+                || word == "in" || word == "of" || word == "yield" || word == "await";
+            prev = 'a';
+        }
+        else
+        {
+            prev = c;
+            after_keyword = false;
+            i++;
+        }
+    }
+}
+
+static const std::string SHARED_ORIGIN = "https://plugins/@shared/";
+
+static void append_encoded(std::string &out, const std::string &str)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    for (unsigned char c : str)
+    {
+        if (isalnum(c) || strchr("/-_.~@", c) != nullptr)
+            out.push_back((char)c);
+        else
+        {
+            out.push_back('%');
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 15]);
+        }
+    }
+}
+
+// Shared dependency by a bare specifier, `name` or `name/sub/path`.
+static const plugin::SharedModule *find_shared(const std::vector<plugin::SharedModule> &modules,
+    const std::string &spec, std::string &sub)
+{
+    for (const auto &shared : modules)
+    {
+        if (spec == shared.name)
+        {
+            sub.clear();
+            return &shared;
+        }
+        else if (spec.length() > shared.name.length() + 1
+            && spec.starts_with(shared.name) && spec[shared.name.length()] == '/')
+        {
+            sub = spec.substr(shared.name.length() + 1);
+            return &shared;
+        }
+    }
+    return nullptr;
+}
+
+// Shared URL of a file in a shared dependency folder, or empty.
+static std::string get_shared_url(const std::vector<plugin::SharedModule> &modules, const path &file)
+{
+    for (const auto &shared : modules)
+    {
+        auto rel = file.lexically_relative(shared.dir);
+        if (rel.empty() || *rel.begin() == "..")
+            continue;
+
+        std::string url = SHARED_ORIGIN;
+        append_encoded(url, shared.name + "@" + shared.version + "/");
+        append_encoded(url, rel.generic_string());
+        return url;
+    }
+    return "";
+}
+
+static bool is_js_file(const path &file)
+{
+    auto ext = file.extension();
+    return (ext == ".js" || ext == ".mjs") && file::is_file(file);
+}
+
+// Resolve a specifier like the asset handler does, only to JS files.
+bool browser::resolve_import(const path &dir, const std::string &spec, path &target, std::string &url)
+{
+    static const std::string PLUGINS_ORIGIN = "https://plugins/";
+
+    if (spec.find_first_of("?#") != std::string::npos)
+        return false;
+
+    path base;
+    std::string sub;
+    auto modules = plugin::get_shared_modules();
+    const plugin::SharedModule *shared = nullptr;
+
+    if (spec.starts_with("./") || spec.starts_with("../"))
+        base = dir / path(std::u8string(spec.begin(), spec.end()));
+    else if (spec.starts_with(PLUGINS_ORIGIN))
+        base = config::plugins_dir() / path(std::u8string(spec.begin() + PLUGINS_ORIGIN.length(), spec.end()));
+    else if (spec.starts_with("/") && !spec.starts_with("//"))
+        base = config::plugins_dir() / path(std::u8string(spec.begin() + 1, spec.end()));
+    else if ((shared = find_shared(*modules, spec, sub)) != nullptr)
+        base = sub.empty() ? shared->dir / shared->file : shared->dir / path(std::u8string(sub.begin(), sub.end()));
+    else
+        return false;
+
+    // Must stay in the plugins dir.
+    base = base.lexically_normal();
+    auto rel = base.lexically_relative(config::plugins_dir());
+    if (rel.empty() || *rel.begin() == "..")
+        return false;
+
+    if (spec.ends_with("/"))
+        target = base / "index.js";
+    else if (!base.has_extension() && file::is_file(path(base) += ".js"))
+        target = path(base) += ".js";
+    else if (!base.has_extension() && file::is_dir(base))
+        target = base / "index.js";
+    else
+        target = base;
+
+    if (!is_js_file(target))
+        return false;
+
+    // The shared copy, also for relative imports of the same file.
+    url = get_shared_url(*modules, target);
+    return shared == nullptr || !url.empty();
+}
+
+static bool resolve_specifier(const path &dir, const std::string &spec, path &target, std::string &url)
+{
+    if (!browser::resolve_import(dir, spec, target, url))
+        return false;
+
+    // Plugin entries are imported by the loader without version,
+    // a versioned URL would create a second instance of them.
+    std::vector<path> parts;
+    for (const auto &part : target.lexically_relative(config::plugins_dir()))
+        parts.push_back(part);
+
+    bool grouped = parts.size() == 3 && parts[0].u8string().starts_with(u8"@");
+    bool entry = parts.size() == 1
+        || (parts.size() == 2 && parts[1] == "index.js" && !parts[0].u8string().starts_with(u8"@"))
+        || (grouped && parts[2] == "index.js");
+
+    return !entry;
+}
+
+static ModuleEntry *load_module(const path &file)
+{
+    // Import targets and watcher paths are normal, request paths must be too.
+    auto key = file.lexically_normal().u16string();
+    auto it = modules_.find(key);
+    if (it != modules_.end())
+        return &it->second;
+
+    // Through the asset cache, it may be prefetched.
+    browser::CachedAsset asset;
+    void *buffer; size_t length;
+
+    if (!browser::get_cached_asset(file, asset))
+        return nullptr;
+
+    ModuleEntry entry;
+    entry.key = key;
+    entry.content_hash = asset.hash;
+
+    if (asset.body != nullptr)
+    {
+        entry.source = *asset.body;
+    }
+    else if (file::read_file(file, &buffer, &length))
+    {
+        entry.source.assign((const char *)buffer, length);
+        free(buffer);
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    std::vector<std::pair<size_t, size_t>> specs;
+    find_specifiers(entry.source, specs);
+
+    for (auto [begin, end] : specs)
+    {
+        path target;
+        std::string url;
+        if (resolve_specifier(file.parent_path(), entry.source.substr(begin, end - begin), target, url))
+            entry.imports.push_back(Import{ begin, end, target, std::move(url) });
+    }
+
+    return &modules_.emplace(std::move(key), std::move(entry)).first->second;
+}
+
+static void rewrite_module(ModuleEntry *entry, std::vector<uint64_t> &&versions)
+{
+    if (entry->code != nullptr && versions == entry->import_versions)
+        return;
+
+    std::string code;
+    size_t offset = 0;
+    char suffix[32];
+
+    for (size_t i = 0; i < entry->imports.size(); i++)
+    {
+        const auto &import = entry->imports[i];
+        snprintf(suffix, sizeof(suffix), "?v=%016llx", (unsigned long long)versions[i]);
+
+        if (import.url.empty())
+            code.append(entry->source, offset, import.end - offset);
+        else
+            code.append(entry->source, offset, import.begin - offset).append(import.url);
+
+        code.append(suffix);
+        offset = import.end;
+    }
+    code.append(entry->source, offset, std::string::npos);
+
+    entry->code = std::make_shared<const std::string>(std::move(code));
+    entry->import_versions = std::move(versions);
+}
+
+// Version a strongly connected component, a single module or an import cycle.
+// Its imports outside of it are already built.
+static void build_component(std::vector<ModuleEntry *> &members)
+{
+    // Path order, the version doesn't depend on where the traversal started.
+    std::sort(members.begin(), members.end(), [](const ModuleEntry *a, const ModuleEntry *b)
+    {
+        return a->key < b->key;
+    });
+
+    std::unordered_set<const ModuleEntry *> inside(members.begin(), members.end());
+    std::vector<std::vector<uint64_t>> imported(members.size());
+    std::vector<uint64_t> outside;
+
+    uint64_t version = members[0]->content_hash;
+    for (size_t i = 1; i < members.size(); i++)
+        version = fnv64_1a(&members[i]->content_hash, sizeof(uint64_t), version);
+
+    for (size_t i = 0; i < members.size(); i++)
+    {
+        for (const auto &import : members[i]->imports)
+        {
+            auto dep = load_module(import.target);
+            if (dep != nullptr && inside.count(dep))
+            {
+                // Filled in with the shared version.
+                imported[i].push_back(0);
+            }
+            else
+            {
+                imported[i].push_back(dep != nullptr ? dep->version : 0);
+                outside.push_back(imported[i].back());
+            }
+        }
+    }
+
+    version = fnv64_1a(outside.data(), outside.size() * sizeof(uint64_t), version);
+    if (version == 0)
+        version = 1;
+
+    for (size_t i = 0; i < members.size(); i++)
+    {
+        auto &imports = members[i]->imports;
+        for (size_t j = 0; j < imports.size(); j++)
+        {
+            auto dep = load_module(imports[j].target);
+            if (dep != nullptr && inside.count(dep))
+                imported[i][j] = version;
+        }
+
+        rewrite_module(members[i], std::move(imported[i]));
+        members[i]->version = version;
+    }
+}
+
+// Tarjan's strongly connected components, built in reverse topological order.
+struct ModuleBuilder
+{
+    struct Visit
+    {
+        int index;
+        int lowlink;
+        bool on_stack;
+    };
+
+    std::unordered_map<ModuleEntry *, Visit> visits;
+    std::vector<ModuleEntry *> stack;
+    int next_index = 0;
+
+    void visit(ModuleEntry *entry)
+    {
+        auto &node = visits[entry];
+        node = Visit{ next_index, next_index, true };
+        next_index++;
+        stack.push_back(entry);
+
+        for (const auto &import : entry->imports)
+        {
+            auto dep = load_module(import.target);
+            if (dep == nullptr || dep->version != 0)
+                continue;
+
+            auto it = visits.find(dep);
+            if (it == visits.end())
+            {
+                visit(dep);
+                node.lowlink = std::min(node.lowlink, visits[dep].lowlink);
+            }
+            else if (it->second.on_stack)
+            {
+                node.lowlink = std::min(node.lowlink, it->second.index);
+            }
+        }
+
+        if (node.lowlink != node.index)
+            return;
+
+        std::vector<ModuleEntry *> members;
+        ModuleEntry *member;
+        do
+        {
+            member = stack.back();
+            stack.pop_back();
+            visits[member].on_stack = false;
+            members.push_back(member);
+        }
+        while (member != entry);
+
+        build_component(members);
+    }
+};
+
+bool browser::get_versioned_module(const path &file, std::shared_ptr<const std::string> &code, uint64_t &version)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto entry = load_module(file);
+    if (entry == nullptr)
+        return false;
+
+    if (entry->version == 0)
+        ModuleBuilder().visit(entry);
+
+    code = entry->code;
+    version = entry->version;
+    return true;
+}
+
+bool browser::resolve_shared_path(const std::string &rest, path &file)
+{
+    auto modules = plugin::get_shared_modules();
+    for (const auto &shared : *modules)
+    {
+        auto prefix = shared.name + "@" + shared.version + "/";
+        if (!rest.starts_with(prefix))
+            continue;
+
+        auto sub = rest.substr(prefix.length());
+        file = (shared.dir / path(std::u8string(sub.begin(), sub.end()))).lexically_normal();
+
+        // Must stay in the shared folder.
+        auto rel = file.lexically_relative(shared.dir);
+        return !rel.empty() && *rel.begin() != "..";
+    }
+    return false;
+}
+
+void browser::invalidate_modules(const std::vector<path> &files)
+{
+    // Added or removed files change how imports resolve,
+    // a manifest may declare other shared versions.
+    bool structural = std::any_of(files.begin(), files.end(), [](const path &file)
+    {
+        return file.filename() == "package.json" || file::is_dir(file) || !file::is_file(file);
+    });
+
+    if (structural)
+        plugin::invalidate_shared_modules();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (structural)
+    {
+        modules_.clear();
+        return;
+    }
+
+    for (const auto &file : files)
+        modules_.erase(file.lexically_normal().u16string());
+
+    // Versions of importers change too, rewritten code is kept if not.
+    for (auto &[key, entry] : modules_)
+        entry.version = 0;
+}
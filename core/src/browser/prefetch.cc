@@ -0,0 +1,147 @@
+#include "browser.h"
+#include <mutex>
+#include <unordered_set>
+
+// BROWSER PROCESS ONLY.
+
+// Plugin files are requested only after the renderer has booted, but it's
+// almost the same set on every launch. Files served in a session are
+// recorded in order, the next launch reads them into the asset cache on
+// the task pool while CEF is still starting.
+
+static constexpr size_t MAX_RECORDED = 4096;
+
+#ifndef _DEBUG
+void GetPreloadScript(const void **data, size_t *length);
+#endif
+static constexpr int64_t SAVE_DELAY_MS = 5000;
+
+static std::mutex mutex_;
+static std::vector<std::string> recorded_;
+static std::unordered_set<std::string> recorded_set_;
+static bool save_pending_ = false;
+
+static path get_record_path()
+{
+    return config::loader_dir() / "cache" / "prefetch.txt";
+}
+
+static void save_record()
+{
+    std::string content;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        save_pending_ = false;
+
+        for (const auto &file : recorded_)
+            content.append(file).push_back('\n');
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(get_record_path().parent_path(), ec);
+    file::write_file(get_record_path(), content.data(), content.length());
+}
+
+void browser::record_asset(const path &file)
+{
+    auto rel = file.lexically_relative(config::plugins_dir());
+    if (rel.empty() || *rel.begin() == "..")
+        return;
+
+    auto u8 = rel.generic_u8string();
+    std::string name(u8.begin(), u8.end());
+
+    bool schedule;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (recorded_.size() >= MAX_RECORDED || !recorded_set_.insert(name).second)
+            return;
+
+        recorded_.push_back(std::move(name));
+        schedule = !save_pending_;
+        save_pending_ = true;
+    }
+
+    // Save once requests settle, this session replaces the last one.
+    if (schedule)
+        task::post_to(TID_FILE_BACKGROUND, save_record, SAVE_DELAY_MS);
+}
+
+// Files of the last session in request order.
+static std::vector<path> load_record()
+{
+    std::vector<path> files;
+
+    void *buffer; size_t length;
+    if (!file::read_file(get_record_path(), &buffer, &length))
+        return files;
+
+    std::string content((const char *)buffer, length);
+    free(buffer);
+
+    auto plugins_dir = config::plugins_dir();
+
+    for (size_t pos = 0; pos < content.length() && files.size() < MAX_RECORDED; )
+    {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos)
+            end = content.length();
+
+        auto name = content.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (name.empty())
+            continue;
+
+        // Must stay in the plugins dir.
+        path file = (plugins_dir / path(std::u8string(name.begin(), name.end()))).lexically_normal();
+        auto rel = file.lexically_relative(plugins_dir);
+        if (!rel.empty() && *rel.begin() != "..")
+            files.push_back(std::move(file));
+    }
+
+    return files;
+}
+
+void browser::prefetch_startup()
+{
+    // Read-ahead hints, ahead of the asset prefetch on the pool.
+    task::run([]
+    {
+        // CefInitialize runs much of it.
+        if (void *libcef = dylib::find_lib(LIBCEF_MODULE_NAME))
+            dylib::prefetch(dylib::find_proc(libcef, "cef_version_info"));
+
+#ifdef _DEBUG
+        file::prefetch(config::loader_dir() / "../plugins/dist/preload.js");
+#else
+        // The preload is embedded in our image, only its range is read.
+        const void *preload; size_t length;
+        GetPreloadScript(&preload, &length);
+        dylib::prefetch(preload, length);
+#endif
+
+        file::prefetch(config::datastore_path());
+    }, task::PRIORITY_HIGH);
+}
+
+void browser::prefetch_assets()
+{
+    auto files = load_record();
+    if (files.empty())
+        return;
+
+    // Interleaved chunks, the first requested files are read first.
+    size_t chunks = std::min(task::worker_count(), files.size());
+    auto shared = std::make_shared<const std::vector<path>>(std::move(files));
+
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        task::run([shared, chunk, chunks]
+        {
+            browser::CachedAsset asset;
+            for (size_t i = chunk; i < shared->size(); i += chunks)
+                browser::get_cached_asset((*shared)[i], asset);
+        });
+    }
+}
@@ -1,4 +1,5 @@
 #include "browser.h"
+#include "coro.h"
 #include "include/capi/cef_parser_capi.h"
 #include "include/capi/cef_scheme_capi.h"
 #include "include/capi/cef_urlrequest_capi.h"
@@ -8,108 +9,66 @@
 static std::string url_origin_;
 static std::string authorization_;
 
-class RiotClientURLRequestClient : public CefRefCount<cef_urlrequest_client_t>
-{
-public:
-    RiotClientURLRequestClient(std::string *data, cef_callback_t *response_callback)
-        : CefRefCount(this), data_(data), done_(false), response_length_(-1), response_callback_(response_callback)
-    {
-        cef_urlrequest_client_t::on_request_complete = _on_request_complete;
-        cef_urlrequest_client_t::on_download_progress = _on_download_progress;
-        cef_urlrequest_client_t::on_download_data = _on_download_data;
-    }
-
-private:
-    std::string *data_;
-    cef_callback_t *response_callback_;
-    int64 response_length_;
-    bool done_;
-
-    friend struct RiotClientResourceHandler;
-
-    static void CEF_CALLBACK _on_request_complete(cef_urlrequest_client_t *_, struct _cef_urlrequest_t *request)
-    {
-        auto self = static_cast<RiotClientURLRequestClient *>(_);
-        self->done_ = true;
-    }
-
-    static void CEF_CALLBACK _on_download_progress(cef_urlrequest_client_t *_,
-                                                   struct _cef_urlrequest_t *request, int64 current, int64 total)
-    {
-        auto self = static_cast<RiotClientURLRequestClient *>(_);
-        self->response_length_ = total;
-    }
-
-    static void CEF_CALLBACK _on_download_data(cef_urlrequest_client_t *_,
-                                               struct _cef_urlrequest_t *request, const void *data, size_t data_length)
-    {
-        auto self = static_cast<RiotClientURLRequestClient *>(_);
-        self->data_->append(static_cast<const char *>(data), data_length);
-
-        if (self->response_callback_)
-        {
-            self->response_callback_->cont(self->response_callback_);
-            self->response_callback_ = nullptr;
-        }
-    }
-};
-
 struct RiotClientResourceHandler : CefRefCount<cef_resource_handler_t>
 {
     RiotClientResourceHandler(cef_frame_t *frame)
-        : CefRefCount(this), frame_(frame), bytes_read_(0), client_(nullptr), data_{}
+        : CefRefCount(this), frame_(frame), request_(nullptr), bytes_read_(0), canceled_(false)
     {
         cef_bind_method(RiotClientResourceHandler, open);
-        cef_bind_method(RiotClientResourceHandler, process_request);
         cef_bind_method(RiotClientResourceHandler, get_response_headers);
         cef_bind_method(RiotClientResourceHandler, read);
+        cef_bind_method(RiotClientResourceHandler, cancel);
+    }
+
+    ~RiotClientResourceHandler()
+    {
+        if (request_ != nullptr)
+            request_->base.release(&request_->base);
     }
 
 private:
     cef_frame_t *frame_;
-    RiotClientURLRequestClient *client_;
-    cef_urlrequest_t *url_request_;
-    std::string data_;
+    coro::UrlRequest *request_;
     int64 bytes_read_;
+    bool canceled_;
 
     int _open(struct _cef_request_t *request, int *handle_request, struct _cef_callback_t *callback)
-    {
-        *handle_request = 0;
-        return 0;
-    }
-
-    int _process_request(struct _cef_request_t *request, struct _cef_callback_t *callback)
     {
         CefScopedStr url{request->get_url(request)};
         CefScopedStr method{request->get_method(request)};
 
-        std::u16string real_url;
-        real_url.append(std::u16string(url_origin_.begin(), url_origin_.end()));
-        real_url.append((char16_t *)url.str + 18, url.length - 18);
-        cef_string_t url2{(char16 *)&real_url[0], real_url.length(), nullptr};
-
         auto body = request->get_post_data(request);
         auto headers = cef_string_multimap_alloc();
         request->get_header_map(request, headers);
 
-        auto request2 = cef_request_create();
-        request2->set(request2, &url2, &method, body, headers);
-        request2->set_header_by_name(request2, &u"Authorization"_s, &CefStr(authorization_), 1);
+        auto request2 = browser::create_riotclient_request(url.to_utf16(), &method, body, headers);
+        cef_string_multimap_free(headers);
 
-        client_ = new RiotClientURLRequestClient(&data_, callback);
-        url_request_ = frame_->create_urlrequest(frame_, request2, client_);
+        request_ = coro::UrlRequest::create(frame_, request2);
+        forward_response(callback);
 
-        cef_string_multimap_free(headers);
+        // Continue asynchronously.
+        *handle_request = 0;
         return 1;
     }
 
+    coro::detached forward_response(cef_callback_t *callback)
+    {
+        base.add_ref(&base);
+        co_await request_->response();
+
+        if (!canceled_)
+            callback->cont(callback);
+
+        base.release(&base);
+    }
+
     void _get_response_headers(struct _cef_response_t *response, int64 *response_length, cef_string_t *redirectUrl)
     {
         // Forward response
-        if (auto res = url_request_->get_response(url_request_))
+        if (auto res = request_->get_response())
         {
             auto status = res->get_status(res);
-            auto error = res->get_error(res);
             auto headers = cef_string_multimap_alloc();
             res->get_header_map(res, headers);
 
@@ -118,26 +77,58 @@ private:
 
             cef_string_multimap_free(headers);
         }
+        else
+        {
+            response->set_error(response, ERR_FAILED);
+        }
 
         // Bypass cors
         response->set_header_by_name(response, &u"Access-Control-Allow-Origin"_s, &u"*"_s, 1);
-        *response_length = client_->response_length_;
+        *response_length = request_->total_length();
     }
 
     int _read(void *data_out, int bytes_to_read, int *bytes_read, cef_resource_read_callback_t *callback)
     {
-        if ((client_->response_length_ > 0 && bytes_read_ >= client_->response_length_) || (bytes_read_ >= (int64)data_.length() && client_->done_))
-        {
-            *bytes_read = 0;
-            return false;
-        }
+        *bytes_read = copy_data(data_out, bytes_to_read);
+
+        if (*bytes_read > 0)
+            return 1;
+
+        if (request_->done())
+            return 0;
+
+        // Wait for more data, data_out stays valid until the callback.
+        read_async(data_out, bytes_to_read, callback);
+        return 1;
+    }
 
-        int read = min_(bytes_to_read, static_cast<int>(data_.length() - bytes_read_));
-        memcpy(data_out, data_.c_str() + bytes_read_, read);
+    coro::detached read_async(void *data_out, int bytes_to_read, cef_resource_read_callback_t *callback)
+    {
+        base.add_ref(&base);
+        co_await request_->data((size_t)bytes_read_);
+
+        // Zero bytes completes the response.
+        if (!canceled_)
+            callback->cont(callback, copy_data(data_out, bytes_to_read));
+
+        base.release(&base);
+    }
 
+    void _cancel()
+    {
+        canceled_ = true;
+        if (request_ != nullptr)
+            request_->cancel();
+    }
+
+    int copy_data(void *data_out, int bytes_to_read)
+    {
+        auto &data = request_->body();
+        int read = min_(bytes_to_read, static_cast<int>(data.length() - bytes_read_));
+
+        memcpy(data_out, data.c_str() + bytes_read_, read);
         bytes_read_ += read;
-        *bytes_read = read;
-        return true;
+        return read;
     }
 
     static inline int min_(int a, int b)
@@ -164,6 +155,23 @@ struct RiotClientSchemeHandlerFactory : CefRefCount<cef_scheme_handler_factory_t
     }
 };
 
+cef_request_t *browser::create_riotclient_request(const std::u16string &url, const cef_string_t *method,
+    cef_post_data_t *body, cef_string_multimap_t headers)
+{
+    // Skip 'https://riotclient'.
+    std::u16string real_url(url_origin_.begin(), url_origin_.end());
+    if (url.length() > 18)
+        real_url.append(url, 18);
+
+    cef_string_t url2{(char16 *)&real_url[0], real_url.length(), nullptr};
+
+    auto request = cef_request_create();
+    request->set(request, &url2, method, body, headers);
+    request->set_header_by_name(request, &u"Authorization"_s, &CefStr(authorization_), 1);
+
+    return request;
+}
+
 void browser::register_riotclient_domain(cef_request_context_t *ctx)
 {
     if (!config::options::use_riotclient())
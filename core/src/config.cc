@@ -1,10 +1,11 @@
 #include "pengu.h"
 #include <fstream>
+#include <mutex>
 #include <unordered_map>
 
 #if OS_WIN
 EXTERN_C IMAGE_DOS_HEADER __ImageBase;
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
 #include <dlfcn.h>
 #include <libgen.h>
 #endif
@@ -41,7 +42,7 @@ path config::loader_dir()
         // Get parent folder.
         return path = dir.substr(0, dir.find_last_of(L"/\\"));
     }
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
     static std::string path;
     if (path.empty())
     {
@@ -50,6 +51,8 @@ path config::loader_dir()
         {
             path = info.dli_fname;
             path = path.substr(0, path.rfind('/'));
+            // Relative if the binary was started by one, e.g. ./bin/bench.
+            path = std::filesystem::path(path).lexically_normal().string();
         }
     }
 #endif
@@ -72,9 +75,11 @@ path config::cache_dir()
 
     lstrcatW(path, L"\\Riot Games\\League of Legends\\Cache");
     return path;
-#else
+#elif OS_MAC
     // inside the RiotClient folder 
     return "/Users/Shared/Riot Games/League Client/Cache";
+#else
+    return loader_dir() / "cache";
 #endif
 }
 
@@ -97,53 +102,68 @@ static void trim_tring(std::string &str)
     str.erase(0, str.find_first_not_of(' '));
 }
 
-static auto get_config_map()
+using ConfigMap = std::unordered_map<std::string, std::string>;
+
+static std::mutex config_mutex_;
+static std::shared_ptr<const ConfigMap> config_map_;
+
+static std::shared_ptr<const ConfigMap> read_config_map()
 {
-    static bool cached = false;
-    static std::unordered_map<std::string, std::string> map;
+    auto map = std::make_shared<ConfigMap>();
+    auto path = config::loader_dir() / "config";
+    std::ifstream file(path);
 
-    if (!cached)
+    if (file.is_open())
     {
-        auto path = config::loader_dir() / "config";
-        std::ifstream file(path);
-
-        if (file.is_open())
+        std::string line;
+        while (std::getline(file, line))
         {
-            std::string line;
-            while (std::getline(file, line))
-            {
-                // ignore empty line or comment
-                if (line.empty() || line[0] == ';' || line[0] == '#')
-                    continue;
+            // ignore empty line or comment
+            if (line.empty() || line[0] == ';' || line[0] == '#')
+                continue;
 
-                size_t pos = line.find('=');
-                if (pos != std::string::npos)
-                {
-                    std::string key = line.substr(0, pos);
-                    std::string value = line.substr(pos + 1);
+            size_t pos = line.find('=');
+            if (pos != std::string::npos)
+            {
+                std::string key = line.substr(0, pos);
+                std::string value = line.substr(pos + 1);
 
-                    trim_tring(key);
-                    trim_tring(value);
+                trim_tring(key);
+                trim_tring(value);
 
-                    map[key] = value;
-                }
+                (*map)[key] = value;
             }
-            file.close();
         }
-
-        cached = true;
+        file.close();
     }
 
     return map;
 }
 
+static std::shared_ptr<const ConfigMap> get_config_map()
+{
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    if (config_map_ == nullptr)
+        config_map_ = read_config_map();
+
+    return config_map_;
+}
+
+void config::reload()
+{
+    auto map = read_config_map();
+
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    config_map_ = std::move(map);
+}
+
 static std::string get_config_value(const char *key, const char *fallback)
 {
     auto map = get_config_map();
-    auto it = map.find(key);
+    auto it = map->find(key);
     std::string value = fallback;
 
-    if (it != map.end())
+    if (it != map->end())
         value = it->second;
 
     return value;
@@ -152,10 +172,10 @@ static std::string get_config_value(const char *key, const char *fallback)
 static bool get_config_value_bool(const char *key, bool fallback)
 {
     auto map = get_config_map();
-    auto it = map.find(key);
+    auto it = map->find(key);
     bool value = fallback;
 
-    if (it != map.end())
+    if (it != map->end())
     {
         if (it->second == "0" || it->second == "false")
             value = false;
@@ -169,10 +189,10 @@ static bool get_config_value_bool(const char *key, bool fallback)
 static int get_config_value_int(const char *key, int fallback)
 {
     auto map = get_config_map();
-    auto it = map.find(key);
+    auto it = map->find(key);
     int value = fallback;
 
-    if (it != map.end())
+    if (it != map->end())
         value = std::stoi(it->second);
 
     return value;
@@ -181,10 +201,11 @@ static int get_config_value_int(const char *key, int fallback)
 path config::plugins_dir()
 {
     std::string cpath = get_config_value(__func__, "");
-    if (!cpath.empty())
-        return (const char8_t *)cpath.c_str();
+    path dir = cpath.empty() ? loader_dir() / "plugins" : path((const char8_t *)cpath.c_str());
 
-    return loader_dir() / "plugins";
+    // Normal like import targets and watcher paths, they're compared to it.
+    dir = dir.lexically_normal();
+    return dir.has_filename() || !dir.has_relative_path() ? dir : dir.parent_path();
 }
 
 std::string config::disabled_plugins()
@@ -234,8 +255,18 @@ namespace config::options
         return get_config_value_bool(__func__, false);
     }
 
+    bool startup_bundle()
+    {
+        return get_config_value_bool(__func__, false);
+    }
+
     int debug_port()
     {
         return get_config_value_int(__func__, 0);
     }
+
+    bool record_events()
+    {
+        return get_config_value_bool(__func__, false);
+    }
 }
\ No newline at end of file
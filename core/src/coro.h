@@ -0,0 +1,216 @@
+#ifndef _CORO_H_
+#define _CORO_H_
+
+#include "pengu.h"
+#include <coroutine>
+#include <exception>
+#include "include/capi/cef_frame_capi.h"
+#include "include/capi/cef_task_capi.h"
+#include "include/capi/cef_urlrequest_capi.h"
+
+///
+/// Coroutine adapters for CEF asynchronous callbacks.
+///
+/// Handlers can be written as straight-line code, every await suspends
+/// without blocking the CEF thread and resumes through a CEF callback or task:
+///
+/// coro::detached proxy(cef_request_t *request, cef_callback_t *callback) {
+///     auto req = coro::UrlRequest::create(frame, request);
+///     co_await req->response();
+///     callback->cont(callback);
+///     co_await req->complete();
+///     co_await coro::post_to(TID_UI);
+///     // ...
+/// }
+///
+/// Arguments must be taken by value, references don't outlive the first await.
+///
+
+namespace coro
+{
+    ///
+    /// Fire-and-forget coroutine, it starts eagerly and frees itself when done.
+    ///
+    struct detached
+    {
+        struct promise_type
+        {
+            detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    ///
+    /// Resume on a CEF thread, continues inline if it's the current thread.
+    ///
+    struct post_to
+    {
+        cef_thread_id_t tid;
+
+        bool await_ready() const noexcept
+        {
+            return cef_currently_on(tid);
+        }
+
+        void await_suspend(std::coroutine_handle<> h) const
+        {
+            task::post_to(tid, [h] { h.resume(); });
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    ///
+    /// Resume on the task pool, hop back later with `post_to()`.
+    ///
+    struct background
+    {
+        task::priority priority = task::PRIORITY_NORMAL;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h) const
+        {
+            task::run([h] { h.resume(); }, priority);
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    ///
+    /// Read a whole file on the task pool, then resume on `tid`.
+    /// @returns The content, `ok` is false on failure.
+    ///
+    struct file_read
+    {
+        path file;
+        cef_thread_id_t tid;
+
+        struct result
+        {
+            bool ok;
+            std::string data;
+        } result_{};
+
+        file_read(const path &file, cef_thread_id_t tid)
+            : file(file), tid(tid) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            task::run([this, h] {
+                void *buffer; size_t length;
+                if ((result_.ok = file::read_file(file, &buffer, &length)))
+                {
+                    result_.data.assign(static_cast<char *>(buffer), length);
+                    free(buffer);
+                }
+                task::post_to(tid, [h] { h.resume(); });
+            });
+        }
+
+        result await_resume() noexcept
+        {
+            return std::move(result_);
+        }
+    };
+
+    ///
+    /// A URL request whose progress can be awaited.
+    /// Callbacks and resumes happen on the thread which created it.
+    ///
+    class UrlRequest : public CefRefCount<cef_urlrequest_client_t>
+    {
+    public:
+        ///
+        /// Start a request, from a frame if it's not null.
+        /// The returned object holds a reference, release it when done.
+        ///
+        static UrlRequest *create(cef_frame_t *frame, cef_request_t *request);
+
+        struct awaiter
+        {
+            UrlRequest *self;
+            size_t offset;
+            bool (*ready)(UrlRequest *self, size_t offset);
+
+            bool await_ready() const noexcept { return ready(self, offset); }
+            void await_suspend(std::coroutine_handle<> h) noexcept
+            {
+                self->waiter_ = h;
+                self->ready_ = ready;
+                self->offset_ = offset;
+            }
+            void await_resume() const noexcept {}
+        };
+
+        ///
+        /// Wait for the response, it's available after the first data
+        /// arrives or the request completes.
+        ///
+        awaiter response() { return { this, 0, &has_response }; }
+
+        ///
+        /// Wait for more than `offset` bytes of data, or completion.
+        ///
+        awaiter data(size_t offset) { return { this, offset, &has_data }; }
+
+        ///
+        /// Wait for the request to complete.
+        ///
+        awaiter complete() { return { this, 0, &is_complete }; }
+
+        bool done() const { return done_; }
+        const std::string &body() const { return data_; }
+
+        ///
+        /// Total length of the response, or -1 if it's unknown.
+        ///
+        int64 total_length() const { return total_; }
+
+        ///
+        /// Request status, valid once complete.
+        ///
+        cef_urlrequest_status_t status() const { return status_; }
+
+        ///
+        /// Get the response without transferring ownership.
+        ///
+        cef_response_t *get_response();
+
+        void cancel();
+
+    private:
+        UrlRequest();
+        ~UrlRequest();
+
+        cef_urlrequest_t *request_;
+        cef_response_t *response_;
+        std::string data_;
+        int64 total_;
+        bool done_;
+        cef_urlrequest_status_t status_;
+
+        std::coroutine_handle<> waiter_;
+        bool (*ready_)(UrlRequest *, size_t);
+        size_t offset_;
+
+        void notify();
+
+        static bool has_response(UrlRequest *self, size_t);
+        static bool has_data(UrlRequest *self, size_t offset);
+        static bool is_complete(UrlRequest *self, size_t);
+
+        void _on_request_complete(struct _cef_urlrequest_t *request);
+        void _on_download_progress(struct _cef_urlrequest_t *request, int64 current, int64 total);
+        void _on_download_data(struct _cef_urlrequest_t *request, const void *data, size_t data_length);
+
+        friend struct CefRefCount<cef_urlrequest_client_t>;
+    };
+}
+
+#endif
@@ -13,6 +13,10 @@
 #include <mach/mach_vm.h>
 #include <sys/mman.h>
 #include <dlfcn.h>
+#elif OS_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#include <dlfcn.h>
 #endif
 
 namespace hook
@@ -21,7 +25,7 @@ namespace hook
     {
 #if OS_WIN
         uint8_t opcodes[12];
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
         uint8_t opcodes[16];
 #endif
         Shellcode(intptr_t addr)
@@ -36,7 +40,7 @@ namespace hook
             opcodes[10] = 0x50;
             // ret
             opcodes[11] = 0xC3;
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
             // jmp qword ptr [rip + offset] ; pad 2
             opcodes[0] = 0xFF;
             opcodes[1] = 0x25;
@@ -98,6 +102,16 @@ namespace hook
                                  (mach_vm_address_t)dst, (mach_vm_size_t)size,
                                  FALSE, VM_PROT_READ | VM_PROT_EXECUTE);
             return kr == KERN_SUCCESS;
+#elif OS_LINUX
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            uintptr_t start = (uintptr_t)dst & ~(page - 1);
+            size_t length = ((uintptr_t)dst + size) - start;
+
+            if (mprotect((void *)start, length, PROT_READ | PROT_WRITE | PROT_EXEC) != 0)
+                return false;
+
+            memcpy(dst, src, size);
+            return mprotect((void *)start, length, PROT_READ | PROT_EXEC) == 0;
 #endif
         }
     };
@@ -138,7 +152,7 @@ namespace hook
 #if OS_WIN
             if (HMODULE mod = GetModuleHandleA(lib))
                 if (Fn orig = reinterpret_cast<Fn>(GetProcAddress(mod, proc)))
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
             if (void *mod = dlopen(lib, RTLD_NOLOAD | RTLD_LAZY))
                 if (Fn orig = reinterpret_cast<Fn>(dlsym(mod, proc)))
 #endif
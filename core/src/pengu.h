@@ -5,10 +5,11 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef OS_WIN
 #include <windows.h>
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
 #include <unistd.h>
 #define CALLBACK
 #endif
@@ -17,6 +18,7 @@
 #include <atomic>
 #include <string>
 #include <vector>
+#include <functional>
 #include <filesystem>
 
 using path = std::filesystem::path;
@@ -339,6 +341,11 @@ namespace config
     /// 
     std::string disabled_plugins();
 
+    ///
+    /// Read the config file again, the next lookups see the new values.
+    /// 
+    void reload();
+
     namespace options
     {
         bool use_hotkeys();
@@ -349,9 +356,11 @@ namespace config
         bool use_devtools();
         bool use_riotclient();
         bool use_proxy();
+        bool startup_bundle();
 
         // undocumented
         int debug_port();
+        bool record_events();
     }
 }
 
@@ -378,6 +387,104 @@ namespace file
     /// 
     bool is_symlink(const path &path);
 
+    ///
+    /// Read-only file handle with positional and sequential reads.
+    /// 
+    class File
+    {
+    public:
+        File() = default;
+        ~File();
+
+        File(const File &) = delete;
+        File &operator=(const File &) = delete;
+
+        ///
+        /// Open a file for reading, it can still be written or deleted by others.
+        /// @returns false with `ec` set on failure.
+        /// 
+        bool open(const path &path, std::error_code &ec);
+
+        ///
+        /// Open a file for reading and appending, it's created if missing.
+        /// @returns false with `ec` set on failure.
+        /// 
+        bool open_append(const path &path, std::error_code &ec);
+
+        void close();
+
+        bool is_open() const;
+
+        ///
+        /// Get the current file size.
+        /// @returns -1 with `ec` set on failure.
+        /// 
+        int64_t size(std::error_code &ec) const;
+
+        ///
+        /// Read at the current position and advance it.
+        /// @returns Bytes read, less than `length` at the end of file or on failure with `ec` set.
+        /// 
+        size_t read(void *buffer, size_t length, std::error_code &ec);
+
+        ///
+        /// Read at an offset, the current position is not used or changed.
+        /// @returns Bytes read, less than `length` at the end of file or on failure with `ec` set.
+        /// 
+        size_t read_at(void *buffer, size_t length, int64_t offset, std::error_code &ec) const;
+
+        ///
+        /// Write at the end of a file opened with `open_append()`.
+        /// @returns false with `ec` set on failure, a part may have been written.
+        /// 
+        bool append(const void *buffer, size_t length, std::error_code &ec);
+
+        ///
+        /// Lock the file exclusively without waiting, other processes can't lock it
+        /// until it's closed. It's advisory on macOS and Linux.
+        /// @returns false with `ec` set if it's locked or on failure.
+        /// 
+        bool try_lock(std::error_code &ec);
+
+    private:
+        friend class MappedFile;
+#if OS_WIN
+        HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+        int fd_ = -1;
+#endif
+        int64_t position_ = 0;
+    };
+
+    ///
+    /// Read-only memory-mapped view of a whole file.
+    /// The file must not be truncated while mapped.
+    /// 
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ///
+        /// Map a file, an empty file has no data.
+        /// @returns false with `ec` set on failure.
+        /// 
+        bool open(const path &path, std::error_code &ec);
+
+        void close();
+
+        const uint8_t *data() const { return data_; }
+        size_t size() const { return size_; }
+
+    private:
+        const uint8_t *data_ = nullptr;
+        size_t size_ = 0;
+    };
+
     ///
     /// Read content of a file.
     /// @param path Path to file.
@@ -396,12 +503,193 @@ namespace file
     /// 
     bool write_file(const path &path, const void *buffer, size_t length);
 
+    ///
+    /// Write a file aside then rename it over, readers in other processes
+    /// see the old or the new content, never a partial one.
+    /// @returns true if success.
+    /// 
+    bool write_file_atomic(const path &path, const void *buffer, size_t length);
+
+    ///
+    /// Read a file into the page cache. It's only a hint on macOS and Linux,
+    /// a plain read on Windows, call it on the task pool.
+    /// @param path Path to file.
+    /// @returns false if the file can't be opened.
+    /// 
+    bool prefetch(const path &path);
+
     ///
     /// Get files inside a dir.
     /// @param path Path to dir.
     /// @returns A vector of file paths.
     /// 
     std::vector<path> read_dir(const path &dir);
+
+    struct DirEntry
+    {
+        path name;
+        bool is_dir;
+        bool is_file;
+        bool is_symlink;
+        int64_t size;           // -1 if not requested or not a file
+        int64_t mtime;          // nanoseconds since Unix epoch, -1 if not requested
+    };
+
+    ///
+    /// Get typed entries inside a dir, without a stat call per entry where the OS allows.
+    /// Symlinks are resolved to their target type.
+    /// @param dir Path to dir.
+    /// @param stat Also fill size and mtime.
+    /// @returns A vector of entries, "." and ".." excluded.
+    /// 
+    std::vector<DirEntry> read_dir_entries(const path &dir, bool stat = false);
+}
+
+namespace plugin
+{
+    ///
+    /// Plugin manifest, the "pengu" field of package.json in the plugin folder.
+    /// 
+    struct SharedDependency
+    {
+        std::string name;       // bare specifier, e.g `solid-js`
+        std::string version;    // e.g `1.7.8`
+        std::string entry;      // relative to the plugin folder
+    };
+
+    struct Manifest
+    {
+        // Stylesheets injected before the first paint, relative to the plugin folder.
+        std::vector<std::string> styles;
+
+        // Libraries shared with other plugins, one copy of each name is loaded.
+        std::vector<SharedDependency> shared;
+
+        // Plugins that must finish init first, by name, e.g `@author/plugin` or `plugin.js`.
+        std::vector<std::string> dependencies;
+    };
+
+    ///
+    /// A plugin entry in load order, placed after all of its prerequisites.
+    /// 
+    struct LoadItem
+    {
+        path entry;
+        std::vector<int> dependencies;  // indices of prerequisites, all lower
+        int wave;                       // 0 without prerequisites
+    };
+
+    ///
+    /// A resolved shared dependency, served under `https://plugins/@shared/<name>@<version>/`.
+    /// 
+    struct SharedModule
+    {
+        std::string name;
+        std::string version;
+        path dir;               // the folder of the entry
+        path file;              // entry file name in the folder
+    };
+
+    ///
+    /// Read the manifest of a plugin folder.
+    /// @returns false if there's no package.json or no "pengu" field.
+    /// 
+    bool read_manifest(const path &dir, Manifest &manifest);
+
+    ///
+    /// Check if a plugin entry is disabled, the same way the preload loader does.
+    /// @param entry Entry path relative to the plugins dir, e.g `plugin/index.js`.
+    /// 
+    bool is_disabled(const path &entry);
+
+    ///
+    /// Scan the plugins dir for entries.
+    /// @returns Entry paths relative to the plugins dir, disabled ones included.
+    /// 
+    std::vector<path> get_entries();
+
+    ///
+    /// Resolve manifest dependencies of plugin entries into waves, a plugin can
+    /// load as soon as its prerequisites are done. Unknown and disabled prerequisites
+    /// are ignored, and cycles are broken at the first entry of the cycle.
+    /// @param entries Entry paths relative to the plugins dir.
+    /// @returns The entries in load order.
+    /// 
+    std::vector<LoadItem> resolve_load_order(const std::vector<path> &entries);
+
+    ///
+    /// Get shared dependencies declared by enabled plugins, the highest version of each name wins.
+    /// Resolved once and kept until invalidated.
+    /// 
+    std::shared_ptr<const std::vector<SharedModule>> get_shared_modules();
+
+    ///
+    /// Drop the resolved shared dependencies, e.g after a manifest changed.
+    /// 
+    void invalidate_shared_modules();
+}
+
+namespace watcher
+{
+    using callback = std::function<void(const std::vector<path> &files)>;
+
+    ///
+    /// Watch a dir recursively for changes.
+    /// Events are coalesced, the callback runs on the task pool once the dir has been quiet for a moment.
+    /// @param dir Path to dir.
+    /// @param fn Called with the changed paths, a dir path means anything in it may have changed.
+    /// @returns Subscription id, 0 on failure.
+    /// 
+    int subscribe(const path &dir, callback fn);
+
+    ///
+    /// Stop a subscription.
+    /// @param id Subscription id.
+    /// 
+    void unsubscribe(int id);
+}
+
+namespace task
+{
+    enum priority
+    {
+        PRIORITY_HIGH,
+        PRIORITY_NORMAL,
+        PRIORITY_LOW,
+        PRIORITY_COUNT,
+    };
+
+    ///
+    /// Get the number of pool workers, sized to the hardware.
+    /// 
+    size_t worker_count();
+
+    ///
+    /// Run a function on the shared work-stealing pool.
+    /// Higher priority work is picked first by every worker.
+    /// @note No CEF thread is current, hop back with `post_to()`.
+    /// 
+    void run(std::function<void()> fn, priority p = PRIORITY_NORMAL);
+
+    ///
+    /// Post a function to a CEF thread e.g `TID_UI`, `TID_IO` or `TID_RENDERER`.
+    /// @returns true if the task was posted.
+    /// 
+    bool post_to(cef_thread_id_t tid, std::function<void()> fn);
+    bool post_to(cef_thread_id_t tid, std::function<void()> fn, int64_t delay_ms);
+
+    ///
+    /// Run `work` on the pool, then pass its result to `done` on a CEF thread.
+    /// 
+    template <typename Work, typename Done>
+    static inline void run_then(Work work, cef_thread_id_t tid, Done done, priority p = PRIORITY_NORMAL)
+    {
+        run([work, tid, done]() mutable {
+            post_to(tid, [result = work(), done]() mutable {
+                done(std::move(result));
+            });
+        }, p);
+    }
 }
 
 namespace dialog
@@ -526,6 +814,18 @@ namespace dylib
     /// @param pattern Matching pattern e.g `AA BB CC 00`, also allows wildcard `AA ?? FF`.
     ///
     void *find_memory(const void *rladdr, const char *pattern);
+
+    ///
+    /// Hint the OS to page in the range of a module searched by `find_memory()`,
+    /// it returns before the reads are done.
+    /// @param rladdr Relative address near to the module's address space.
+    ///
+    void prefetch(const void *rladdr);
+
+    ///
+    /// Hint the OS to page in an address range, e.g. data embedded in an image.
+    ///
+    void prefetch(const void *address, size_t length);
 }
 
 #endif
\ No newline at end of file
@@ -12,6 +12,11 @@
 #ifndef OS_MAC
 #define OS_MAC 1
 #endif
+#elif defined(__linux__)
+// Linux is only used to host the benchmarks.
+#ifndef OS_LINUX
+#define OS_LINUX 1
+#endif
 #else
 #error "Your platform is not supported."
 #endif
@@ -38,6 +43,9 @@
 #elif OS_MAC
 #define PLATFORM_NAME "mac"
 #define LIBCEF_MODULE_NAME "League of Legends.app/Contents/Frameworks/Chromium Embedded Framework.framework/Chromium Embedded Framework"
+#elif OS_LINUX
+#define PLATFORM_NAME "linux"
+#define LIBCEF_MODULE_NAME "libcef.so"
 #endif
 
 #ifndef NDEBUG
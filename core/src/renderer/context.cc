@@ -0,0 +1,86 @@
+#include "renderer.h"
+#include <algorithm>
+
+// Contexts get a new CAPI wrapper on every call, they're compared by is_same().
+// All calls are on the renderer main thread.
+
+struct ContextEntry
+{
+    cef_v8context_t *context;
+    std::vector<std::function<void()>> resources;
+    std::vector<const void *> keys;
+};
+
+static std::vector<ContextEntry> contexts_;
+
+static std::vector<ContextEntry>::iterator find_context(cef_v8context_t *context)
+{
+    return std::find_if(contexts_.begin(), contexts_.end(), [context](const ContextEntry &entry)
+    {
+        // The argument reference is taken by is_same().
+        context->base.add_ref(&context->base);
+        return entry.context->is_same(entry.context, context);
+    });
+}
+
+void renderer::track_context(cef_v8context_t *context)
+{
+    if (find_context(context) != contexts_.end())
+        return;
+
+    context->base.add_ref(&context->base);
+    contexts_.push_back(ContextEntry{ context, {}, {} });
+}
+
+void renderer::release_context(cef_v8context_t *context)
+{
+    auto it = find_context(context);
+    if (it == contexts_.end())
+        return;
+
+    // Out of the list first, a release may register again.
+    auto entry = std::move(*it);
+    contexts_.erase(it);
+
+    for (auto res = entry.resources.rbegin(); res != entry.resources.rend(); ++res)
+        (*res)();
+
+    entry.context->base.release(&entry.context->base);
+}
+
+static ContextEntry *current_entry()
+{
+    auto current = cef_v8context_get_current_context();
+    if (current == nullptr)
+        return nullptr;
+
+    auto it = find_context(current);
+    current->base.release(&current->base);
+
+    return it == contexts_.end() ? nullptr : &*it;
+}
+
+bool renderer::on_context_released(std::function<void()> release)
+{
+    auto entry = current_entry();
+    if (entry == nullptr)
+        return false;
+
+    entry->resources.push_back(std::move(release));
+    return true;
+}
+
+bool renderer::on_context_released(const void *key, std::function<void()> release)
+{
+    auto entry = current_entry();
+    if (entry == nullptr)
+        return false;
+
+    if (std::find(entry->keys.begin(), entry->keys.end(), key) == entry->keys.end())
+    {
+        entry->keys.push_back(key);
+        entry->resources.push_back(std::move(release));
+    }
+
+    return true;
+}
@@ -0,0 +1,91 @@
+#ifndef _EVENT_RECORD_H_
+#define _EVENT_RECORD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+///
+/// Compact recording of the LCU WAMP event stream.
+/// 
+/// File layout:
+///   header  := magic "PGREC" | u8 version | u64le start time (unix ms)
+///   record  := varint delta (us since the previous record) | varint size | raw WAMP message
+/// 
+/// Records are appended by the renderer while recording is enabled,
+/// and read back by the replay tool in bench/tools.
+/// 
+
+#define EVENT_RECORD_MAGIC "PGREC"
+#define EVENT_RECORD_VERSION 1
+#define EVENT_RECORD_HEADER_SIZE 14
+
+namespace event_record
+{
+    ///
+    /// Write a LEB128 varint.
+    /// @returns Number of bytes written, at most 10.
+    /// 
+    static inline size_t put_varint(uint8_t *out, uint64_t value)
+    {
+        size_t n = 0;
+        while (value >= 0x80)
+        {
+            out[n++] = static_cast<uint8_t>(value) | 0x80;
+            value >>= 7;
+        }
+        out[n++] = static_cast<uint8_t>(value);
+        return n;
+    }
+
+    ///
+    /// Read a LEB128 varint.
+    /// @returns Number of bytes read, 0 if the input is truncated.
+    /// 
+    static inline size_t get_varint(const uint8_t *in, size_t length, uint64_t *value)
+    {
+        *value = 0;
+        for (size_t n = 0; n < length && n < 10; n++)
+        {
+            *value |= static_cast<uint64_t>(in[n] & 0x7F) << (7 * n);
+            if ((in[n] & 0x80) == 0)
+                return n + 1;
+        }
+        return 0;
+    }
+
+    ///
+    /// Fill the file header.
+    /// 
+    static inline void put_header(uint8_t out[EVENT_RECORD_HEADER_SIZE], uint64_t start_ms)
+    {
+        for (size_t i = 0; i < 5; i++)
+            out[i] = static_cast<uint8_t>(EVENT_RECORD_MAGIC[i]);
+        out[5] = EVENT_RECORD_VERSION;
+        for (size_t i = 0; i < 8; i++)
+            out[6 + i] = static_cast<uint8_t>(start_ms >> (8 * i));
+    }
+
+    ///
+    /// Validate the file header.
+    /// @returns true if the header is valid, `start_ms` is set.
+    /// 
+    static inline bool get_header(const uint8_t *in, size_t length, uint64_t *start_ms)
+    {
+        if (length < EVENT_RECORD_HEADER_SIZE)
+            return false;
+
+        for (size_t i = 0; i < 5; i++)
+            if (in[i] != static_cast<uint8_t>(EVENT_RECORD_MAGIC[i]))
+                return false;
+
+        if (in[5] != EVENT_RECORD_VERSION)
+            return false;
+
+        *start_ms = 0;
+        for (size_t i = 0; i < 8; i++)
+            *start_ms |= static_cast<uint64_t>(in[6 + i]) << (8 * i);
+        return true;
+    }
+}
+
+#endif
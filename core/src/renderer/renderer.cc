@@ -1,5 +1,6 @@
 #include "pengu.h"
 #include "hook.h"
+#include "renderer.h"
 #include "v8_wrapper.h"
 #include <unordered_map>
 #include "include/capi/cef_app_capi.h"
@@ -11,71 +12,12 @@ static bool is_main_ = false;
 
 extern V8HandlerFunctionEntry v8_DataStoreEntries[];
 extern V8HandlerFunctionEntry v8_HelperEntries[];
+extern V8HandlerFunctionEntry v8_RecorderEntries[];
+extern V8HandlerFunctionEntry v8_SearchEntries[];
+extern V8HandlerFunctionEntry v8_DocStoreEntries[];
 
-static std::vector<path> get_plugin_entries()
-{
-    std::vector<path> entries;
-    auto plugins_dir = config::plugins_dir();
-
-    /*
-        plugins/
-          |__@author
-            |__plugin-1
-              |__index.js       <-- by author plugin
-          |__plugin-2
-            |__index.js         <-- normal plugin
-          |__plugin-3.js        <-- top-level plugin
-    */
-
-    if (file::is_dir(plugins_dir))
-    {
-        // Scan plugins dir.
-        for (const auto &name : file::read_dir(plugins_dir))
-        {
-            auto ch1 = name.c_str()[0];
-
-            // Skip name starts with underscore or dot.
-            if (ch1 == '_' || ch1 == '.')
-                continue;
-
-            auto path = plugins_dir / name;
-
-            if (file::is_file(path))
-            {
-                // Top-level JS file.
-                if (name.string().ends_with(".js"))
-                {
-                    entries.push_back(name);
-                }
-            }
-            else if (file::is_dir(path))
-            {
-                // Group by @author.
-                if (ch1 == '@')
-                {
-                    for (const auto &subname : file::read_dir(path))
-                    {
-                        auto ch1 = subname.c_str()[0];
-                        if (ch1 == '_' || ch1 == '.')
-                            continue;
-
-                        if (file::is_file(path / subname / "index.js"))
-                        {
-                            entries.push_back(name / subname / "index.js");
-                        }
-                    }
-                }
-                // Sub-folder with index.
-                else if (file::is_file(path / "index.js"))
-                {
-                    entries.push_back(name / "index.js");
-                }
-            }
-        }
-    }
-
-    return entries;
-}
+void InjectPluginStyles(cef_frame_t *frame, const std::vector<path> &entries);
+void InjectSuperPotatoStyles(cef_frame_t *frame);
 
 struct NativeV8Handler : CefRefCount<cef_v8handler_t>
 {
@@ -126,17 +68,26 @@ static void ExposeNativeFunctions(V8Object *window)
     auto list = {
         v8_DataStoreEntries,
         v8_HelperEntries,
+        v8_RecorderEntries,
+        v8_SearchEntries,
+        v8_DocStoreEntries,
     };
 
     for (auto &entries : list) {
         for (auto entry = entries; entry->name; entry++) {
             handler->map_[entry->name] = entry->func;
             auto name = CefStr(entry->name);
+
+            // Each function takes its own reference.
+            handler->base.add_ref(&handler->base);
             auto function = V8Value::function(&name, handler);
             native->set(&name, function, V8_PROPERTY_ATTRIBUTE_READONLY);
         }
     }
 
+    // Freed with the functions when the context goes away.
+    handler->base.release(&handler->base);
+
     window->set(&u"__native"_s, native, V8_PROPERTY_ATTRIBUTE_READONLY);
 }
 
@@ -151,7 +102,7 @@ static void ExposeOsObject(V8Object *window)
     window->set(&u"os"_s, object, V8_PROPERTY_ATTRIBUTE_READONLY);
 }
 
-static void LoadPlugins(V8Object *window)
+static void LoadPlugins(V8Object *window, const std::vector<plugin::LoadItem> &items)
 {
     auto pengu = V8Object::create();
 
@@ -171,13 +122,12 @@ static void LoadPlugins(V8Object *window)
 #endif
         V8_PROPERTY_ATTRIBUTE_READONLY);
 
-    // Pengu.plugins
-    auto entries = get_plugin_entries();
-    auto pluginEntries = V8Array::create((int)entries.size());
+    // Pengu.plugins, in load order
+    auto pluginEntries = V8Array::create((int)items.size());
 
-    for (int index = 0; index < (int)entries.size(); index++)
+    for (int index = 0; index < (int)items.size(); index++)
     {
-        auto entry = CefStr::from_path(entries[index]);
+        auto entry = CefStr::from_path(items[index].entry);
         auto value = V8Value::string(&entry);
         pluginEntries->set(index, value);
     }
@@ -185,14 +135,45 @@ static void LoadPlugins(V8Object *window)
     // array must add to parent objet after init.
     pengu->set(&u"plugins"_s, pluginEntries, V8_PROPERTY_ATTRIBUTE_READONLY);
 
+    // Pengu.pluginDependencies, indices of prerequisites in Pengu.plugins, read once by the loader
+    auto pluginDependencies = V8Array::create((int)items.size());
+
+    for (int index = 0; index < (int)items.size(); index++)
+    {
+        const auto &deps = items[index].dependencies;
+        auto array = V8Array::create((int)deps.size());
+
+        for (int i = 0; i < (int)deps.size(); i++)
+            array->set(i, V8Value::number(deps[i]));
+
+        pluginDependencies->set(index, array);
+    }
+
+    pengu->set(&u"pluginDependencies"_s, pluginDependencies, V8_PROPERTY_ATTRIBUTE_NONE);
+
     // Pengu.disabledPlugins
     auto disabledPlugins = CefStr(config::disabled_plugins());
     pengu->set(&u"disabledPlugins"_s, V8Value::string(&disabledPlugins), V8_PROPERTY_ATTRIBUTE_NONE);
 
+    // Pengu.startupBundle, read once by the loader
+    auto startupBundle = V8Value::boolean(config::options::startup_bundle());
+    pengu->set(&u"startupBundle"_s, startupBundle, V8_PROPERTY_ATTRIBUTE_NONE);
+
     // Add Pengu to window.
     window->set(&u"Pengu"_s, pengu, V8_PROPERTY_ATTRIBUTE_READONLY);
 }
 
+#ifndef _DEBUG
+#   include "../../plugins/dist/preload.g.h"
+
+// The browser pages it in while CEF starts.
+void GetPreloadScript(const void **data, size_t *length)
+{
+    *data = _preload_script;
+    *length = _preload_script_size;
+}
+#endif
+
 static void ExecutePreloadScript(cef_frame_t *frame)
 {
 #ifdef _DEBUG
@@ -206,7 +187,6 @@ static void ExecutePreloadScript(cef_frame_t *frame)
         free(buffer);
     }
 #else
-#   include "../../plugins/dist/preload.g.h"
     CefStr script{ (const char *)_preload_script, _preload_script_size };
     frame->execute_java_script(frame, &script, nullptr, 1);
 #endif
@@ -230,12 +210,26 @@ static void CEF_CALLBACK Hooked_OnContextCreated(
         SetConsoleTitleA("League Client (main renderer process)");
         FILE *_fp; freopen_s(&_fp, "CONOUT$", "w", stdout);
 #endif
+        renderer::track_context(context);
         auto window = context->get_global(context);
 
         ExposeOsObject(reinterpret_cast<V8Object *>(window));
         ExposeNativeFunctions(reinterpret_cast<V8Object *>(window));
-        LoadPlugins(reinterpret_cast<V8Object *>(window));
+        auto items = plugin::resolve_load_order(plugin::get_entries());
+
+        // Styles of prerequisites come first too.
+        std::vector<path> entries;
+        for (const auto &item : items)
+            entries.push_back(item.entry);
+
+        LoadPlugins(reinterpret_cast<V8Object *>(window), items);
+        InjectPluginStyles(frame, entries);
+
+        if (config::options::super_potato())
+            InjectSuperPotatoStyles(frame);
+
         ExecutePreloadScript(frame);
+        window->base.release(&window->base);
     }
 
     OnContextCreated(self, browser, frame, context);
@@ -248,9 +242,9 @@ static void CEF_CALLBACK Hooked_OnContextReleased(
     struct _cef_frame_t* frame,
     struct _cef_v8context_t* context)
 {
+    // Resources of the page, before a reload creates new ones.
     if (is_main_)
-    {
-    }
+        renderer::release_context(context);
 
     OnContextReleased(self, browser, frame, context);
 }
@@ -297,9 +291,9 @@ static int Hooked_CefExecuteProcess(const cef_main_args_t* args, cef_app_t* app,
         OnContextCreated = handler->on_context_created;
         handler->on_context_created = Hooked_OnContextCreated;
 
-        // // Hook OnContextReleased().
-        // OnContextReleased = handler->on_context_released;
-        // handler->on_context_released = Hooked_OnContextReleased;
+        // Hook OnContextReleased().
+        OnContextReleased = handler->on_context_released;
+        handler->on_context_released = Hooked_OnContextReleased;
 
         // Hook OnBrowserCreated().
         OnBrowserCreated = handler->on_browser_created;
@@ -0,0 +1,32 @@
+#pragma once
+#include "pengu.h"
+#include "include/capi/cef_v8_capi.h"
+
+// RENDERER PROCESS ONLY.
+
+namespace renderer
+{
+    ///
+    /// Start tracking resources of a context, called when it's created.
+    ///
+    void track_context(cef_v8context_t *context);
+
+    ///
+    /// Release all resources of a context in reverse order of registration.
+    /// Called when the context is released, e.g on page reload.
+    ///
+    void release_context(cef_v8context_t *context);
+
+    ///
+    /// Register a resource owned by the current context, for native functions called from JS.
+    /// @param release Called when the context is released.
+    /// @returns false if the current context isn't tracked, `release` is not kept then.
+    ///
+    bool on_context_released(std::function<void()> release);
+
+    ///
+    /// Register a release callback once per context, later calls with the same `key` are ignored.
+    /// @returns false if the current context isn't tracked.
+    ///
+    bool on_context_released(const void *key, std::function<void()> release);
+}
@@ -0,0 +1,437 @@
+#include "pengu.h"
+#include "include/capi/cef_frame_capi.h"
+
+// RENDERER PROCESS ONLY.
+
+// Plugin stylesheets declared in package.json "pengu.styles" are merged
+// into one minified sheet, it's adopted by the document before the preload
+// runs so themes apply at the first paint instead of after DOMContentLoaded.
+
+struct StyleSource
+{
+    std::string base;       // e.g. https://plugins/my-theme/css/
+    std::string url;        // e.g. https://plugins/my-theme/css/index.css
+    std::string content;
+};
+
+static uint64_t fnv64_1a(uint64_t hash, const std::string &data)
+{
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+// Spaces around these can be dropped, except the leading one of ':'
+// which is significant in selectors like `a :hover`.
+static bool is_punct(char c)
+{
+    return c == '{' || c == '}' || c == ';' || c == ',' || c == '>';
+}
+
+static bool is_url_token(const std::string &in, size_t i)
+{
+    return i + 4 <= in.length() && tolower((unsigned char)in[i]) == 'u'
+        && tolower((unsigned char)in[i + 1]) == 'r' && tolower((unsigned char)in[i + 2]) == 'l'
+        && in[i + 3] == '(';
+}
+
+// End of a url() token from after `url(`, quoted URLs may contain ')'.
+static size_t find_url_end(const std::string &in, size_t i)
+{
+    size_t n = in.length();
+    while (i < n && is_space(in[i])) i++;
+
+    if (i < n && (in[i] == '"' || in[i] == '\''))
+    {
+        char quote = in[i++];
+        while (i < n && in[i] != quote && in[i] != '\n')
+            i += in[i] == '\\' ? 2 : 1;
+        i++;
+    }
+
+    while (i < n && in[i] != ')')
+        i += in[i] == '\\' ? 2 : 1;
+
+    return i < n ? i : std::string::npos;
+}
+
+// Make relative url() absolute, a constructed sheet resolves them
+// against the document instead of the stylesheet.
+static void append_url(std::string &out, std::string url, const std::string &base)
+{
+    size_t start = 0, end = url.length();
+    while (start < end && is_space(url[start])) start++;
+    while (end > start && is_space(url[end - 1])) end--;
+    url = url.substr(start, end - start);
+
+    char quote = 0;
+    if (!url.empty() && (url[0] == '"' || url[0] == '\''))
+    {
+        quote = url[0];
+        url = url.substr(1, url.length() >= 2 ? url.length() - 2 : 0);
+    }
+
+    bool absolute = url.empty() || url[0] == '#' || url.starts_with("//")
+        || url.starts_with("data:") || url.starts_with("http:") || url.starts_with("https:");
+
+    // Root-relative to the plugins origin, not the document.
+    if (!absolute && url[0] == '/')
+    {
+        url = "https://plugins" + url;
+    }
+    else if (!absolute)
+    {
+        if (url.starts_with("./"))
+            url = url.substr(2);
+        url = base + url;
+    }
+
+    out.append("url(");
+    if (quote) out.push_back(quote);
+    out.append(url);
+    if (quote) out.push_back(quote);
+    out.push_back(')');
+}
+
+static void minify(std::string &out, const std::string &in, const std::string &base)
+{
+    size_t i = 0, n = in.length();
+    bool pending_space = false;
+
+    while (i < n)
+    {
+        char c = in[i];
+
+        // Comments.
+        if (c == '/' && i + 1 < n && in[i + 1] == '*')
+        {
+            size_t end = in.find("*/", i + 2);
+            i = end == std::string::npos ? n : end + 2;
+            pending_space = true;
+            continue;
+        }
+
+        if (is_space(c))
+        {
+            pending_space = true;
+            i++;
+            continue;
+        }
+
+        if (pending_space)
+        {
+            char last = out.empty() ? '{' : out.back();
+            if (!is_punct(last) && last != ':' && !is_punct(c))
+                out.push_back(' ');
+            pending_space = false;
+        }
+
+        // Strings are copied as-is.
+        if (c == '"' || c == '\'')
+        {
+            size_t j = i + 1;
+            while (j < n && in[j] != c && in[j] != '\n')
+                j += in[j] == '\\' ? 2 : 1;
+            j = j < n ? j + 1 : n;
+            out.append(in, i, j - i);
+            i = j;
+            continue;
+        }
+
+        if (is_url_token(in, i) && (out.empty() || (!isalnum((unsigned char)out.back()) && out.back() != '-')))
+        {
+            size_t end = find_url_end(in, i + 4);
+            if (end != std::string::npos)
+            {
+                append_url(out, in.substr(i + 4, end - i - 4), base);
+                i = end + 1;
+                continue;
+            }
+        }
+
+        if (c == '}' && !out.empty() && out.back() == ';')
+            out.pop_back();
+
+        out.push_back(c);
+        i++;
+    }
+}
+
+// @import rules are dropped by replaceSync(), these sheets stay links.
+static bool has_import(const std::string &in)
+{
+    size_t i = 0, n = in.length();
+
+    while (i < n)
+    {
+        char c = in[i];
+
+        if (c == '/' && i + 1 < n && in[i + 1] == '*')
+        {
+            size_t end = in.find("*/", i + 2);
+            i = end == std::string::npos ? n : end + 2;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            for (i++; i < n && in[i] != c && in[i] != '\n'; i += in[i] == '\\' ? 2 : 1);
+            i++;
+        }
+        else if (c == '@')
+        {
+            static const char IMPORT[] = "import";
+            size_t j = 0;
+            while (j < 6 && i + 1 + j < n && tolower((unsigned char)in[i + 1 + j]) == IMPORT[j]) j++;
+            if (j == 6)
+                return true;
+            i++;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    return false;
+}
+
+static std::vector<StyleSource> collect_styles(const std::vector<path> &entries)
+{
+    std::vector<StyleSource> sources;
+    auto plugins_dir = config::plugins_dir();
+
+    for (const auto &entry : entries)
+    {
+        // Top-level plugins have no folder to declare styles.
+        auto dir = entry.parent_path();
+        if (dir.empty() || plugin::is_disabled(entry))
+            continue;
+
+        plugin::Manifest manifest;
+        if (!plugin::read_manifest(plugins_dir / dir, manifest))
+            continue;
+
+        for (const auto &style : manifest.styles)
+        {
+            path file = (dir / style).lexically_normal();
+
+            // Must stay inside the plugin folder.
+            if (file.is_absolute() || file.begin() == file.end() || *file.begin() == "..")
+                continue;
+
+            void *buffer; size_t length;
+            if (!file::read_file(plugins_dir / file, &buffer, &length))
+                continue;
+
+            StyleSource source;
+            source.url = "https://plugins/" + file.generic_string();
+            source.base = source.url.substr(0, source.url.rfind('/') + 1);
+            source.content.assign((const char *)buffer, length);
+            sources.push_back(std::move(source));
+
+            free(buffer);
+        }
+    }
+
+    return sources;
+}
+
+// Bumped when the minified output changes.
+static const std::string CACHE_VERSION = "2";
+
+// Cached sheets of other plugin sets, a while after they were written.
+static constexpr auto CACHE_MAX_AGE = std::chrono::hours(24);
+
+// Remove old sheets, others renderers may still be reading recent ones.
+static void prune_cache(const path &cache_dir, const path &keep)
+{
+    std::error_code ec;
+    auto deadline = std::filesystem::file_time_type::clock::now() - CACHE_MAX_AGE;
+
+    for (const auto &entry : std::filesystem::directory_iterator(cache_dir, ec))
+    {
+        if (entry.path() == keep)
+            continue;
+
+        auto time = entry.last_write_time(ec);
+        if (!ec && time < deadline)
+            std::filesystem::remove(entry.path(), ec);
+    }
+}
+
+// Build the merged sheet, or load it from the cache by content hash.
+static std::string compile_styles(const std::vector<StyleSource> &sources)
+{
+    uint64_t hash = fnv64_1a(0xcbf29ce484222325ull, CACHE_VERSION);
+    for (const auto &source : sources)
+    {
+        hash = fnv64_1a(hash, source.url);
+        hash = fnv64_1a(hash, source.content);
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.css", (unsigned long long)hash);
+
+    path cache_dir = config::loader_dir() / "cache" / "styles";
+    path cache_file = cache_dir / name;
+
+    void *buffer; size_t length;
+    if (file::read_file(cache_file, &buffer, &length))
+    {
+        std::string css((const char *)buffer, length);
+        free(buffer);
+        return css;
+    }
+
+    std::string css;
+    for (const auto &source : sources)
+    {
+        minify(css, source.content, source.base);
+        css.push_back('\n');
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    file::write_file_atomic(cache_file, css.c_str(), css.length());
+    prune_cache(cache_dir, cache_file);
+
+    return css;
+}
+
+// JSON string literal, safe to embed in a script.
+static void append_js_string(std::string &out, const std::string &str)
+{
+    out.push_back('"');
+    for (size_t i = 0; i < str.length(); i++)
+    {
+        unsigned char c = (unsigned char)str[i];
+        switch (c)
+        {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            case '<': out.append("\\x3c"); break;
+            default:
+                // U+2028 and U+2029 are line terminators in older engines.
+                if (c == 0xE2 && i + 2 < str.length() && (unsigned char)str[i + 1] == 0x80
+                    && ((unsigned char)str[i + 2] == 0xA8 || (unsigned char)str[i + 2] == 0xA9))
+                {
+                    out.append((unsigned char)str[i + 2] == 0xA8 ? "\\u2028" : "\\u2029");
+                    i += 2;
+                }
+                else if (c < 0x20)
+                {
+                    char hex[8];
+                    snprintf(hex, sizeof(hex), "\\u%04x", c);
+                    out.append(hex);
+                }
+                else
+                {
+                    out.push_back((char)c);
+                }
+                break;
+        }
+    }
+    out.push_back('"');
+}
+
+void InjectPluginStyles(cef_frame_t *frame, const std::vector<path> &entries)
+{
+    auto sources = collect_styles(entries);
+    if (sources.empty())
+        return;
+
+    std::vector<StyleSource> merged;
+    std::vector<std::string> links;
+
+    for (auto &source : sources)
+    {
+        if (has_import(source.content))
+            links.push_back(source.url);
+        else
+            merged.push_back(std::move(source));
+    }
+
+    // Record injected URLs, so importing them again won't add a <link>.
+    std::string script = "(() => {\nconst urls = [";
+    for (size_t i = 0; i < merged.size(); i++)
+    {
+        if (i > 0) script.push_back(',');
+        append_js_string(script, merged[i].url);
+    }
+    script.append("];\nconst links = [");
+    for (size_t i = 0; i < links.size(); i++)
+    {
+        if (i > 0) script.push_back(',');
+        append_js_string(script, links[i]);
+    }
+    script.append("];\n");
+
+    if (!merged.empty())
+    {
+        script.append("const sheet = new CSSStyleSheet();\nsheet.replaceSync(");
+        append_js_string(script, compile_styles(merged));
+        script.append(");\ndocument.adoptedStyleSheets = [...document.adoptedStyleSheets, sheet];\n");
+    }
+
+    // Sheets with @import are linked once the document has a head.
+    script.append(R"(const addLinks = () => {
+    for (const url of links) {
+        const link = document.createElement('link');
+        link.setAttribute('rel', 'stylesheet');
+        link.setAttribute('href', url);
+        document.head.appendChild(link);
+    }
+};
+if (links.length > 0) {
+    if (document.readyState === 'loading')
+        document.addEventListener('DOMContentLoaded', addLinks);
+    else
+        addLinks();
+}
+const key = Symbol.for('pengu.styles');
+window[key] = new Set([...(window[key] || []), ...urls, ...links]);
+})();)");
+
+    CefStr code{ script };
+    frame->execute_java_script(frame, &code, &u"https://plugins/@/styles"_s, 1);
+}
+
+// Transitions are disabled everywhere except loading indicators.
+static const auto SCRIPT_SUPER_POTATO = R"(
+(() => {
+    const docSheet = new CSSStyleSheet();
+    docSheet.replaceSync(`*:not(.store-loading, .spinner, [animated], .lol-loading-screen-spinner, .lol-uikit-vignette-celebration-layer *), *::before, *::after {
+        transition: none !important;
+    }`);
+    document.adoptedStyleSheets = [...document.adoptedStyleSheets, docSheet];
+
+    // One sheet is shared by all shadow roots, no <style> per element.
+    const shadowSheet = new CSSStyleSheet();
+    shadowSheet.replaceSync(`*:not(.spinner, [animated]), *::before, *::after {
+        transition: none !important;
+    }`);
+
+    const attachShadow = Element.prototype.attachShadow;
+    Element.prototype.attachShadow = function (init) {
+        const root = attachShadow.call(this, init);
+        root.adoptedStyleSheets = [...root.adoptedStyleSheets, shadowSheet];
+        return root;
+    };
+})();
+)";
+
+void InjectSuperPotatoStyles(cef_frame_t *frame)
+{
+    CefStr code{ SCRIPT_SUPER_POTATO };
+    frame->execute_java_script(frame, &code, &u"https://plugins/@/super-potato"_s, 1);
+}
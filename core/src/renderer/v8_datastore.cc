@@ -1,5 +1,7 @@
 #include "pengu.h"
 #include "v8_wrapper.h"
+#include "renderer.h"
+#include <mutex>
 
 static void transform_data(void *data, size_t length)
 {
@@ -14,8 +16,31 @@ static void transform_data(void *data, size_t length)
     }
 }
 
+// Saves run on the pool, only the latest content is written
+// when several saves are queued before the worker gets to them.
+// A pending save is written before the page goes away.
+// A failed write keeps it pending and is tried again later.
+static constexpr int64_t RETRY_DELAY_MS = 1000;
+
+static std::mutex save_mutex_;
+static std::mutex write_mutex_;
+static std::string pending_save_;
+static bool save_scheduled_ = false;
+
 static void load_datastore(cef_string_t *json)
 {
+    // Don't read a file being written.
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+
+    {
+        std::lock_guard<std::mutex> lock(save_mutex_);
+        if (save_scheduled_)
+        {
+            cef_string_from_utf8(pending_save_.c_str(), pending_save_.length(), json);
+            return;
+        }
+    }
+
     auto path = config::datastore_path();
 
     if (file::is_file(path))
@@ -34,12 +59,56 @@ static void load_datastore(cef_string_t *json)
     }
 }
 
-static void save_datastore(cef_string_utf8_t *json)
+// Other renderers never read a partial file.
+static bool write_datastore(const std::string &json)
 {
     auto path = config::datastore_path();
 
-    transform_data(json->str, json->length);
-    file::write_file(path, json->str, json->length);
+    std::string data = json;
+    transform_data(data.data(), data.length());
+    return file::write_file_atomic(path, data.data(), data.length());
+}
+
+static void flush_datastore()
+{
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    std::string json;
+
+    {
+        std::lock_guard<std::mutex> lock(save_mutex_);
+
+        // Already written by a flush on release.
+        if (!save_scheduled_)
+            return;
+
+        json.swap(pending_save_);
+        save_scheduled_ = false;
+    }
+
+    if (write_datastore(json))
+        return;
+
+    // The rename fails on Windows while another process has the file open
+    // without delete sharing. Put it back unless a newer save replaced it.
+    std::lock_guard<std::mutex> lock(save_mutex_);
+    if (!save_scheduled_)
+    {
+        pending_save_.swap(json);
+        save_scheduled_ = true;
+        task::post_to(TID_RENDERER, [] { task::run(flush_datastore); }, RETRY_DELAY_MS);
+    }
+}
+
+static void save_datastore(cef_string_utf8_t *json)
+{
+    std::lock_guard<std::mutex> lock(save_mutex_);
+    pending_save_.assign(json->str, json->length);
+
+    if (!save_scheduled_)
+    {
+        save_scheduled_ = true;
+        task::run(flush_datastore);
+    }
 }
 
 static V8Value *v8_load_datastore(V8Value *const args[], int argc)
@@ -47,6 +116,10 @@ static V8Value *v8_load_datastore(V8Value *const args[], int argc)
     cef_string_t json{};
     load_datastore(&json);
 
+    // Pool workers don't outlive the process, the last save is written here.
+    static const int flush_key = 0;
+    renderer::on_context_released(&flush_key, flush_datastore);
+
     auto ret = V8Value::string(&json);
     cef_string_clear(&json);
 
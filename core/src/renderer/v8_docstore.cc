@@ -0,0 +1,1077 @@
+#include "pengu.h"
+#include "renderer.h"
+#include "v8_wrapper.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+
+// Document stores for plugin data caches, e.g match history or champion stats.
+// A store is an append-only log under the loader dir. Only keys and index
+// entries are kept in memory, documents are read from the file on demand.
+// The log is compacted when most of it is overwritten data.
+//
+// Record: u32 length, u32 checksum, then the body:
+//   u8 op, u32 key length, key, document
+// Ops: PUT key document, DELETE key, INDEX field (the key is the field name)
+
+static constexpr char MAGIC[4] = { 'P', 'D', 'S', '1' };
+static constexpr uint32_t HEADER_SIZE = 8;
+static constexpr uint32_t MAX_RECORD = 64 << 20;
+static constexpr int64_t COMPACT_MIN = 4 << 20;
+static constexpr size_t MAX_INDEXES = 16;
+static constexpr size_t MAX_PAGE = 1000;
+
+enum : uint8_t { OP_PUT = 1, OP_DELETE = 2, OP_INDEX = 3 };
+
+static uint32_t checksum(const char *data, size_t length)
+{
+    uint32_t hash = 0x811c9dc5;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void put_u32(std::string &out, uint32_t value)
+{
+    char bytes[4] = { (char)value, (char)(value >> 8), (char)(value >> 16), (char)(value >> 24) };
+    out.append(bytes, 4);
+}
+
+static uint32_t get_u32(const char *p)
+{
+    auto b = reinterpret_cast<const uint8_t *>(p);
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+// Numbers sort before strings, documents without the field aren't indexed.
+struct IndexValue
+{
+    bool is_string = false;
+    double number = 0;
+    std::string text;
+
+    bool operator<(const IndexValue &other) const
+    {
+        if (is_string != other.is_string)
+            return !is_string;
+        return is_string ? text < other.text : number < other.number;
+    }
+};
+
+using IndexEntry = std::pair<IndexValue, std::string>;
+
+// Compares entries by value only against a bare value, for range bounds.
+struct IndexLess
+{
+    using is_transparent = void;
+
+    bool operator()(const IndexEntry &a, const IndexEntry &b) const
+    {
+        if (a.first < b.first) return true;
+        if (b.first < a.first) return false;
+        return a.second < b.second;
+    }
+
+    bool operator()(const IndexEntry &a, const IndexValue &b) const { return a.first < b; }
+    bool operator()(const IndexValue &a, const IndexEntry &b) const { return a < b.first; }
+};
+
+// JSON scanning, just enough to pick a field out of documents written by JSON.stringify().
+
+static void skip_ws(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+        p++;
+}
+
+static bool read_hex4(const char *&p, const char *end, uint32_t &value)
+{
+    if (end - p < 4)
+        return false;
+
+    value = 0;
+    for (int i = 0; i < 4; i++, p++)
+    {
+        char c = *p;
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+static void append_utf8(std::string &out, uint32_t cp)
+{
+    if (cp < 0x80)
+        out.push_back((char)cp);
+    else if (cp < 0x800)
+    {
+        out.push_back((char)(0xC0 | (cp >> 6)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        out.push_back((char)(0xE0 | (cp >> 12)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        out.push_back((char)(0xF0 | (cp >> 18)));
+        out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+// At the opening quote, decoded to UTF-8.
+static bool read_string(const char *&p, const char *end, std::string &out)
+{
+    out.clear();
+    p++;
+
+    while (p < end)
+    {
+        char c = *p++;
+        if (c == '"')
+            return true;
+
+        if (c != '\\')
+        {
+            out.push_back(c);
+            continue;
+        }
+
+        if (p >= end)
+            return false;
+
+        switch (*p++)
+        {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u':
+            {
+                uint32_t cp;
+                if (!read_hex4(p, end, cp))
+                    return false;
+
+                // Surrogate pair.
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+                {
+                    const char *q = p + 2;
+                    uint32_t low;
+                    if (read_hex4(q, end, low) && low >= 0xDC00 && low < 0xE000)
+                    {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                        p = q;
+                    }
+                }
+
+                append_utf8(out, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+
+    return false;
+}
+
+static bool skip_string(const char *&p, const char *end)
+{
+    p++;
+    while (p < end)
+    {
+        if (*p == '\\')
+            p += 2;
+        else if (*p++ == '"')
+            return true;
+    }
+    return false;
+}
+
+// At the first character of a value, stops after it.
+static bool skip_value(const char *&p, const char *end)
+{
+    int depth = 0;
+    while (p < end)
+    {
+        char c = *p;
+        if (c == '"')
+        {
+            if (!skip_string(p, end))
+                return false;
+            if (depth == 0)
+                return true;
+            continue;
+        }
+
+        if (c == '{' || c == '[')
+            depth++;
+        else if (c == '}' || c == ']')
+        {
+            // A scalar ends at its parent's bracket.
+            if (depth == 0)
+                return true;
+            if (--depth == 0)
+            {
+                p++;
+                return true;
+            }
+        }
+        else if (c == ',' && depth == 0)
+            return true;
+
+        p++;
+    }
+    return false;
+}
+
+///
+/// Get a string or number field of a JSON object, nested fields are dotted, e.g `stats.kills`.
+///
+static bool extract_field(const char *p, const char *end, std::string_view field, IndexValue &out)
+{
+    size_t dot = field.find('.');
+    auto name = field.substr(0, dot);
+    std::string key;
+
+    skip_ws(p, end);
+    if (p >= end || *p != '{')
+        return false;
+    p++;
+
+    while (true)
+    {
+        skip_ws(p, end);
+        if (p >= end || *p != '"' || !read_string(p, end, key))
+            return false;
+
+        skip_ws(p, end);
+        if (p >= end || *p != ':')
+            return false;
+        p++;
+        skip_ws(p, end);
+
+        if (p >= end)
+            return false;
+
+        if (key == name)
+        {
+            if (dot != std::string_view::npos)
+                return extract_field(p, end, field.substr(dot + 1), out);
+
+            if (*p == '"')
+            {
+                out.is_string = true;
+                return read_string(p, end, out.text);
+            }
+
+            // Copied, the document may not be null-terminated.
+            char number[64];
+            size_t length = 0;
+            while (p < end && length < sizeof(number) - 1 && (isdigit((uint8_t)*p) || strchr("+-.eE", *p) != nullptr))
+                number[length++] = *p++;
+            number[length] = '\0';
+
+            char *number_end;
+            out.is_string = false;
+            out.number = strtod(number, &number_end);
+            return length > 0 && number_end == number + length;
+        }
+
+        if (!skip_value(p, end))
+            return false;
+
+        skip_ws(p, end);
+        if (p >= end || *p != ',')
+            return false;
+        p++;
+    }
+}
+
+struct ScanRange
+{
+    bool has_lower = false, lower_open = false;
+    bool has_upper = false, upper_open = false;
+    IndexValue lower, upper;
+
+    // Continue after this entry, from the last page.
+    bool has_after = false;
+    IndexEntry after;
+
+    bool reverse = false;
+    size_t limit = 100;
+};
+
+class DocStore
+{
+public:
+    ~DocStore()
+    {
+        close();
+    }
+
+    bool open(const path &file)
+    {
+        path_ = file;
+
+        std::error_code ec;
+        std::filesystem::create_directories(file.parent_path(), ec);
+
+        // One writer, offsets are only known to the process that appends.
+        // The log itself is replaced by compactions.
+        auto lock_path = file;
+        lock_path += ".lock";
+        if (!lock_.open_append(lock_path, ec) || !lock_.try_lock(ec))
+        {
+            lock_.close();
+            return false;
+        }
+
+        if (!load())
+        {
+            close();
+            return false;
+        }
+
+        if (!file_.open_append(path_, ec))
+            return false;
+
+        if (size_ == 0)
+        {
+            file_.append(MAGIC, sizeof(MAGIC), ec);
+            size_ = sizeof(MAGIC);
+        }
+
+        maybe_compact();
+        return !ec;
+    }
+
+    void close()
+    {
+        file_.close();
+        lock_.close();
+    }
+
+    bool put(const std::string &key, const std::string &doc)
+    {
+        if (key.empty() || doc.length() > MAX_RECORD / 2)
+            return false;
+
+        int64_t offset = size_ + HEADER_SIZE + 5 + key.length();
+        if (!append(OP_PUT, key, doc))
+            return false;
+
+        set_doc(key, Doc{ offset, (uint32_t)doc.length() }, doc.data());
+        maybe_compact();
+        return true;
+    }
+
+    bool remove(const std::string &key)
+    {
+        auto it = docs_.find(key);
+        if (it == docs_.end() || !append(OP_DELETE, key, ""))
+            return false;
+
+        unindex(it->first, it->second);
+        dead_ += record_size(it->first, it->second) + HEADER_SIZE + 5 + key.length();
+        docs_.erase(it);
+
+        maybe_compact();
+        return true;
+    }
+
+    bool get(const std::string &key, std::string &doc)
+    {
+        auto it = docs_.find(key);
+        return it != docs_.end() && read_doc(it->second, doc);
+    }
+
+    bool create_index(const std::string &field)
+    {
+        if (field.empty() || indexes_.count(field))
+            return true;
+
+        if (indexes_.size() >= MAX_INDEXES || !append(OP_INDEX, field, ""))
+            return false;
+
+        add_index(field);
+        return true;
+    }
+
+    bool is_open() const
+    {
+        return file_.is_open();
+    }
+
+    bool has_index(const std::string &field) const
+    {
+        return field.empty() || indexes_.count(field) > 0;
+    }
+
+    size_t count() const
+    {
+        return docs_.size();
+    }
+
+    ///
+    /// Visit documents in key order, or in `field` order if it's not empty.
+    /// @param fn Called with each entry, its value is the key for key scans.
+    ///
+    template <typename Fn>
+    void scan(const std::string &field, const ScanRange &range, Fn &&fn)
+    {
+        if (field.empty())
+        {
+            // Keys are the values of a virtual string index.
+            auto key_of = [](const std::pair<const std::string, Doc> &item) { return IndexEntry{ IndexValue{ true, 0, item.first }, item.first }; };
+            scan_range(docs_, range, key_of,
+                [](const auto &map, const IndexValue &v) { return map.lower_bound(v.text); },
+                [](const auto &map, const IndexValue &v) { return map.upper_bound(v.text); },
+                [](const auto &map, const IndexEntry &e) { return map.upper_bound(e.second); },
+                [](const auto &map, const IndexEntry &e) { return map.lower_bound(e.second); },
+                fn);
+        }
+        else
+        {
+            auto it = indexes_.find(field);
+            if (it == indexes_.end())
+                return;
+
+            auto self = [](const IndexEntry &entry) { return entry; };
+            scan_range(it->second, range, self,
+                [](const auto &set, const IndexValue &v) { return set.lower_bound(v); },
+                [](const auto &set, const IndexValue &v) { return set.upper_bound(v); },
+                [](const auto &set, const IndexEntry &e) { return set.upper_bound(e); },
+                [](const auto &set, const IndexEntry &e) { return set.lower_bound(e); },
+                fn);
+        }
+    }
+
+private:
+    struct Doc
+    {
+        int64_t offset;     // of the document in the file
+        uint32_t length;
+    };
+
+    path path_;
+    file::File file_;
+    file::File lock_;
+    int64_t size_ = 0;
+    int64_t dead_ = 0;      // bytes of overwritten and deleted records
+
+    std::map<std::string, Doc> docs_;
+    std::map<std::string, std::set<IndexEntry, IndexLess>> indexes_;
+
+    // The mapped log while it's replayed.
+    const char *replay_ = nullptr;
+
+    static int64_t record_size(const std::string &key, const Doc &doc)
+    {
+        return HEADER_SIZE + 5 + key.length() + doc.length;
+    }
+
+    bool read_doc(const Doc &doc, std::string &out)
+    {
+        if (replay_ != nullptr)
+        {
+            out.assign(replay_ + doc.offset, doc.length);
+            return true;
+        }
+
+        std::error_code ec;
+        out.resize(doc.length);
+        return file_.read_at(out.data(), doc.length, doc.offset, ec) == doc.length;
+    }
+
+    static void encode(std::string &out, uint8_t op, const std::string &key, const std::string &doc)
+    {
+        size_t start = out.length();
+        put_u32(out, (uint32_t)(5 + key.length() + doc.length()));
+        put_u32(out, 0);
+
+        out.push_back((char)op);
+        put_u32(out, (uint32_t)key.length());
+        out.append(key);
+        out.append(doc);
+
+        auto sum = checksum(out.data() + start + HEADER_SIZE, out.length() - start - HEADER_SIZE);
+        std::string bytes;
+        put_u32(bytes, sum);
+        out.replace(start + 4, 4, bytes);
+    }
+
+    // One write per record, a torn tail is dropped on the next load.
+    bool append(uint8_t op, const std::string &key, const std::string &doc)
+    {
+        if (!file_.is_open())
+            return false;
+
+        std::string record;
+        encode(record, op, key, doc);
+
+        std::error_code ec;
+        if (!file_.append(record.data(), record.length(), ec))
+            return false;
+
+        size_ += (int64_t)record.length();
+        return true;
+    }
+
+    void index(const std::string &key, const char *data, uint32_t length)
+    {
+        for (auto &[field, entries] : indexes_)
+        {
+            IndexValue value;
+            if (extract_field(data, data + length, field, value))
+                entries.emplace(std::move(value), key);
+        }
+    }
+
+    void unindex(const std::string &key, const Doc &doc)
+    {
+        if (indexes_.empty())
+            return;
+
+        std::string data;
+        if (!read_doc(doc, data))
+            return;
+
+        for (auto &[field, entries] : indexes_)
+        {
+            IndexValue value;
+            if (extract_field(data.data(), data.data() + data.length(), field, value))
+                entries.erase(IndexEntry{ std::move(value), key });
+        }
+    }
+
+    void set_doc(const std::string &key, Doc doc, const char *data)
+    {
+        auto it = docs_.find(key);
+        if (it != docs_.end())
+        {
+            unindex(key, it->second);
+            dead_ += record_size(key, it->second);
+            it->second = doc;
+        }
+        else
+        {
+            it = docs_.emplace(key, doc).first;
+        }
+
+        index(it->first, data, doc.length);
+    }
+
+    void add_index(const std::string &field)
+    {
+        auto &entries = indexes_[field];
+        std::string data;
+
+        for (const auto &[key, doc] : docs_)
+        {
+            IndexValue value;
+            if (read_doc(doc, data) && extract_field(data.data(), data.data() + data.length(), field, value))
+                entries.emplace(std::move(value), key);
+        }
+    }
+
+    // Replay the log, a torn or corrupted tail is cut off.
+    bool load()
+    {
+        docs_.clear();
+        indexes_.clear();
+        size_ = dead_ = 0;
+
+        std::error_code ec;
+        if (!file::is_file(path_) || std::filesystem::file_size(path_, ec) == 0)
+            return true;
+
+        file::MappedFile map;
+        if (!map.open(path_, ec))
+            return false;
+
+        const char *data = (const char *)map.data();
+        int64_t size = (int64_t)map.size();
+
+        // Not a store.
+        if (size < (int64_t)sizeof(MAGIC) || memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+            return false;
+
+        int64_t pos = sizeof(MAGIC);
+        replay_ = data;
+
+        while (pos + HEADER_SIZE <= size)
+        {
+            uint32_t length = get_u32(data + pos);
+            if (length < 5 || length > MAX_RECORD || pos + HEADER_SIZE + length > size
+                || checksum(data + pos + HEADER_SIZE, length) != get_u32(data + pos + 4))
+                break;
+
+            const char *body = data + pos + HEADER_SIZE;
+            uint32_t key_length = get_u32(body + 1);
+            if (key_length > length - 5)
+                break;
+
+            std::string key(body + 5, key_length);
+            int64_t offset = pos + HEADER_SIZE + 5 + key_length;
+            uint32_t doc_length = length - 5 - key_length;
+
+            switch ((uint8_t)body[0])
+            {
+                case OP_PUT:
+                    set_doc(key, Doc{ offset, doc_length }, data + offset);
+                    break;
+                case OP_DELETE:
+                    if (auto it = docs_.find(key); it != docs_.end())
+                    {
+                        unindex(key, it->second);
+                        dead_ += record_size(key, it->second);
+                        docs_.erase(it);
+                    }
+                    dead_ += HEADER_SIZE + length;
+                    break;
+                case OP_INDEX:
+                    if (!indexes_.count(key))
+                        add_index(key);
+                    break;
+            }
+
+            pos += HEADER_SIZE + length;
+        }
+
+        replay_ = nullptr;
+        map.close();
+
+        if (pos < size)
+            std::filesystem::resize_file(path_, pos, ec);
+
+        size_ = pos;
+        return !ec;
+    }
+
+    // Rewrite live records once they're less than half of the log.
+    void maybe_compact()
+    {
+        if (dead_ < COMPACT_MIN || dead_ * 2 < size_)
+            return;
+
+        auto temp = path_;
+        temp += ".tmp";
+
+        std::error_code ec;
+        std::filesystem::remove(temp, ec);
+
+        file::File out;
+        if (!out.open_append(temp, ec))
+            return;
+
+        std::string buffer(MAGIC, sizeof(MAGIC));
+        int64_t written = 0;
+        std::vector<int64_t> offsets;
+        offsets.reserve(docs_.size());
+
+        for (const auto &[field, _] : indexes_)
+            encode(buffer, OP_INDEX, field, "");
+
+        std::string data;
+        for (const auto &[key, doc] : docs_)
+        {
+            if (!read_doc(doc, data))
+                return;
+
+            offsets.push_back(written + (int64_t)buffer.length() + HEADER_SIZE + 5 + key.length());
+            encode(buffer, OP_PUT, key, data);
+
+            if (buffer.length() >= (1 << 20))
+            {
+                if (!out.append(buffer.data(), buffer.length(), ec))
+                    return;
+                written += (int64_t)buffer.length();
+                buffer.clear();
+            }
+        }
+
+        if (!out.append(buffer.data(), buffer.length(), ec))
+            return;
+        written += (int64_t)buffer.length();
+        out.close();
+
+        // Files can't be replaced while open on Windows.
+        file_.close();
+        std::filesystem::rename(temp, path_, ec);
+        bool renamed = !ec;
+
+        if (renamed)
+        {
+            size_t i = 0;
+            for (auto &[key, doc] : docs_)
+                doc.offset = offsets[i++];
+
+            size_ = written;
+            dead_ = 0;
+        }
+        else
+        {
+            std::filesystem::remove(temp, ec);
+        }
+
+        // Offsets would be wrong after another process appends, the lock is kept
+        // until the store is closed. It's closed then, every call fails.
+        if (!file_.open_append(path_, ec))
+            close();
+    }
+
+    template <typename Set, typename KeyOf, typename Lower, typename Upper, typename After, typename Before, typename Fn>
+    static void scan_range(const Set &set, const ScanRange &range, KeyOf key_of,
+        Lower lower_bound, Upper upper_bound, After after_bound, Before before_bound, Fn &fn)
+    {
+        size_t visited = 0;
+
+        if (!range.reverse)
+        {
+            auto it = range.has_after ? after_bound(set, range.after)
+                : !range.has_lower ? set.begin()
+                : range.lower_open ? upper_bound(set, range.lower) : lower_bound(set, range.lower);
+
+            for (; it != set.end() && visited < range.limit; ++it, ++visited)
+            {
+                auto entry = key_of(*it);
+                if (range.has_upper && (range.upper_open ? !(entry.first < range.upper) : range.upper < entry.first))
+                    break;
+                fn(entry);
+            }
+        }
+        else
+        {
+            auto it = range.has_after ? before_bound(set, range.after)
+                : !range.has_upper ? set.end()
+                : range.upper_open ? lower_bound(set, range.upper) : upper_bound(set, range.upper);
+
+            while (it != set.begin() && visited < range.limit)
+            {
+                --it;
+                auto entry = key_of(*it);
+                if (range.has_lower && (range.lower_open ? !(range.lower < entry.first) : entry.first < range.lower))
+                    break;
+                fn(entry);
+                visited++;
+            }
+        }
+    }
+};
+
+// Open stores by name, shared by the opens of all pages. JS gets a handle
+// per open, released by DocStore.close() or with the page that opened it.
+struct OpenStore
+{
+    std::unique_ptr<DocStore> store;
+    int refs = 0;
+};
+
+static std::unordered_map<std::string, OpenStore> stores_;
+static std::unordered_map<uint32_t, std::string> handles_;
+static uint32_t next_handle_ = 1;
+
+static void release_handle(uint32_t handle)
+{
+    auto it = handles_.find(handle);
+    if (it == handles_.end())
+        return;
+
+    auto store = stores_.find(it->second);
+    handles_.erase(it);
+
+    if (store != stores_.end() && --store->second.refs == 0)
+        stores_.erase(store);
+}
+
+static std::string get_utf8(V8Value *value)
+{
+    if (value == nullptr || !value->isString())
+        return "";
+
+    CefScopedStr str = value->asString();
+    return str.to_utf8();
+}
+
+// Names are paths under the store dir, e.g `my-plugin/matches`.
+static bool is_valid_name(const std::string &name)
+{
+    if (name.empty() || name.length() > 128 || name[0] == '/' || name.back() == '/' || name.find("..") != std::string::npos)
+        return false;
+
+    return std::all_of(name.begin(), name.end(), [](char c)
+    {
+        return isalnum((uint8_t)c) || c == '-' || c == '_' || c == '.' || c == '@' || c == '/';
+    });
+}
+
+static DocStore *get_store(V8Value *const args[], int argc)
+{
+    if (argc < 1 || !args[0]->isUint())
+        return nullptr;
+
+    auto handle = handles_.find(args[0]->asUint());
+    if (handle == handles_.end())
+        return nullptr;
+
+    auto it = stores_.find(handle->second);
+    return it != stores_.end() && it->second.store->is_open() ? it->second.store.get() : nullptr;
+}
+
+static bool to_index_value(V8Value *value, IndexValue &out)
+{
+    if (value->isString())
+    {
+        out.is_string = true;
+        out.text = get_utf8(value);
+        return true;
+    }
+    if (value->isInt() || value->isUint() || value->isDouble())
+    {
+        out.is_string = false;
+        out.number = value->asDouble();
+        return true;
+    }
+    return false;
+}
+
+static V8Value *from_index_value(const IndexValue &value)
+{
+    if (value.is_string)
+        return V8Value::string(&CefStr(value.text));
+    return V8Value::number(value.number);
+}
+
+// Takes the reference of the option value.
+static V8Value *get_option(V8Object *options, const char16_t *name)
+{
+    cef_string_t key{ (char16 *)name, std::char_traits<char16_t>::length(name), nullptr };
+    if (!options->has(&key))
+        return nullptr;
+
+    auto value = options->get(&key);
+    if (value != nullptr && value->isUndefined())
+    {
+        value->ptr()->base.release(&value->ptr()->base);
+        return nullptr;
+    }
+    return value;
+}
+
+static void release(V8Value *value)
+{
+    if (value != nullptr)
+        value->ptr()->base.release(&value->ptr()->base);
+}
+
+// { gt, gte, lt, lte, reverse, limit, after: [value, key] }
+static bool parse_range(V8Value *arg, ScanRange &range)
+{
+    if (arg == nullptr || !arg->isObject())
+        return true;
+
+    auto options = arg->asObject();
+    bool ok = true;
+
+    auto bound = [&](const char16_t *name, bool &has, bool &open, IndexValue &value, bool is_open)
+    {
+        if (auto v = get_option(options, name))
+        {
+            ok = ok && to_index_value(v, value);
+            has = true;
+            open = is_open;
+            release(v);
+        }
+    };
+
+    bound(u"gte", range.has_lower, range.lower_open, range.lower, false);
+    bound(u"gt", range.has_lower, range.lower_open, range.lower, true);
+    bound(u"lte", range.has_upper, range.upper_open, range.upper, false);
+    bound(u"lt", range.has_upper, range.upper_open, range.upper, true);
+
+    if (auto v = get_option(options, u"reverse"))
+    {
+        range.reverse = v->isBool() && v->asBool();
+        release(v);
+    }
+
+    if (auto v = get_option(options, u"limit"))
+    {
+        if (v->isUint())
+            range.limit = std::min<size_t>(v->asUint(), MAX_PAGE);
+        release(v);
+    }
+
+    if (auto v = get_option(options, u"after"))
+    {
+        if (v->isArray() && v->asArray()->length() == 2)
+        {
+            auto value = v->asArray()->get(0);
+            auto key = v->asArray()->get(1);
+
+            range.has_after = to_index_value(value, range.after.first) && key->isString();
+            range.after.second = get_utf8(key);
+
+            release(value);
+            release(key);
+        }
+        release(v);
+    }
+
+    return ok;
+}
+
+// (name) => handle, or 0 if it can't be opened or another process has it
+static V8Value *v8_docstore_open(V8Value *const args[], int argc)
+{
+    auto name = argc > 0 ? get_utf8(args[0]) : "";
+    if (!is_valid_name(name))
+        return V8Value::number(0);
+
+    auto file = config::loader_dir() / "docstore" / (name + ".log");
+    auto it = stores_.find(name);
+
+    if (it == stores_.end())
+    {
+        auto store = std::make_unique<DocStore>();
+        if (!store->open(file))
+            return V8Value::number(0);
+
+        it = stores_.emplace(name, OpenStore{ std::move(store), 0 }).first;
+    }
+    // Closed by a failed compaction.
+    else if (!it->second.store->is_open() && !it->second.store->open(file))
+    {
+        return V8Value::number(0);
+    }
+
+    uint32_t handle = next_handle_++;
+    handles_.emplace(handle, name);
+    it->second.refs++;
+
+    if (!renderer::on_context_released([handle] { release_handle(handle); }))
+    {
+        release_handle(handle);
+        return V8Value::number(0);
+    }
+
+    return V8Value::number((double)handle);
+}
+
+static V8Value *v8_docstore_close(V8Value *const args[], int argc)
+{
+    if (argc > 0 && args[0]->isUint())
+        release_handle(args[0]->asUint());
+
+    return nullptr;
+}
+
+static V8Value *v8_docstore_put(V8Value *const args[], int argc)
+{
+    auto store = get_store(args, argc);
+    bool ok = store != nullptr && argc > 2 && args[1]->isString() && args[2]->isString()
+        && store->put(get_utf8(args[1]), get_utf8(args[2]));
+
+    return V8Value::boolean(ok);
+}
+
+static V8Value *v8_docstore_get(V8Value *const args[], int argc)
+{
+    auto store = get_store(args, argc);
+    std::string doc;
+
+    if (store == nullptr || argc < 2 || !store->get(get_utf8(args[1]), doc))
+        return V8Value::null();
+
+    return V8Value::string(&CefStr(doc));
+}
+
+static V8Value *v8_docstore_delete(V8Value *const args[], int argc)
+{
+    auto store = get_store(args, argc);
+    bool ok = store != nullptr && argc > 1 && store->remove(get_utf8(args[1]));
+
+    return V8Value::boolean(ok);
+}
+
+static V8Value *v8_docstore_create_index(V8Value *const args[], int argc)
+{
+    auto store = get_store(args, argc);
+    bool ok = store != nullptr && argc > 1 && args[1]->isString() && store->create_index(get_utf8(args[1]));
+
+    return V8Value::boolean(ok);
+}
+
+// (handle, field, options, keys_only) => [[value, key, doc?], ...]
+static V8Value *v8_docstore_scan(V8Value *const args[], int argc)
+{
+    auto store = get_store(args, argc);
+    auto field = argc > 1 ? get_utf8(args[1]) : "";
+
+    ScanRange range;
+    if (store == nullptr || !store->has_index(field) || !parse_range(argc > 2 ? args[2] : nullptr, range))
+        return (V8Value *)V8Array::create(0);
+
+    // Keys are strings.
+    if (field.empty() && ((range.has_lower && !range.lower.is_string) || (range.has_upper && !range.upper.is_string)
+        || (range.has_after && !range.after.first.is_string)))
+        return (V8Value *)V8Array::create(0);
+
+    bool keys_only = argc > 3 && args[3]->isBool() && args[3]->asBool();
+
+    std::vector<IndexEntry> entries;
+    store->scan(field, range, [&entries](const IndexEntry &entry) { entries.push_back(entry); });
+
+    auto array = V8Array::create((int)entries.size());
+    std::string doc;
+
+    for (int i = 0; i < (int)entries.size(); i++)
+    {
+        auto row = V8Array::create(keys_only ? 2 : 3);
+        row->set(0, from_index_value(entries[i].first));
+        row->set(1, V8Value::string(&CefStr(entries[i].second)));
+
+        if (!keys_only)
+            row->set(2, store->get(entries[i].second, doc) ? V8Value::string(&CefStr(doc)) : V8Value::null());
+
+        array->set(i, row);
+    }
+
+    return (V8Value *)array;
+}
+
+static V8Value *v8_docstore_count(V8Value *const args[], int argc)
+{
+    auto store = get_store(args, argc);
+    return V8Value::number(store != nullptr ? (double)store->count() : 0.0);
+}
+
+V8HandlerFunctionEntry v8_DocStoreEntries[]
+{
+    { "DocStoreOpen", v8_docstore_open },
+    { "DocStoreClose", v8_docstore_close },
+    { "DocStorePut", v8_docstore_put },
+    { "DocStoreGet", v8_docstore_get },
+    { "DocStoreDelete", v8_docstore_delete },
+    { "DocStoreCreateIndex", v8_docstore_create_index },
+    { "DocStoreScan", v8_docstore_scan },
+    { "DocStoreCount", v8_docstore_count },
+    { nullptr }
+};
@@ -84,6 +84,14 @@ static V8Value *v8_set_window_theme(V8Value *const *args, int argc)
     return nullptr;
 }
 
+// Monotonic milliseconds, not coarsened like performance.now().
+static V8Value *v8_get_time(V8Value *const *args, int argc)
+{
+    static const auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return V8Value::number(elapsed.count());
+}
+
 V8HandlerFunctionEntry v8_HelperEntries[]
 {
     { "OpenDevTools", v8_open_devtools },
@@ -91,5 +99,6 @@ V8HandlerFunctionEntry v8_HelperEntries[]
     { "ReloadClient", v8_reload_client },
     { "SetWindowVibrancy", v8_set_window_vibrancy },
     { "SetWindowTheme", v8_set_window_theme },
+    { "GetTime", v8_get_time },
     { nullptr },
 };
\ No newline at end of file
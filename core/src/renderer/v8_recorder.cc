@@ -0,0 +1,120 @@
+#include "pengu.h"
+#include "renderer.h"
+#include "v8_wrapper.h"
+#include "event_record.h"
+#include <chrono>
+
+// Records the LCU event stream forwarded by rcp/socket.ts,
+// enabled by the undocumented `record_events` option.
+
+static FILE *record_file_ = nullptr;
+static std::chrono::steady_clock::time_point last_time_;
+static size_t unflushed_ = 0;
+
+static bool begin_record()
+{
+    if (record_file_ != nullptr)
+        return true;
+
+    auto dir = config::loader_dir() / "recordings";
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    auto start = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    char name[64];
+    snprintf(name, sizeof(name), "events-%lld.pgrec", (long long)start);
+
+#if OS_WIN
+    record_file_ = _wfopen((dir / name).c_str(), L"wb");
+#else
+    record_file_ = fopen((dir / name).c_str(), "wb");
+#endif
+
+    if (record_file_ == nullptr)
+        return false;
+
+    uint8_t header[EVENT_RECORD_HEADER_SIZE];
+    event_record::put_header(header, (uint64_t)start);
+    fwrite(header, 1, sizeof(header), record_file_);
+
+    last_time_ = std::chrono::steady_clock::now();
+    unflushed_ = 0;
+    return true;
+}
+
+static void end_record()
+{
+    if (record_file_ != nullptr)
+    {
+        fclose(record_file_);
+        record_file_ = nullptr;
+    }
+}
+
+static void append_record(const char *data, size_t length)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto delta = std::chrono::duration_cast<std::chrono::microseconds>(now - last_time_).count();
+    last_time_ = now;
+
+    uint8_t prefix[20];
+    size_t size = event_record::put_varint(prefix, (uint64_t)delta);
+    size += event_record::put_varint(prefix + size, (uint64_t)length);
+
+    fwrite(prefix, 1, size, record_file_);
+    fwrite(data, 1, length, record_file_);
+
+    // Keep the tail on disk in case the renderer is killed.
+    if ((unflushed_ += size + length) >= 64 * 1024)
+    {
+        fflush(record_file_);
+        unflushed_ = 0;
+    }
+}
+
+static V8Value *v8_begin_event_record(V8Value *const args[], int argc)
+{
+    bool started = record_file_ == nullptr;
+    bool recording = config::options::record_events() && begin_record();
+
+    // One recording per page, it's closed on reload.
+    if (recording && started)
+        renderer::on_context_released(end_record);
+
+    return V8Value::boolean(recording);
+}
+
+static V8Value *v8_record_event(V8Value *const args[], int argc)
+{
+    if (record_file_ != nullptr && argc > 0 && args[0]->isString())
+    {
+        CefScopedStr message = args[0]->asString();
+
+        if (!message.empty())
+        {
+            cef_string_utf8_t utf8{};
+            cef_string_to_utf8(message.str, message.length, &utf8);
+            append_record(utf8.str, utf8.length);
+
+            cef_string_utf8_clear(&utf8);
+        }
+    }
+
+    return nullptr;
+}
+
+static V8Value *v8_end_event_record(V8Value *const args[], int argc)
+{
+    end_record();
+    return nullptr;
+}
+
+V8HandlerFunctionEntry v8_RecorderEntries[]
+{
+    { "BeginEventRecord", v8_begin_event_record },
+    { "RecordEvent", v8_record_event },
+    { "EndEventRecord", v8_end_event_record },
+    { nullptr }
+};
@@ -0,0 +1,429 @@
+#include "pengu.h"
+#include "renderer.h"
+#include "v8_wrapper.h"
+#include <algorithm>
+#include <unordered_map>
+
+// Fuzzy search for the CommandBar, it's queried on every keystroke.
+// Items are matched by their lowercase UTF-8 text in two tiers:
+//  - subsequence matches scored like fzf, candidates are narrowed by a
+//    bitmask of the bytes each item contains, a flat scan the compiler vectorizes
+//  - typo matches, items sharing trigrams with the query, from an inverted index
+
+static constexpr size_t MAX_ITEMS = 1 << 20;
+static constexpr size_t MAX_QUERY = 256;
+
+// Every byte maps to a bit, the query mask must be a subset of the item mask.
+static uint64_t byte_bit(uint8_t c)
+{
+    if (c >= 'a' && c <= 'z')
+        return 1ull << (c - 'a');
+    if (c >= '0' && c <= '9')
+        return 1ull << (26 + c - '0');
+    return 1ull << (36 + c % 28);
+}
+
+static bool is_separator(char c)
+{
+    return c == ' ' || c == '\n' || c == '-' || c == '_' || c == '.' || c == '/' || c == ':';
+}
+
+static uint32_t trigram(const char *p)
+{
+    return (uint8_t)p[0] | ((uint8_t)p[1] << 8) | ((uint8_t)p[2] << 16);
+}
+
+static void get_trigrams(const std::string &text, std::vector<uint32_t> &out)
+{
+    out.clear();
+    for (size_t i = 0; i + 3 <= text.length(); i++)
+    {
+        if (text[i] != ' ' && text[i + 1] != ' ' && text[i + 2] != ' ')
+            out.push_back(trigram(&text[i]));
+    }
+
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+static std::string to_lower(std::string text)
+{
+    for (auto &c : text)
+    {
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        else if (c == '\t' || c == '\r')
+            c = ' ';
+    }
+    return text;
+}
+
+// Best score of a token as a subsequence of the text, or -1.
+static int score_token(const std::string &text, const std::string &token)
+{
+    // Contiguous at a word start, nothing scores higher.
+    const int perfect = (int)token.length() * 5 - 1;
+
+    int best = -1;
+    size_t start = 0;
+
+    // Greedy from the first occurrence, then from word starts only.
+    for (int attempt = 0; attempt < 8; attempt++)
+    {
+        auto first = (const char *)memchr(text.data() + start, token[0], text.length() - start);
+        if (first == nullptr)
+            break;
+
+        size_t pos = first - text.data();
+        start = pos + 1;
+
+        if (attempt > 0 && pos > 0 && !is_separator(text[pos - 1]))
+        {
+            attempt--;
+            continue;
+        }
+
+        int score = 0;
+        size_t prev = std::string::npos;
+        bool matched = true;
+
+        for (char c : token)
+        {
+            auto found = (const char *)memchr(text.data() + pos, c, text.length() - pos);
+            if (found == nullptr)
+            {
+                matched = false;
+                break;
+            }
+
+            size_t i = found - text.data();
+            score += 1;
+
+            if (prev != std::string::npos && i == prev + 1)
+                score += 4;
+            else if (prev != std::string::npos)
+                score -= (int)std::min<size_t>(i - prev - 1, 3);
+
+            if (i == 0 || is_separator(text[i - 1]))
+                score += 3;
+
+            prev = i;
+            pos = i + 1;
+        }
+
+        // Later starts can't match either.
+        if (!matched)
+            break;
+
+        best = std::max(best, score);
+        if (best >= perfect)
+            break;
+    }
+
+    return best;
+}
+
+class SearchIndex
+{
+public:
+    void set(uint32_t id, std::string text)
+    {
+        if (id >= MAX_ITEMS)
+            return;
+
+        text = to_lower(std::move(text));
+        if (id >= texts_.size())
+        {
+            texts_.resize(id + 1);
+            masks_.resize(id + 1, 0);
+        }
+        else if (masks_[id] != 0 && texts_[id] == text)
+        {
+            return;
+        }
+
+        uint64_t mask = 1;  // never zero for live items
+        for (char c : text)
+            mask |= byte_bit((uint8_t)c);
+
+        get_trigrams(text, trigrams_);
+        for (auto t : trigrams_)
+            postings_[t].push_back(id);
+        postings_size_ += trigrams_.size();
+
+        if (masks_[id] != 0)
+            stale_ += trigrams_.size();
+
+        texts_[id] = std::move(text);
+        masks_[id] = mask;
+        maybe_compact();
+    }
+
+    void remove(uint32_t id)
+    {
+        if (id >= texts_.size() || masks_[id] == 0)
+            return;
+
+        get_trigrams(texts_[id], trigrams_);
+        stale_ += trigrams_.size();
+
+        texts_[id].clear();
+        masks_[id] = 0;
+        maybe_compact();
+    }
+
+    std::vector<uint32_t> query(const std::string &input, size_t limit)
+    {
+        std::vector<uint32_t> ids;
+        auto query = to_lower(input.substr(0, MAX_QUERY));
+
+        std::vector<std::string> tokens;
+        uint64_t query_mask = 1;
+
+        for (size_t pos = 0; pos < query.length(); )
+        {
+            size_t end = query.find(' ', pos);
+            if (end == std::string::npos)
+                end = query.length();
+
+            if (end > pos)
+            {
+                tokens.push_back(query.substr(pos, end - pos));
+                for (size_t i = pos; i < end; i++)
+                    query_mask |= byte_bit((uint8_t)query[i]);
+            }
+
+            pos = end + 1;
+        }
+
+        if (tokens.empty() || limit == 0)
+            return ids;
+
+        // Query trigrams found in each item.
+        get_trigrams(query, trigrams_);
+        std::vector<uint16_t> hits(texts_.size(), 0);
+        std::vector<uint16_t> seen(texts_.size(), 0);
+
+        for (size_t i = 0; i < trigrams_.size(); i++)
+        {
+            auto it = postings_.find(trigrams_[i]);
+            if (it == postings_.end())
+                continue;
+
+            // Stale postings may repeat an id.
+            for (auto id : it->second)
+            {
+                if (seen[id] != i + 1)
+                {
+                    seen[id] = (uint16_t)(i + 1);
+                    hits[id]++;
+                }
+            }
+        }
+
+        // Tier 1 candidates. When enough items contain every token, scattered
+        // matches would rank below most of them and aren't searched.
+        std::vector<uint32_t> candidates;
+        bool all_trigrams = std::all_of(tokens.begin(), tokens.end(),
+            [](const std::string &token) { return token.length() >= 3; });
+
+        if (all_trigrams && !trigrams_.empty())
+        {
+            for (uint32_t id = 0; id < hits.size(); id++)
+            {
+                if (hits[id] == trigrams_.size() && masks_[id] != 0)
+                    candidates.push_back(id);
+            }
+        }
+
+        // Otherwise narrowed by the byte masks, removed items have none.
+        if (candidates.size() < limit)
+        {
+            candidates.clear();
+            for (uint32_t id = 0; id < masks_.size(); id++)
+            {
+                if ((masks_[id] & query_mask) == query_mask)
+                    candidates.push_back(id);
+            }
+        }
+
+        // Sort keys, subsequence matches rank above typo matches.
+        std::vector<std::pair<int64_t, uint32_t>> results;
+        std::vector<uint8_t> matched(texts_.size(), 0);
+
+        for (auto id : candidates)
+        {
+            const auto &text = texts_[id];
+            int score = 0;
+
+            for (const auto &token : tokens)
+            {
+                int s = score_token(text, token);
+                if (s < 0)
+                {
+                    score = -1;
+                    break;
+                }
+                score += s;
+            }
+
+            if (score < 0)
+                continue;
+
+            if (text.starts_with(tokens[0]))
+                score += 5;
+
+            matched[id] = 1;
+            results.emplace_back(((int64_t)score << 32) - (int64_t)std::min<size_t>(text.length(), 0xFFFF), id);
+        }
+
+        // Tier 2, at least half of the query trigrams.
+        size_t needed = (trigrams_.size() + 1) / 2;
+        for (uint32_t id = 0; id < hits.size() && needed > 0; id++)
+        {
+            if (hits[id] < needed || matched[id] || masks_[id] == 0)
+                continue;
+
+            // Hits may be stale after updates, then they're checked against the current text.
+            size_t shared = hits[id];
+            if (stale_ > 0)
+            {
+                get_trigrams(texts_[id], item_trigrams_);
+                shared = 0;
+                for (auto t : trigrams_)
+                    shared += std::binary_search(item_trigrams_.begin(), item_trigrams_.end(), t);
+            }
+
+            if (shared >= needed)
+            {
+                int64_t key = INT64_MIN / 2 + ((int64_t)shared << 16);
+                results.emplace_back(key - (int64_t)std::min<size_t>(texts_[id].length(), 0xFFFF), id);
+            }
+        }
+
+        // Top K, higher score first, then lower id.
+        auto cmp = [](const auto &a, const auto &b)
+        {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        };
+
+        size_t count = std::min(limit, results.size());
+        std::partial_sort(results.begin(), results.begin() + count, results.end(), cmp);
+
+        ids.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            ids.push_back(results[i].second);
+
+        return ids;
+    }
+
+private:
+    std::vector<std::string> texts_;
+    std::vector<uint64_t> masks_;       // zero for removed items
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings_;
+    size_t postings_size_ = 0;
+    size_t stale_ = 0;
+
+    std::vector<uint32_t> trigrams_;
+    std::vector<uint32_t> item_trigrams_;
+
+    // Rebuild the postings once half of them are stale.
+    void maybe_compact()
+    {
+        if (stale_ * 2 < postings_size_ || postings_size_ < 1024)
+            return;
+
+        postings_.clear();
+        postings_size_ = 0;
+        stale_ = 0;
+
+        for (uint32_t id = 0; id < texts_.size(); id++)
+        {
+            if (masks_[id] == 0)
+                continue;
+
+            get_trigrams(texts_[id], trigrams_);
+            for (auto t : trigrams_)
+                postings_[t].push_back(id);
+            postings_size_ += trigrams_.size();
+        }
+    }
+};
+
+// By name, creating an index again resets it.
+static std::unordered_map<std::string, SearchIndex> indexes_;
+
+static std::string get_utf8(V8Value *value)
+{
+    if (!value->isString())
+        return "";
+
+    CefScopedStr str = value->asString();
+    return str.to_utf8();
+}
+
+static SearchIndex *get_index(V8Value *const args[], int argc)
+{
+    if (argc < 1)
+        return nullptr;
+
+    auto it = indexes_.find(get_utf8(args[0]));
+    return it != indexes_.end() ? &it->second : nullptr;
+}
+
+static V8Value *v8_create_search_index(V8Value *const args[], int argc)
+{
+    if (argc > 0 && args[0]->isString())
+    {
+        auto name = get_utf8(args[0]);
+        indexes_[name] = SearchIndex{};
+
+        // Owned by the page.
+        renderer::on_context_released([name] { indexes_.erase(name); });
+    }
+
+    return nullptr;
+}
+
+static V8Value *v8_search_index_set(V8Value *const args[], int argc)
+{
+    auto index = get_index(args, argc);
+    if (index != nullptr && argc > 2 && args[1]->isUint())
+        index->set(args[1]->asUint(), get_utf8(args[2]));
+
+    return nullptr;
+}
+
+static V8Value *v8_search_index_remove(V8Value *const args[], int argc)
+{
+    auto index = get_index(args, argc);
+    if (index != nullptr && argc > 1 && args[1]->isUint())
+        index->remove(args[1]->asUint());
+
+    return nullptr;
+}
+
+static V8Value *v8_search_index_query(V8Value *const args[], int argc)
+{
+    auto index = get_index(args, argc);
+    if (index == nullptr || argc < 2)
+        return (V8Value *)V8Array::create(0);
+
+    size_t limit = argc > 2 && args[2]->isUint() ? args[2]->asUint() : 100;
+    auto ids = index->query(get_utf8(args[1]), limit);
+
+    auto array = V8Array::create((int)ids.size());
+    for (int i = 0; i < (int)ids.size(); i++)
+        array->set(i, V8Value::number((int)ids[i]));
+
+    return (V8Value *)array;
+}
+
+V8HandlerFunctionEntry v8_SearchEntries[]
+{
+    { "CreateSearchIndex", v8_create_search_index },
+    { "SearchIndexSet", v8_search_index_set },
+    { "SearchIndexRemove", v8_search_index_remove },
+    { "SearchIndexQuery", v8_search_index_query },
+    { nullptr }
+};
@@ -0,0 +1,109 @@
+#include "coro.h"
+
+namespace coro
+{
+    UrlRequest::UrlRequest()
+        : CefRefCount(this), request_(nullptr), response_(nullptr), total_(-1), done_(false),
+          status_(UR_UNKNOWN), waiter_(nullptr), ready_(nullptr), offset_(0)
+    {
+        cef_bind_method(UrlRequest, on_request_complete);
+        cef_bind_method(UrlRequest, on_download_progress);
+        cef_bind_method(UrlRequest, on_download_data);
+    }
+
+    UrlRequest::~UrlRequest()
+    {
+        if (response_ != nullptr)
+            response_->base.release(&response_->base);
+        if (request_ != nullptr)
+            request_->base.release(&request_->base);
+    }
+
+    UrlRequest *UrlRequest::create(cef_frame_t *frame, cef_request_t *request)
+    {
+        auto self = new UrlRequest();
+
+        // The request holds the client until completion.
+        self->base.add_ref(&self->base);
+
+        self->request_ = frame != nullptr
+            ? frame->create_urlrequest(frame, request, self)
+            : cef_urlrequest_create(request, self, nullptr);
+
+        if (self->request_ == nullptr)
+        {
+            self->done_ = true;
+            self->status_ = UR_FAILED;
+            self->base.release(&self->base);
+        }
+
+        return self;
+    }
+
+    cef_response_t *UrlRequest::get_response()
+    {
+        if (response_ == nullptr && request_ != nullptr)
+            response_ = request_->get_response(request_);
+
+        return response_;
+    }
+
+    void UrlRequest::cancel()
+    {
+        if (request_ != nullptr && !done_)
+            request_->cancel(request_);
+    }
+
+    void UrlRequest::notify()
+    {
+        if (waiter_ && ready_(this, offset_))
+        {
+            auto h = waiter_;
+            waiter_ = nullptr;
+            h.resume();
+        }
+    }
+
+    bool UrlRequest::has_response(UrlRequest *self, size_t)
+    {
+        return self->done_ || self->get_response() != nullptr;
+    }
+
+    bool UrlRequest::has_data(UrlRequest *self, size_t offset)
+    {
+        return self->done_ || self->data_.length() > offset;
+    }
+
+    bool UrlRequest::is_complete(UrlRequest *self, size_t)
+    {
+        return self->done_;
+    }
+
+    void UrlRequest::_on_request_complete(struct _cef_urlrequest_t *request)
+    {
+        done_ = true;
+        status_ = request->get_request_status(request);
+        get_response();
+
+        // A resumed coroutine may release its reference,
+        // keep alive until notified.
+        base.add_ref(&base);
+        notify();
+        base.release(&base);
+
+        // Drop the reference taken in create().
+        base.release(&base);
+    }
+
+    void UrlRequest::_on_download_progress(struct _cef_urlrequest_t *request, int64 current, int64 total)
+    {
+        total_ = total;
+        notify();
+    }
+
+    void UrlRequest::_on_download_data(struct _cef_urlrequest_t *request, const void *data, size_t data_length)
+    {
+        data_.append(static_cast<const char *>(data), data_length);
+        notify();
+    }
+}
@@ -7,13 +7,20 @@
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 #undef dylib
+#elif OS_LINUX
+#include <dlfcn.h>
+#include <link.h>
+#endif
+
+#if OS_MAC || OS_LINUX
+#include <sys/mman.h>
 #endif
 
 void *dylib::find_lib(const char *name)
 {
 #if OS_WIN
     return (void *)GetModuleHandleA(name);
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
     return dlopen(name, RTLD_NOLOAD | RTLD_LAZY);
 #endif
 }
@@ -22,7 +29,7 @@ void *dylib::find_proc(void *lib, const char *proc)
 {
 #if OS_WIN
     return (void *)GetProcAddress((HMODULE)lib, proc);
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
     return dlsym(lib, proc);
 #endif
 }
@@ -91,7 +98,7 @@ static void *get_base_address(const void *rladdr)
     {
         return (void *)module;
     }
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
     Dl_info info;
     if (dladdr(rladdr, &info))
     {
@@ -123,6 +130,36 @@ static size_t get_lib_size(void *base_address)
         lc = (struct load_command *)((char *)lc + lc->cmdsize);
     }
     return size;
+#elif OS_LINUX
+    struct module_range { uintptr_t base; size_t size; } range{ (uintptr_t)base_address, 0 };
+
+    // Size up to the end of the last executable segment.
+    dl_iterate_phdr([](struct dl_phdr_info *info, size_t, void *data) -> int
+    {
+        auto range = static_cast<module_range *>(data);
+        uintptr_t start = UINTPTR_MAX, end = 0;
+
+        for (int i = 0; i < info->dlpi_phnum; i++)
+        {
+            const auto &phdr = info->dlpi_phdr[i];
+            if (phdr.p_type != PT_LOAD)
+                continue;
+
+            uintptr_t seg_start = info->dlpi_addr + phdr.p_vaddr;
+            if (seg_start < start)
+                start = seg_start;
+            if (phdr.p_flags & PF_X)
+                end = seg_start + phdr.p_memsz;
+        }
+
+        if ((start & ~(uintptr_t)0xFFF) != range->base || end == 0)
+            return 0;
+
+        range->size = end - range->base;
+        return 1;
+    }, &range);
+
+    return range.size;
 #endif
 }
 
@@ -145,4 +182,41 @@ void *dylib::find_memory(const void *rladdr, const char *pattern)
         return scan_memory_pattern(base_address, lib_size, patern_bytes);
     else
         return scan_memory_bytes(base_address, lib_size, patern_bytes);
+}
+
+void dylib::prefetch(const void *rladdr)
+{
+    void *base_address = get_base_address(rladdr);
+    if (!base_address)
+        return;
+
+    size_t lib_size = get_lib_size(base_address);
+    if (!lib_size)
+        return;
+
+#if OS_WIN
+    WIN32_MEMORY_RANGE_ENTRY range{ base_address, lib_size };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#elif OS_MAC || OS_LINUX
+    // Unmapped gaps are skipped.
+    madvise(base_address, lib_size, MADV_WILLNEED);
+#endif
+}
+
+void dylib::prefetch(const void *address, size_t length)
+{
+    if (address == nullptr || length == 0)
+        return;
+
+    // Whole pages, madvise needs an aligned start.
+    const size_t page = 4096;
+    auto begin = (uintptr_t)address & ~(uintptr_t)(page - 1);
+    auto end = (uintptr_t)address + length;
+
+#if OS_WIN
+    WIN32_MEMORY_RANGE_ENTRY range{ (void *)begin, end - begin };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#elif OS_MAC || OS_LINUX
+    madvise((void *)begin, end - begin, MADV_WILLNEED);
+#endif
 }
\ No newline at end of file
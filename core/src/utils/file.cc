@@ -1,9 +1,19 @@
 #include "pengu.h"
 
-#if OS_MAC
+#if OS_MAC || OS_LINUX
 #include <sys/stat.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#endif
+
+#if OS_MAC
+#include <sys/attr.h>
+#include <sys/vnode.h>
+#elif OS_LINUX
+#include <sys/syscall.h>
 #endif
 
 bool file::is_symlink(const path &path)
@@ -15,7 +25,7 @@ bool file::is_symlink(const path &path)
         return false;
 
     return attr & FILE_ATTRIBUTE_REPARSE_POINT;
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
     return false;
 #endif
 }
@@ -27,7 +37,7 @@ bool file::is_dir(const path &path)
     if (attr == INVALID_FILE_ATTRIBUTES)
         return false;
     return attr & FILE_ATTRIBUTE_DIRECTORY;
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
     struct stat buffer;
     if (stat(path.string().c_str(), &buffer) == 0) {
         return S_ISDIR(buffer.st_mode);
@@ -43,7 +53,7 @@ bool file::is_file(const path &path)
     if (attr == INVALID_FILE_ATTRIBUTES)
         return false;
     return !(attr & FILE_ATTRIBUTE_DIRECTORY);
-#elif OS_MAC
+#elif OS_MAC || OS_LINUX
     struct stat buffer;
     if (stat(path.string().c_str(), &buffer) == 0) {
         return S_ISREG(buffer.st_mode);
@@ -52,30 +62,296 @@ bool file::is_file(const path &path)
 #endif
 }
 
-bool file::read_file(const path &path, void **buffer, size_t *length)
+static std::error_code last_error()
 {
 #if OS_WIN
-    FILE* fp = _wfopen(path.c_str(), L"rb");
+    return std::error_code((int)GetLastError(), std::system_category());
 #else
-    FILE* fp = fopen(path.c_str(), "rb");
+    return std::error_code(errno, std::system_category());
 #endif
-    if (fp != nullptr)
+}
+
+file::File::~File()
+{
+    close();
+}
+
+bool file::File::open(const path &path, std::error_code &ec)
+{
+    close();
+    ec.clear();
+    position_ = 0;
+
+#if OS_WIN
+    handle_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle_ == INVALID_HANDLE_VALUE)
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0)
+#endif
+    {
+        ec = last_error();
+        return false;
+    }
+
+    return true;
+}
+
+bool file::File::open_append(const path &path, std::error_code &ec)
+{
+    close();
+    ec.clear();
+    position_ = 0;
+
+#if OS_WIN
+    // Without FILE_WRITE_DATA, every write goes to the end.
+    handle_ = CreateFileW(path.c_str(), GENERIC_READ | FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle_ == INVALID_HANDLE_VALUE)
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+#endif
+    {
+        ec = last_error();
+        return false;
+    }
+
+    return true;
+}
+
+void file::File::close()
+{
+#if OS_WIN
+    if (handle_ != INVALID_HANDLE_VALUE)
+        CloseHandle(handle_);
+    handle_ = INVALID_HANDLE_VALUE;
+#else
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = -1;
+#endif
+}
+
+bool file::File::is_open() const
+{
+#if OS_WIN
+    return handle_ != INVALID_HANDLE_VALUE;
+#else
+    return fd_ >= 0;
+#endif
+}
+
+int64_t file::File::size(std::error_code &ec) const
+{
+    ec.clear();
+#if OS_WIN
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(handle_, &size))
+        return (int64_t)size.QuadPart;
+#else
+    struct stat st;
+    if (fstat(fd_, &st) == 0)
+        return (int64_t)st.st_size;
+#endif
+    ec = last_error();
+    return -1;
+}
+
+size_t file::File::read(void *buffer, size_t length, std::error_code &ec)
+{
+    size_t read = read_at(buffer, length, position_, ec);
+    position_ += (int64_t)read;
+    return read;
+}
+
+size_t file::File::read_at(void *buffer, size_t length, int64_t offset, std::error_code &ec) const
+{
+    ec.clear();
+    size_t total = 0;
+
+    // Short reads are continued until the end of file.
+    while (total < length)
+    {
+        size_t chunk = std::min<size_t>(length - total, 1 << 30);
+#if OS_WIN
+        OVERLAPPED ov{};
+        ov.Offset = (DWORD)(uint64_t)offset;
+        ov.OffsetHigh = (DWORD)((uint64_t)offset >> 32);
+
+        DWORD read = 0;
+        if (!ReadFile(handle_, (uint8_t *)buffer + total, (DWORD)chunk, &read, &ov))
+        {
+            if (GetLastError() != ERROR_HANDLE_EOF)
+                ec = last_error();
+            break;
+        }
+#else
+        ssize_t read = pread(fd_, (uint8_t *)buffer + total, chunk, (off_t)offset);
+        if (read < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ec = last_error();
+            break;
+        }
+#endif
+        if (read == 0)
+            break;
+
+        total += (size_t)read;
+        offset += (int64_t)read;
+    }
+
+    return total;
+}
+
+bool file::File::append(const void *buffer, size_t length, std::error_code &ec)
+{
+    ec.clear();
+    size_t total = 0;
+
+    while (total < length)
     {
-        fseek(fp, 0, SEEK_END);
-        long size = ftell(fp);
-        fseek(fp, 0, SEEK_SET);
+        size_t chunk = std::min<size_t>(length - total, 1 << 30);
+#if OS_WIN
+        DWORD written = 0;
+        if (!WriteFile(handle_, (const uint8_t *)buffer + total, (DWORD)chunk, &written, NULL))
+        {
+            ec = last_error();
+            return false;
+        }
+#else
+        ssize_t written = ::write(fd_, (const uint8_t *)buffer + total, chunk);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            ec = last_error();
+            return false;
+        }
+#endif
+        total += (size_t)written;
+    }
 
-        *buffer = malloc(size + 1);
-        if (length) *length = size;
+    return true;
+}
 
-        fread(*buffer, 1, size, fp);
-        reinterpret_cast<uint8_t *>(*buffer)[size] = '\0';
+bool file::File::try_lock(std::error_code &ec)
+{
+    ec.clear();
 
-        fclose(fp);
+#if OS_WIN
+    OVERLAPPED overlapped{};
+    if (!LockFileEx(handle_, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, MAXDWORD, MAXDWORD, &overlapped))
+#else
+    if (flock(fd_, LOCK_EX | LOCK_NB) != 0)
+#endif
+    {
+        ec = last_error();
+        return false;
+    }
+
+    return true;
+}
+
+file::MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool file::MappedFile::open(const path &path, std::error_code &ec)
+{
+    close();
+
+    File file;
+    if (!file.open(path, ec))
+        return false;
+
+    int64_t size = file.size(ec);
+    if (size < 0)
+        return false;
+
+    // Nothing to map.
+    if (size == 0)
         return true;
+
+    if ((uint64_t)size > SIZE_MAX)
+    {
+        ec = std::make_error_code(std::errc::file_too_large);
+        return false;
     }
 
-    return false;
+#if OS_WIN
+    // The view keeps the mapping alive.
+    HANDLE mapping = CreateFileMappingW(file.handle_, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, (SIZE_T)size) : nullptr;
+    if (view == nullptr)
+        ec = last_error();
+
+    if (mapping != NULL)
+        CloseHandle(mapping);
+#else
+    void *view = mmap(nullptr, (size_t)size, PROT_READ, MAP_PRIVATE, file.fd_, 0);
+    if (view == MAP_FAILED)
+    {
+        ec = last_error();
+        view = nullptr;
+    }
+#endif
+
+    if (view == nullptr)
+        return false;
+
+    data_ = static_cast<const uint8_t *>(view);
+    size_ = (size_t)size;
+    return true;
+}
+
+void file::MappedFile::close()
+{
+    if (data_ != nullptr)
+    {
+#if OS_WIN
+        UnmapViewOfFile(data_);
+#else
+        munmap((void *)data_, size_);
+#endif
+    }
+
+    data_ = nullptr;
+    size_ = 0;
+}
+
+bool file::read_file(const path &path, void **buffer, size_t *length)
+{
+    std::error_code ec;
+    File file;
+    if (!file.open(path, ec))
+        return false;
+
+    int64_t size = file.size(ec);
+    if (size < 0 || (uint64_t)size >= SIZE_MAX)
+        return false;
+
+    auto data = static_cast<uint8_t *>(malloc((size_t)size + 1));
+    if (data == nullptr)
+        return false;
+
+    // May be shorter if the file is truncated meanwhile.
+    size_t read = file.read(data, (size_t)size, ec);
+    if (ec)
+    {
+        free(data);
+        return false;
+    }
+
+    data[read] = '\0';
+    *buffer = data;
+    if (length) *length = read;
+
+    return true;
 }
 
 bool file::write_file(const path &path, const void *buffer, size_t length)
@@ -88,42 +364,259 @@ bool file::write_file(const path &path, const void *buffer, size_t length)
 
     if (fp != nullptr)
     {
-        fwrite(buffer, 1, length, fp);
-        fclose(fp);
-        return true;
+        size_t written = fwrite(buffer, 1, length, fp);
+        return fclose(fp) == 0 && written == length;
     }
 
     return false;
 }
 
+bool file::write_file_atomic(const path &path, const void *buffer, size_t length)
+{
+#if OS_WIN
+    auto pid = (uint32_t)GetCurrentProcessId();
+#else
+    auto pid = (uint32_t)getpid();
+#endif
+
+    // Unique per process and call, writers don't share the temp file.
+    static std::atomic<uint32_t> counter{0};
+    auto temp = path;
+    temp += ".tmp" + std::to_string(pid) + "-" + std::to_string(counter++);
+
+    std::error_code ec;
+    if (write_file(temp, buffer, length))
+    {
+        std::filesystem::rename(temp, path, ec);
+        if (!ec)
+            return true;
+    }
+
+    std::filesystem::remove(temp, ec);
+    return false;
+}
+
+bool file::prefetch(const path &path)
+{
+#if OS_WIN
+    // A plain read, PrefetchVirtualMemory needs the view mapped until its reads are done.
+    std::error_code ec;
+    File file;
+    if (!file.open(path, ec))
+        return false;
+
+    auto buffer = std::make_unique<char[]>(64 * 1024);
+    while (file.read(buffer.get(), 64 * 1024, ec) == 64 * 1024);
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+#if OS_MAC
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        struct radvisory advice{ 0, (int)std::min<off_t>(st.st_size, INT_MAX) };
+        fcntl(fd, F_RDADVISE, &advice);
+    }
+#else
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+    ::close(fd);
+    return true;
+#endif
+}
+
 std::vector<path> file::read_dir(const path &dir)
 {
     std::vector<path> files;
-    files.clear();
+
+    for (auto &entry : read_dir_entries(dir))
+    {
+        if (entry.is_file || entry.is_dir)
+            files.push_back(std::move(entry.name));
+    }
+
+    return files;
+}
+
+#if OS_MAC || OS_LINUX
+// Follows symlinks, like is_dir() and is_file().
+static void stat_entry(int dirfd, const char *name, file::DirEntry &entry, bool stat_time)
+{
+    struct stat st;
+    if (fstatat(dirfd, name, &st, 0) != 0)
+        return;
+
+    entry.is_dir = S_ISDIR(st.st_mode);
+    entry.is_file = S_ISREG(st.st_mode);
+
+    if (stat_time)
+    {
+#if OS_MAC
+        entry.mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+        entry.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+        entry.size = entry.is_file ? (int64_t)st.st_size : -1;
+    }
+}
+#endif
+
+std::vector<file::DirEntry> file::read_dir_entries(const path &dir, bool stat)
+{
+    std::vector<DirEntry> entries;
 
 #if OS_WIN
+    // Basic info skips the short names, large fetch asks for bigger batches.
     std::wstring target = dir.wstring() + L"\\*";
     WIN32_FIND_DATAW fd;
-    HANDLE hFind = FindFirstFileW(target.c_str(), &fd);
+    HANDLE hFind = FindFirstFileExW(target.c_str(), FindExInfoBasic, &fd,
+        FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+
+    if (hFind != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0)
+                continue;
 
-    if (hFind != INVALID_HANDLE_VALUE) {
-        do {
-            files.push_back(fd.cFileName);
+            bool is_dir = fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+            bool is_file = !is_dir && !(fd.dwFileAttributes & FILE_ATTRIBUTE_DEVICE);
+
+            DirEntry entry{ fd.cFileName, is_dir, is_file,
+                (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0, -1, -1 };
+
+            if (stat)
+            {
+                // FILETIME is 100ns since 1601.
+                uint64_t time = ((uint64_t)fd.ftLastWriteTime.dwHighDateTime << 32) | fd.ftLastWriteTime.dwLowDateTime;
+                entry.mtime = (int64_t)(time - 116444736000000000ull) * 100;
+                entry.size = is_file ? (int64_t)(((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow) : -1;
+            }
+
+            entries.push_back(std::move(entry));
         } while (FindNextFileW(hFind, &fd));
+
         FindClose(hFind);
     }
 #elif OS_MAC
-    if (DIR *pdir = opendir(dir.string().c_str())) {
-        struct dirent *entry = readdir(pdir);
-        while (entry != NULL) {
-            if (entry->d_type & (DT_REG | DT_DIR)) {
-                files.push_back(entry->d_name);
+    int dirfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0)
+        return entries;
+
+    // Names, types and times of many entries in one call.
+    struct attrlist attrs{};
+    attrs.bitmapcount = ATTR_BIT_MAP_COUNT;
+    attrs.commonattr = ATTR_CMN_RETURNED_ATTRS | ATTR_CMN_ERROR | ATTR_CMN_NAME | ATTR_CMN_OBJTYPE
+        | (stat ? ATTR_CMN_MODTIME : 0);
+    attrs.fileattr = stat ? ATTR_FILE_DATALENGTH : 0;
+
+    alignas(8) static thread_local char buffer[64 * 1024];
+    int count;
+
+    while ((count = getattrlistbulk(dirfd, &attrs, buffer, sizeof(buffer), 0)) > 0)
+    {
+        char *ptr = buffer;
+        for (int i = 0; i < count; i++)
+        {
+            char *item = ptr;
+            uint32_t length;
+            memcpy(&length, item, sizeof(length));
+            ptr += length;
+
+            char *field = item + sizeof(uint32_t);
+            attribute_set_t returned;
+            memcpy(&returned, field, sizeof(returned));
+            field += sizeof(returned);
+
+            if (returned.commonattr & ATTR_CMN_ERROR)
+            {
+                uint32_t error;
+                memcpy(&error, field, sizeof(error));
+                field += sizeof(error);
+                if (error != 0)
+                    continue;
+            }
+
+            attrreference_t ref;
+            memcpy(&ref, field, sizeof(ref));
+            const char *name = field + ref.attr_dataoffset;
+            field += sizeof(ref);
+
+            fsobj_type_t type;
+            memcpy(&type, field, sizeof(type));
+            field += sizeof(type);
+
+            DirEntry entry{ name, type == VDIR, type == VREG, type == VLNK, -1, -1 };
+
+            if (stat)
+            {
+                struct timespec ts;
+                memcpy(&ts, field, sizeof(ts));
+                field += sizeof(ts);
+                entry.mtime = (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+                if (type == VREG && (returned.fileattr & ATTR_FILE_DATALENGTH))
+                {
+                    off_t size;
+                    memcpy(&size, field, sizeof(size));
+                    entry.size = (int64_t)size;
+                }
             }
-            entry = readdir(pdir);
+
+            if (entry.is_symlink)
+                stat_entry(dirfd, name, entry, stat);
+
+            entries.push_back(std::move(entry));
         }
-        closedir(pdir);
     }
+
+    close(dirfd);
+#elif OS_LINUX
+    int dirfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0)
+        return entries;
+
+    struct linux_dirent64
+    {
+        ino64_t d_ino;
+        off64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    // Many entries per syscall, readdir() reads in smaller chunks.
+    alignas(8) static thread_local char buffer[64 * 1024];
+    long length;
+
+    while ((length = syscall(SYS_getdents64, dirfd, buffer, sizeof(buffer))) > 0)
+    {
+        for (long offset = 0; offset < length; )
+        {
+            auto dent = reinterpret_cast<linux_dirent64 *>(buffer + offset);
+            offset += dent->d_reclen;
+
+            const char *name = dent->d_name;
+            if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+                continue;
+
+            DirEntry entry{ name, dent->d_type == DT_DIR, dent->d_type == DT_REG, dent->d_type == DT_LNK,
+                -1, -1 };
+
+            // Some filesystems don't fill the type.
+            if (stat || entry.is_symlink || dent->d_type == DT_UNKNOWN)
+                stat_entry(dirfd, name, entry, stat);
+
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    close(dirfd);
 #endif
 
-    return files;
-}
\ No newline at end of file
+    return entries;
+}
@@ -0,0 +1,427 @@
+#include "pengu.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include "include/capi/cef_parser_capi.h"
+#include "include/capi/cef_values_capi.h"
+
+static void read_string_list(cef_dictionary_value_t *dict, const cef_string_t *key, std::vector<std::string> &out)
+{
+    if (dict->get_type(dict, key) != VTYPE_LIST)
+        return;
+
+    auto list = dict->get_list(dict, key);
+    for (size_t i = 0; i < list->get_size(list); i++)
+    {
+        if (list->get_type(list, i) == VTYPE_STRING)
+        {
+            CefScopedStr value{ list->get_string(list, i) };
+            if (!value.empty())
+                out.push_back(value.to_utf8());
+        }
+    }
+
+    list->base.release(&list->base);
+}
+
+static std::string get_string(cef_dictionary_value_t *dict, const cef_string_t *key)
+{
+    if (dict->get_type(dict, key) != VTYPE_STRING)
+        return "";
+
+    CefScopedStr value{ dict->get_string(dict, key) };
+    return value.to_utf8();
+}
+
+// "shared": [{ "name": "solid-js", "version": "1.7.8", "entry": "vendor/solid.js" }]
+static void read_shared_list(cef_dictionary_value_t *dict, std::vector<plugin::SharedDependency> &out)
+{
+    auto key = u"shared"_s;
+    if (dict->get_type(dict, &key) != VTYPE_LIST)
+        return;
+
+    auto list = dict->get_list(dict, &key);
+    for (size_t i = 0; i < list->get_size(list); i++)
+    {
+        if (list->get_type(list, i) != VTYPE_DICTIONARY)
+            continue;
+
+        auto item = list->get_dictionary(list, i);
+        plugin::SharedDependency dep{
+            get_string(item, &u"name"_s),
+            get_string(item, &u"version"_s),
+            get_string(item, &u"entry"_s),
+        };
+        item->base.release(&item->base);
+
+        if (!dep.name.empty() && !dep.entry.empty())
+            out.push_back(std::move(dep));
+    }
+
+    list->base.release(&list->base);
+}
+
+bool plugin::read_manifest(const path &dir, Manifest &manifest)
+{
+    void *buffer; size_t length;
+    if (!file::read_file(dir / "package.json", &buffer, &length))
+        return false;
+
+    CefStr json{ (const char *)buffer, length };
+    free(buffer);
+
+    auto value = cef_parse_json(&json, JSON_PARSER_RFC);
+    if (value == nullptr)
+        return false;
+
+    bool found = false;
+    if (value->get_type(value) == VTYPE_DICTIONARY)
+    {
+        auto root = value->get_dictionary(value);
+        auto key = u"pengu"_s;
+
+        if (root->get_type(root, &key) == VTYPE_DICTIONARY)
+        {
+            auto pengu = root->get_dictionary(root, &key);
+            read_string_list(pengu, &u"styles"_s, manifest.styles);
+            read_shared_list(pengu, manifest.shared);
+            read_string_list(pengu, &u"dependencies"_s, manifest.dependencies);
+
+            pengu->base.release(&pengu->base);
+            found = true;
+        }
+
+        root->base.release(&root->base);
+    }
+
+    value->base.release(&value->base);
+    return found;
+}
+
+std::vector<path> plugin::get_entries()
+{
+    std::vector<path> entries;
+    auto plugins_dir = config::plugins_dir();
+
+    /*
+        plugins/
+          |__@author
+            |__plugin-1
+              |__index.js       <-- by author plugin
+          |__plugin-2
+            |__index.js         <-- normal plugin
+          |__plugin-3.js        <-- top-level plugin
+    */
+
+    if (file::is_dir(plugins_dir))
+    {
+        // Scan plugins dir, typed entries save a stat per name.
+        for (const auto &item : file::read_dir_entries(plugins_dir))
+        {
+            const auto &name = item.name;
+            auto ch1 = name.c_str()[0];
+
+            // Skip name starts with underscore or dot.
+            if (ch1 == '_' || ch1 == '.')
+                continue;
+
+            auto path = plugins_dir / name;
+
+            if (item.is_file)
+            {
+                // Top-level JS file.
+                if (name.string().ends_with(".js"))
+                {
+                    entries.push_back(name);
+                }
+            }
+            else if (item.is_dir)
+            {
+                // Group by @author.
+                if (ch1 == '@')
+                {
+                    for (const auto &subitem : file::read_dir_entries(path))
+                    {
+                        const auto &subname = subitem.name;
+                        auto ch1 = subname.c_str()[0];
+                        if (ch1 == '_' || ch1 == '.' || !subitem.is_dir)
+                            continue;
+
+                        if (file::is_file(path / subname / "index.js"))
+                        {
+                            entries.push_back(name / subname / "index.js");
+                        }
+                    }
+                }
+                // Sub-folder with index.
+                else if (file::is_file(path / "index.js"))
+                {
+                    entries.push_back(name / "index.js");
+                }
+            }
+        }
+    }
+
+    return entries;
+}
+
+// Plugins are named by their folder, top-level ones by their file.
+static std::string get_plugin_name(const path &entry)
+{
+    auto name = (entry.has_parent_path() ? entry.parent_path() : entry).generic_string();
+    for (auto &c : name)
+        c = (char)tolower((unsigned char)c);
+    return name;
+}
+
+std::vector<plugin::LoadItem> plugin::resolve_load_order(const std::vector<path> &entries)
+{
+    size_t count = entries.size();
+    auto plugins_dir = config::plugins_dir();
+
+    std::unordered_map<std::string, int> by_name;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!is_disabled(entries[i]))
+            by_name.emplace(get_plugin_name(entries[i]), (int)i);
+    }
+
+    // Edges to known prerequisites, in entry indices.
+    std::vector<std::vector<int>> prereqs(count);
+    std::vector<std::vector<int>> dependents(count);
+    std::vector<int> pending(count, 0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Manifest manifest;
+        auto dir = entries[i].parent_path();
+        if (dir.empty() || is_disabled(entries[i]) || !read_manifest(plugins_dir / dir, manifest))
+            continue;
+
+        for (auto name : manifest.dependencies)
+        {
+            for (auto &c : name)
+                c = (char)tolower((unsigned char)c);
+
+            auto it = by_name.find(name);
+            if (it == by_name.end() || it->second == (int)i
+                || std::find(prereqs[i].begin(), prereqs[i].end(), it->second) != prereqs[i].end())
+                continue;
+
+            prereqs[i].push_back(it->second);
+            dependents[it->second].push_back((int)i);
+            pending[i]++;
+        }
+    }
+
+    // Kahn's algorithm by levels, a wave is one level.
+    std::vector<int> order, wave(count, 0), position(count, -1);
+    std::vector<int> ready;
+    order.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (pending[i] == 0)
+            ready.push_back((int)i);
+    }
+
+    while (order.size() < count)
+    {
+        // Only cycles are left, the first entry drops its unresolved prerequisites.
+        if (ready.empty())
+        {
+            int first = 0;
+            while (position[first] >= 0)
+                first++;
+
+            std::erase_if(prereqs[first], [&position](int p) { return position[p] < 0; });
+            ready.push_back(first);
+        }
+
+        std::sort(ready.begin(), ready.end());
+        std::vector<int> next;
+
+        for (int i : ready)
+        {
+            position[i] = (int)order.size();
+            order.push_back(i);
+
+            for (int p : prereqs[i])
+                wave[i] = std::max(wave[i], wave[p] + 1);
+
+            for (int d : dependents[i])
+            {
+                if (--pending[d] == 0 && position[d] < 0)
+                    next.push_back(d);
+            }
+        }
+
+        ready = std::move(next);
+    }
+
+    // Stable by wave, prerequisites always come first.
+    std::stable_sort(order.begin(), order.end(), [&wave](int a, int b) { return wave[a] < wave[b]; });
+    for (size_t i = 0; i < count; i++)
+        position[order[i]] = (int)i;
+
+    std::vector<LoadItem> items;
+    items.reserve(count);
+
+    for (int i : order)
+    {
+        LoadItem item{ entries[i], {}, wave[i] };
+        for (int p : prereqs[i])
+            item.dependencies.push_back(position[p]);
+
+        items.push_back(std::move(item));
+    }
+
+    return items;
+}
+
+// FNV-1a, matches getHash() in preload/loader.ts.
+static uint32_t hash_entry(const std::string &entry)
+{
+    uint32_t hash = 0x811c9dc5;
+    for (unsigned char c : entry)
+    {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool plugin::is_disabled(const path &entry)
+{
+    static std::mutex mutex;
+    static std::unordered_set<uint32_t> blacklist;
+    static std::string loaded_list;
+    static bool loaded = false;
+
+    auto list = config::disabled_plugins();
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Parsed again after a config reload.
+    if (!loaded || list != loaded_list)
+    {
+        blacklist.clear();
+        size_t pos = 0;
+
+        while (pos < list.length())
+        {
+            size_t end = list.find(',', pos);
+            if (end == std::string::npos)
+                end = list.length();
+
+            if (end > pos)
+                blacklist.insert((uint32_t)strtoul(list.substr(pos, end - pos).c_str(), nullptr, 16));
+
+            pos = end + 1;
+        }
+
+        loaded_list = std::move(list);
+        loaded = true;
+    }
+
+    auto name = entry.generic_string();
+    for (auto &c : name)
+        c = (char)tolower((unsigned char)c);
+
+    // Built-in plugins are loaded with the preload script.
+    if (name.starts_with("@default/"))
+        return true;
+
+    return blacklist.count(hash_entry(name)) > 0;
+}
+
+// Numeric compare of dotted versions, pre-release tags sort lower.
+static int compare_versions(const std::string &a, const std::string &b)
+{
+    size_t i = 0, j = 0;
+    while (i < a.length() || j < b.length())
+    {
+        bool a_end = i >= a.length() || a[i] == '-' || a[i] == '+';
+        bool b_end = j >= b.length() || b[j] == '-' || b[j] == '+';
+
+        if (a_end || b_end)
+        {
+            if (a_end && b_end)
+            {
+                // 1.0.0-beta < 1.0.0
+                bool a_pre = i < a.length() && a[i] == '-';
+                bool b_pre = j < b.length() && b[j] == '-';
+                return a_pre == b_pre ? 0 : a_pre ? -1 : 1;
+            }
+            return a_end ? -1 : 1;
+        }
+
+        unsigned long x = strtoul(a.c_str() + i, nullptr, 10);
+        unsigned long y = strtoul(b.c_str() + j, nullptr, 10);
+        if (x != y)
+            return x < y ? -1 : 1;
+
+        while (i < a.length() && isdigit((unsigned char)a[i])) i++;
+        while (j < b.length() && isdigit((unsigned char)b[j])) j++;
+        if (i < a.length() && a[i] == '.') i++;
+        if (j < b.length() && b[j] == '.') j++;
+    }
+    return 0;
+}
+
+static std::mutex shared_mutex_;
+static std::shared_ptr<const std::vector<plugin::SharedModule>> shared_modules_;
+
+static std::shared_ptr<const std::vector<plugin::SharedModule>> read_shared_modules()
+{
+    auto modules = std::make_shared<std::vector<plugin::SharedModule>>();
+    auto plugins_dir = config::plugins_dir();
+
+    // Sorted entries, so equal versions always resolve to the same copy.
+    auto entries = plugin::get_entries();
+    std::sort(entries.begin(), entries.end());
+
+    for (const auto &entry : entries)
+    {
+        auto dir = entry.parent_path();
+        if (dir.empty() || plugin::is_disabled(entry))
+            continue;
+
+        plugin::Manifest manifest;
+        if (!plugin::read_manifest(plugins_dir / dir, manifest))
+            continue;
+
+        for (const auto &dep : manifest.shared)
+        {
+            path file = (plugins_dir / dir / dep.entry).lexically_normal();
+            auto rel = file.lexically_relative(plugins_dir / dir);
+            if (rel.empty() || *rel.begin() == ".." || !file::is_file(file))
+                continue;
+
+            auto it = std::find_if(modules->begin(), modules->end(),
+                [&dep](const plugin::SharedModule &m) { return m.name == dep.name; });
+
+            if (it == modules->end())
+                modules->push_back(plugin::SharedModule{ dep.name, dep.version, file.parent_path(), file.filename() });
+            else if (compare_versions(dep.version, it->version) > 0)
+                *it = plugin::SharedModule{ dep.name, dep.version, file.parent_path(), file.filename() };
+        }
+    }
+
+    return modules;
+}
+
+std::shared_ptr<const std::vector<plugin::SharedModule>> plugin::get_shared_modules()
+{
+    std::lock_guard<std::mutex> lock(shared_mutex_);
+    if (shared_modules_ == nullptr)
+        shared_modules_ = read_shared_modules();
+
+    return shared_modules_;
+}
+
+void plugin::invalidate_shared_modules()
+{
+    std::lock_guard<std::mutex> lock(shared_mutex_);
+    shared_modules_ = nullptr;
+}
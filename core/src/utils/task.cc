@@ -0,0 +1,158 @@
+#include "pengu.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "include/capi/cef_task_capi.h"
+
+// Work-stealing pool, shared by the whole process and started on first use.
+// Each worker owns a deque per priority, it pops its own work LIFO
+// and steals from the others FIFO when running out.
+
+struct Worker
+{
+    std::mutex mutex;
+    std::deque<std::function<void()>> queues[task::PRIORITY_COUNT];
+};
+
+// Never destroyed, workers may still be waiting at exit.
+struct Pool
+{
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+    size_t pending = 0;
+    std::atomic<size_t> next_worker{0};
+};
+
+static Pool *pool_;
+static std::once_flag init_flag_;
+static thread_local int worker_index_ = -1;
+
+static bool pop_task(int self, std::function<void()> &out)
+{
+    auto &workers = pool_->workers;
+    int count = (int)workers.size();
+
+    for (int p = 0; p < task::PRIORITY_COUNT; p++)
+    {
+        {
+            auto &own = *workers[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.queues[p].empty())
+            {
+                out = std::move(own.queues[p].back());
+                own.queues[p].pop_back();
+                return true;
+            }
+        }
+
+        for (int i = 1; i < count; i++)
+        {
+            auto &victim = *workers[(self + i) % count];
+            std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+            if (lock.owns_lock() && !victim.queues[p].empty())
+            {
+                out = std::move(victim.queues[p].front());
+                victim.queues[p].pop_front();
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void worker_main(int index)
+{
+    worker_index_ = index;
+    std::function<void()> fn;
+
+    while (true)
+    {
+        if (pop_task(index, fn))
+        {
+            {
+                std::lock_guard<std::mutex> lock(pool_->idle_mutex);
+                pool_->pending--;
+            }
+            fn();
+            fn = nullptr;
+            continue;
+        }
+
+        // Sleep until work is pushed. A steal may fail on a busy lock,
+        // the work is still pending then and it's retried right away.
+        std::unique_lock<std::mutex> lock(pool_->idle_mutex);
+        pool_->idle_cv.wait(lock, [] { return pool_->pending > 0; });
+    }
+}
+
+static void init_pool()
+{
+    unsigned cores = std::thread::hardware_concurrency();
+    // Leave a core for the CEF threads, but keep at least 2 workers.
+    size_t count = cores > 3 ? cores - 1 : 2;
+    count = count > 16 ? 16 : count;
+
+    pool_ = new Pool();
+    for (size_t i = 0; i < count; i++)
+        pool_->workers.push_back(std::make_unique<Worker>());
+
+    for (size_t i = 0; i < count; i++)
+        std::thread(worker_main, (int)i).detach();
+}
+
+size_t task::worker_count()
+{
+    std::call_once(init_flag_, init_pool);
+    return pool_->workers.size();
+}
+
+void task::run(std::function<void()> fn, priority p)
+{
+    std::call_once(init_flag_, init_pool);
+
+    int index = worker_index_ >= 0 ? worker_index_
+        : (int)(pool_->next_worker++ % pool_->workers.size());
+
+    {
+        auto &worker = *pool_->workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[p].push_back(std::move(fn));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool_->idle_mutex);
+        pool_->pending++;
+    }
+
+    pool_->idle_cv.notify_one();
+}
+
+struct FunctionTask : CefRefCount<cef_task_t>
+{
+    FunctionTask(std::function<void()> &&fn) : CefRefCount(this), fn_(std::move(fn))
+    {
+        cef_bind_method(FunctionTask, execute);
+    }
+
+private:
+    std::function<void()> fn_;
+
+    void _execute()
+    {
+        fn_();
+    }
+};
+
+bool task::post_to(cef_thread_id_t tid, std::function<void()> fn)
+{
+    return cef_post_task(tid, new FunctionTask(std::move(fn))) != 0;
+}
+
+bool task::post_to(cef_thread_id_t tid, std::function<void()> fn, int64_t delay_ms)
+{
+    return cef_post_delayed_task(tid, new FunctionTask(std::move(fn)), delay_ms) != 0;
+}
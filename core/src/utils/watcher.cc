@@ -0,0 +1,302 @@
+#include "pengu.h"
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#if OS_WIN
+#elif OS_MAC
+#include <CoreServices/CoreServices.h>
+#include <dispatch/dispatch.h>
+#elif OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <unordered_map>
+#endif
+
+// Recursive watches with the native APIs (ReadDirectoryChangesW, FSEvents,
+// inotify), one per root dir. Changed paths are coalesced and delivered
+// once the tree has been quiet for a moment, a burst of writes like
+// a plugin update is one notification.
+
+static constexpr auto QUIET_TIME = std::chrono::milliseconds(150);
+static constexpr auto MAX_DELAY = std::chrono::milliseconds(1000);
+
+struct Subscription
+{
+    int id;
+    path dir;
+    watcher::callback fn;
+};
+
+// Never destroyed, the detached threads may still wait on them at exit.
+static std::mutex &mutex_ = *new std::mutex;
+static std::condition_variable &cv_ = *new std::condition_variable;
+static std::vector<Subscription> subscriptions_;
+static std::vector<path> roots_;
+static std::set<path> pending_;
+static std::chrono::steady_clock::time_point first_event_;
+static std::chrono::steady_clock::time_point last_event_;
+static int next_id_ = 1;
+static bool started_ = false;
+
+static bool is_under(const path &file, const path &dir)
+{
+    auto rel = file.lexically_relative(dir);
+    return !rel.empty() && *rel.begin() != "..";
+}
+
+// Called by the backends.
+static void notify(const path &file)
+{
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty())
+            first_event_ = now;
+        last_event_ = now;
+        pending_.insert(file.lexically_normal());
+    }
+    cv_.notify_one();
+}
+
+static void dispatch_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        cv_.wait(lock, [] { return !pending_.empty(); });
+
+        // Wait for a quiet period, but not forever.
+        while (true)
+        {
+            auto deadline = std::min(last_event_ + QUIET_TIME, first_event_ + MAX_DELAY);
+            if (std::chrono::steady_clock::now() >= deadline)
+                break;
+            cv_.wait_until(lock, deadline);
+        }
+
+        std::vector<path> files(pending_.begin(), pending_.end());
+        pending_.clear();
+
+        for (const auto &sub : subscriptions_)
+        {
+            std::vector<path> matched;
+            for (const auto &file : files)
+                if (is_under(file, sub.dir))
+                    matched.push_back(file);
+
+            if (!matched.empty())
+                task::run([fn = sub.fn, matched = std::move(matched)] { fn(matched); });
+        }
+    }
+}
+
+#if OS_WIN
+static bool watch_root(const path &dir)
+{
+    HANDLE handle = CreateFileW(dir.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    std::thread([handle, dir]
+    {
+        alignas(DWORD) static thread_local uint8_t buffer[64 * 1024];
+        DWORD bytes;
+
+        while (ReadDirectoryChangesW(handle, buffer, sizeof(buffer), TRUE,
+            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME
+            | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_CREATION,
+            &bytes, NULL, NULL))
+        {
+            // Overflow, anything may have changed.
+            if (bytes == 0)
+            {
+                notify(dir);
+                continue;
+            }
+
+            auto info = reinterpret_cast<FILE_NOTIFY_INFORMATION *>(buffer);
+            while (true)
+            {
+                notify(dir / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+                if (info->NextEntryOffset == 0)
+                    break;
+                info = reinterpret_cast<FILE_NOTIFY_INFORMATION *>(reinterpret_cast<uint8_t *>(info) + info->NextEntryOffset);
+            }
+        }
+
+        CloseHandle(handle);
+    }).detach();
+
+    return true;
+}
+#elif OS_MAC
+static void fsevents_callback(ConstFSEventStreamRef stream, void *info, size_t count,
+    void *paths, const FSEventStreamEventFlags flags[], const FSEventStreamEventId ids[])
+{
+    auto list = static_cast<char **>(paths);
+    for (size_t i = 0; i < count; i++)
+        notify(path(list[i]));
+}
+
+static bool watch_root(const path &dir)
+{
+    static dispatch_queue_t queue = dispatch_queue_create("pengu.watcher", DISPATCH_QUEUE_SERIAL);
+
+    CFStringRef str = CFStringCreateWithCString(NULL, dir.c_str(), kCFStringEncodingUTF8);
+    CFArrayRef paths = CFArrayCreate(NULL, (const void **)&str, 1, &kCFTypeArrayCallBacks);
+
+    auto stream = FSEventStreamCreate(NULL, fsevents_callback, NULL, paths, kFSEventStreamEventIdSinceNow,
+        0.05, kFSEventStreamCreateFlagFileEvents | kFSEventStreamCreateFlagNoDefer);
+
+    CFRelease(paths);
+    CFRelease(str);
+
+    if (stream == NULL)
+        return false;
+
+    FSEventStreamSetDispatchQueue(stream, queue);
+    return FSEventStreamStart(stream);
+}
+#elif OS_LINUX
+static constexpr uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE
+    | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF;
+
+static int inotify_fd_ = -1;
+static std::mutex watch_mutex_;
+static std::unordered_map<int, path> watches_;
+
+// inotify isn't recursive, every dir has its own watch.
+static void add_watches(const path &dir)
+{
+    int wd = inotify_add_watch(inotify_fd_, dir.c_str(), WATCH_MASK);
+    if (wd < 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        watches_[wd] = dir;
+    }
+
+    std::error_code ec;
+    for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+    {
+        if (it->is_directory(ec) && !it->is_symlink(ec) && it->path().filename().c_str()[0] != '.')
+            add_watches(it->path());
+    }
+}
+
+static void inotify_loop()
+{
+    alignas(struct inotify_event) static char buffer[16 * 1024];
+
+    while (true)
+    {
+        ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            if (length < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (char *ptr = buffer; ptr < buffer + length; )
+        {
+            auto event = reinterpret_cast<struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            // Overflow, anything may have changed.
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                std::vector<path> roots;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    roots = roots_;
+                }
+                for (const auto &root : roots)
+                    notify(root);
+                continue;
+            }
+
+            path dir;
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex_);
+                auto it = watches_.find(event->wd);
+                if (it == watches_.end())
+                    continue;
+
+                dir = it->second;
+                if (event->mask & IN_IGNORED)
+                {
+                    watches_.erase(it);
+                    continue;
+                }
+            }
+
+            path file = event->len > 0 ? dir / event->name : dir;
+
+            // Files created in a new dir before its watch are covered by the dir.
+            if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+                add_watches(file);
+
+            notify(file);
+        }
+    }
+}
+
+static bool watch_root(const path &dir)
+{
+    static std::once_flag once;
+    std::call_once(once, []
+    {
+        inotify_fd_ = inotify_init1(IN_CLOEXEC);
+        if (inotify_fd_ >= 0)
+            std::thread(inotify_loop).detach();
+    });
+
+    if (inotify_fd_ < 0)
+        return false;
+
+    add_watches(dir);
+    return true;
+}
+#endif
+
+int watcher::subscribe(const path &dir, callback fn)
+{
+    auto root = dir.lexically_normal();
+    if (!file::is_dir(root))
+        return 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    bool covered = std::any_of(roots_.begin(), roots_.end(),
+        [&root](const path &r) { return is_under(root, r); });
+
+    if (!covered)
+    {
+        if (!watch_root(root))
+            return 0;
+        roots_.push_back(root);
+    }
+
+    if (!started_)
+    {
+        std::thread(dispatch_loop).detach();
+        started_ = true;
+    }
+
+    int id = next_id_++;
+    subscriptions_.push_back(Subscription{ id, root, std::move(fn) });
+    return id;
+}
+
+void watcher::unsubscribe(int id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::erase_if(subscriptions_, [id](const Subscription &sub) { return sub.id == id; });
+}
@@ -55,6 +55,12 @@ export const TabClient: Component = () => {
           checked={client.silent_mode()}
           onChange={client.silent_mode}
         />
+        <CheckOption
+          caption="Startup Bundle"
+          message="Link enabled plugins into one script to load them faster, it's rebuilt after your plugins change."
+          checked={client.startup_bundle()}
+          onChange={client.startup_bundle}
+        />
       </OptionSet>
 
       <OptionSet name="Developer">
@@ -20,6 +20,7 @@ const defaultConfig = {
     use_devtools: false,
     use_riotclient: false,
     use_proxy: false,
+    startup_bundle: false,
   }
 }
 
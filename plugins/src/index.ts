@@ -1,2 +0,0 @@
-import './preload';
-import './views';
\ No newline at end of file
@@ -0,0 +1,106 @@
+import { native } from './native';
+
+// Indexed document stores, backed by native append-only logs. Native calls
+// are sync and bounded to one page, the async API lets plugins page through
+// big stores between other tasks.
+
+type IndexValue = string | number;
+
+interface QueryOptions {
+  gt?: IndexValue;
+  gte?: IndexValue;
+  lt?: IndexValue;
+  lte?: IndexValue;
+  reverse?: boolean;
+  limit?: number;
+}
+
+const PAGE_SIZE = 100;
+
+function checkKey(key: string) {
+  if (typeof key !== 'string' || !key) {
+    throw new TypeError(`${key} is not a valid key`);
+  }
+}
+
+async function* scan(handle: number, index: string, options: QueryOptions, keysOnly: boolean) {
+  const { limit, ...range } = options;
+  let remaining = typeof limit === 'number' && limit >= 0 ? limit : Infinity;
+  let after: [IndexValue, string] | undefined;
+
+  while (remaining > 0) {
+    const pageSize = Math.min(remaining, PAGE_SIZE);
+    const page = native.DocStoreScan(handle, index, { ...range, limit: pageSize, after }, keysOnly);
+
+    for (const [value, key, doc] of page) {
+      yield { key, value, doc: keysOnly ? undefined : JSON.parse(doc!) };
+    }
+
+    if (page.length < pageSize) {
+      break;
+    }
+
+    remaining -= page.length;
+    after = page[page.length - 1].slice(0, 2) as [IndexValue, string];
+  }
+}
+
+function createStore(name: string, handle: number): DocumentStore {
+  return {
+    name,
+
+    async put(key, doc) {
+      checkKey(key);
+      const json = JSON.stringify(doc);
+      if (json === undefined) {
+        throw new TypeError(`${doc} is not a JSON value`);
+      }
+      return native.DocStorePut(handle, key, json);
+    },
+
+    async get(key) {
+      const doc = native.DocStoreGet(handle, String(key));
+      return doc === null ? undefined : JSON.parse(doc);
+    },
+
+    async delete(key) {
+      return native.DocStoreDelete(handle, String(key));
+    },
+
+    async createIndex(field) {
+      if (typeof field !== 'string' || !field) {
+        throw new TypeError(`${field} is not a valid field`);
+      }
+      return native.DocStoreCreateIndex(handle, field);
+    },
+
+    async count() {
+      return native.DocStoreCount(handle);
+    },
+
+    query(index, options) {
+      return scan(handle, index ?? '', options ?? {}, false);
+    },
+
+    keys(index, options) {
+      return scan(handle, index ?? '', options ?? {}, true);
+    },
+
+    close() {
+      native.DocStoreClose(handle);
+    },
+  };
+}
+
+window.DocStore = {
+  async open(name) {
+    // One handle per open, the store is shared by all of them.
+    const handle = native.DocStoreOpen(String(name));
+    if (handle === 0) {
+      throw new Error(`failed to open document store "${name}", it may be in use by another process`);
+    }
+    return createStore(String(name), handle);
+  },
+};
+
+export { }
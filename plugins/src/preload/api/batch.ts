@@ -0,0 +1,74 @@
+// Many small LCU/Riot Client requests in one, they run concurrently in the
+// browser process and results are streamed back as NDJSON lines.
+
+interface BatchRequest {
+  method?: string;
+  uri: string;
+}
+
+interface BatchResult {
+  id: number;
+  status: number;
+  body: string;
+}
+
+const BATCH_URL = 'https://plugins/@/batch';
+const MAX_ITEMS = 64;
+
+async function sendBatch(requests: BatchRequest[], offset: number, results: Response[], onResponse?: (response: Response, index: number) => void) {
+  const res = await fetch(BATCH_URL, {
+    method: 'POST',
+    body: JSON.stringify(requests.map(({ method, uri }) => ({ method: method ?? 'GET', uri: String(uri) }))),
+  });
+
+  if (!res.ok || res.body === null) {
+    throw new Error(`batch request failed: ${res.status}`);
+  }
+
+  const reader = res.body.pipeThrough(new TextDecoderStream()).getReader();
+  let buffer = '';
+
+  function handleLine(line: string) {
+    const { id, status, body }: BatchResult = JSON.parse(line);
+    // Network errors have no status, like a failed fetch.
+    const nullBody = status === 204 || status === 205 || status === 304;
+    const response = status >= 200 && status <= 599
+      ? new Response(nullBody ? null : body, { status })
+      : Response.error();
+    results[offset + id] = response;
+    onResponse?.(response, offset + id);
+  }
+
+  while (true) {
+    const { done, value } = await reader.read();
+    if (done) {
+      break;
+    }
+
+    buffer += value;
+    let end: number;
+    while ((end = buffer.indexOf('\n')) >= 0) {
+      handleLine(buffer.substring(0, end));
+      buffer = buffer.substring(end + 1);
+    }
+  }
+}
+
+window.Pengu.batch = async function (requests, onResponse) {
+  if (!Array.isArray(requests)) {
+    throw new TypeError(`${requests} is not an array`);
+  }
+
+  const results = new Array<Response>(requests.length);
+
+  // Chunked by the endpoint limit, results keep the request order.
+  const chunks: Promise<void>[] = [];
+  for (let start = 0; start < requests.length; start += MAX_ITEMS) {
+    chunks.push(sendBatch(requests.slice(start, start + MAX_ITEMS), start, results, onResponse));
+  }
+
+  await Promise.all(chunks);
+  return results;
+};
+
+export { }
@@ -1,7 +1,10 @@
 import { native } from './native';
 
 import './DataStore';
+import './DocStore';
 import './Effect';
+import './scheduler';
+import './batch';
 
 window.openDevTools = function () {
   native.OpenDevTools();
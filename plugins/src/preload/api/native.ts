@@ -8,10 +8,29 @@ interface Native {
   OpenDevTools: () => void;
   OpenPluginsFolder: (path?: string) => boolean;
   ReloadClient: () => void;
+  GetTime: () => number;
 
   SetWindowTheme: (dark: boolean) => void;
   SetWindowVibrancy: (kind: number | null, state?: number) => void;
 
   LoadDataStore: () => string;
   SaveDataStore: (data: string) => void;
+
+  DocStoreOpen: (name: string) => number;
+  DocStoreClose: (handle: number) => void;
+  DocStorePut: (handle: number, key: string, doc: string) => boolean;
+  DocStoreGet: (handle: number, key: string) => string | null;
+  DocStoreDelete: (handle: number, key: string) => boolean;
+  DocStoreCreateIndex: (handle: number, field: string) => boolean;
+  DocStoreScan: (handle: number, field: string, options: object, keysOnly: boolean) => [string | number, string, string?][];
+  DocStoreCount: (handle: number) => number;
+
+  BeginEventRecord: () => boolean;
+  RecordEvent: (message: string) => void;
+  EndEventRecord: () => void;
+
+  CreateSearchIndex: (name: string) => void;
+  SearchIndexSet: (name: string, id: number, text: string) => void;
+  SearchIndexRemove: (name: string, id: number) => void;
+  SearchIndexQuery: (name: string, query: string, limit?: number) => number[];
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+import { native } from './native';
+
+// Plugin tasks are queued by priority and run in slices, each slice ends
+// before it takes a frame from rendering. Background tasks wait while
+// the client itself is busy: long tasks on the main thread or a burst
+// of LCU events, e.g. entering champ select.
+
+type Priority = 'user-blocking' | 'normal' | 'background';
+
+interface Task {
+  callback: () => any;
+  resolve: (value: any) => void;
+  reject: (reason: any) => void;
+  signal?: AbortSignal;
+  queued: number;
+}
+
+const SLICE_MS = 8;           // of a 16.7ms frame
+const BUSY_MS = 500;          // quiet time after the client was busy
+const MAX_DEFER_MS = 10000;   // background tasks run late, never starve
+const EVENT_BURST = 20;       // LCU events within BUSY_MS
+
+const PRIORITIES: Priority[] = ['user-blocking', 'normal', 'background'];
+const queues: Record<Priority, Task[]> = {
+  'user-blocking': [],
+  'normal': [],
+  'background': [],
+};
+
+const now: () => number = typeof native.GetTime === 'function'
+  ? native.GetTime : () => performance.now();
+
+let busyUntil = 0;
+let eventCount = 0;
+let eventWindow = 0;
+let scheduled = false;
+let deferTimer = 0;
+
+const channel = new MessageChannel();
+channel.port1.onmessage = runSlice;
+
+function markBusy() {
+  busyUntil = Math.max(busyUntil, now() + BUSY_MS);
+}
+
+// Called for each message from the LCU socket.
+export function noteClientEvent() {
+  const time = now();
+  if (time - eventWindow > BUSY_MS) {
+    eventWindow = time;
+    eventCount = 0;
+  }
+  if (++eventCount >= EVENT_BURST) {
+    markBusy();
+  }
+}
+
+try {
+  new PerformanceObserver(() => markBusy())
+    .observe({ type: 'longtask', buffered: false });
+} catch {
+  // unsupported, LCU events only
+}
+
+function isBusy() {
+  return now() < busyUntil;
+}
+
+// The first task that may run now.
+function nextTask(time: number): Task | undefined {
+  for (const priority of PRIORITIES) {
+    const queue = queues[priority];
+    if (queue.length === 0) {
+      continue;
+    }
+    if (priority === 'background' && time < busyUntil
+      && time - queue[0].queued < MAX_DEFER_MS) {
+      continue;
+    }
+    return queue.shift();
+  }
+}
+
+function schedule() {
+  if (!scheduled) {
+    scheduled = true;
+    channel.port2.postMessage(null);
+  }
+}
+
+// Wake up for deferred background tasks once the client is quiet.
+function scheduleDeferred() {
+  const queue = queues['background'];
+  if (queue.length === 0 || deferTimer) {
+    return;
+  }
+  const time = now();
+  const delay = Math.min(busyUntil, queue[0].queued + MAX_DEFER_MS) - time;
+  deferTimer = window.setTimeout(() => {
+    deferTimer = 0;
+    schedule();
+  }, Math.max(delay, 0));
+}
+
+function runSlice() {
+  scheduled = false;
+  const deadline = now() + SLICE_MS;
+
+  let task: Task | undefined;
+  while ((task = nextTask(now())) !== undefined) {
+    if (!task.signal?.aborted) {
+      try {
+        task.resolve(task.callback());
+      } catch (err) {
+        task.reject(err);
+      }
+    }
+    if (now() >= deadline) {
+      break;
+    }
+  }
+
+  // More to run after the browser had a chance to render.
+  if (queues['user-blocking'].length > 0 || queues['normal'].length > 0
+    || (queues['background'].length > 0 && !isBusy())) {
+    schedule();
+  } else {
+    scheduleDeferred();
+  }
+}
+
+function postTask<T>(callback: () => T | Promise<T>, options?: { priority?: Priority, signal?: AbortSignal }): Promise<T> {
+  return new Promise((resolve, reject) => {
+    if (typeof callback !== 'function') {
+      return reject(new TypeError('callback is not a function'));
+    }
+
+    const priority = options?.priority ?? 'normal';
+    if (!PRIORITIES.includes(priority)) {
+      return reject(new TypeError(`invalid priority '${priority}'`));
+    }
+
+    const signal = options?.signal;
+    if (signal?.aborted) {
+      return reject(signal.reason);
+    }
+
+    const task: Task = { callback, resolve, reject, signal, queued: now() };
+    queues[priority].push(task);
+
+    signal?.addEventListener('abort', () => {
+      const queue = queues[priority];
+      const index = queue.indexOf(task);
+      if (index >= 0) {
+        queue.splice(index, 1);
+        reject(signal.reason);
+      }
+    }, { once: true });
+
+    schedule();
+  });
+}
+
+window.Pengu.scheduler = {
+  postTask,
+  yield(priority: Priority = 'normal') {
+    return postTask(() => { }, { priority });
+  },
+  isBusy,
+  now,
+};
@@ -0,0 +1,78 @@
+// Main-thread time of each plugin is measured on every launch: the sync
+// part of init() and its load handler. Plugins over budget in two launches
+// in a row are demoted, they load as background tasks after the page
+// until they're back under budget.
+
+interface Usage {
+  init: number    // ms, averaged across launches
+  load: number
+  over: number    // launches in a row over budget
+}
+
+// Reserved, not a plugin key.
+const KEY = '@pengu/plugin-budgets'
+
+const INIT_BUDGET_MS = 50
+const LOAD_BUDGET_MS = 50
+const DEMOTE_AFTER = 2
+
+const { now } = window.Pengu.scheduler
+
+const saved: Record<string, Usage> = (() => {
+  const value = window.DataStore.get(KEY)
+  return value && typeof value === 'object' ? value : {}
+})()
+
+const session = new Map<string, { init: number, load: number }>()
+
+function measured(entry: string) {
+  let usage = session.get(entry)
+  if (usage === undefined) {
+    session.set(entry, usage = { init: 0, load: 0 })
+  }
+  return usage
+}
+
+export function isDemoted(entry: string) {
+  return (saved[entry]?.over ?? 0) >= DEMOTE_AFTER
+}
+
+// The sync part of a call, awaited parts run as other tasks.
+export function measure<T>(entry: string, stage: 'init' | 'load', fn: () => T): T {
+  const start = now()
+  try {
+    return fn()
+  } finally {
+    measured(entry)[stage] += now() - start
+  }
+}
+
+// Called once all plugins have loaded, the usage is saved for the next launch.
+export function commitUsage() {
+  const usages: Record<string, Usage> = {}
+  const demoted: string[] = []
+
+  for (const [entry, usage] of session) {
+    const last = saved[entry]
+    const init = last ? (last.init + usage.init) / 2 : usage.init
+    const load = last ? (last.load + usage.load) / 2 : usage.load
+
+    const over = usage.init > INIT_BUDGET_MS || usage.load > LOAD_BUDGET_MS
+      ? (last?.over ?? 0) + 1 : 0
+
+    if (over === DEMOTE_AFTER) {
+      demoted.push(entry)
+    }
+    usages[entry] = { init, load, over }
+  }
+
+  // Removed plugins are dropped.
+  window.DataStore.set(KEY, usages)
+
+  for (const entry of demoted) {
+    const { init, load } = usages[entry]
+    const msg = `Plugin "${entry}" is slowing down the client (${Math.round(init + load)}ms), it will be loaded later from now on.`
+    console.warn('%c Pengu ', 'background: #183461; color: #fff', msg)
+    window.Toast.error(msg)
+  }
+}
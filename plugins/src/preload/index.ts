@@ -2,6 +2,7 @@ import './api';
 import './polyfills';
 import './super-potato';
 import './load-hooks';
+import './views';
 import './loader';
 import { version } from '../../package.json'
 
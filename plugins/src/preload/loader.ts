@@ -1,7 +1,20 @@
 import { rcp, socket } from './rcp';
+import { commitUsage, isDemoted, measure } from './budget';
 
 const plugins = window.Pengu.plugins
 
+// Prerequisites of each plugin from their manifests, plugins are listed after them.
+const dependencies = new Map<string, string[]>()
+
+if ('pluginDependencies' in window.Pengu) {
+  const lists = window.Pengu.pluginDependencies as number[][]
+  delete window.Pengu.pluginDependencies
+
+  plugins.forEach((entry, index) => {
+    dependencies.set(entry, (lists[index] ?? []).map(dep => plugins[dep]))
+  })
+}
+
 if ('disabledPlugins' in window.Pengu) {
   const blacklist = new Set<number>
   const disabled = String(window.Pengu.disabledPlugins)
@@ -37,12 +50,38 @@ if ('disabledPlugins' in window.Pengu) {
   }
 }
 
-async function loadPlugin(entry: string) {
+interface StartupBundle {
+  load(entry: string): Promise<Plugin> | null
+}
+
+// Linked plugins are loaded from the bundle, the others per-module.
+async function loadBundle(): Promise<StartupBundle | null> {
+  if (!('startupBundle' in window.Pengu)) {
+    return null
+  }
+
+  const enabled = Boolean(window.Pengu.startupBundle)
+  delete window.Pengu.startupBundle
+
+  if (!enabled) {
+    return null
+  }
+
+  try {
+    const url = 'https://plugins/@/bundle.js'
+    return await import(url)
+  } catch {
+    // Not built yet or out of date, it's rebuilt in the background.
+    return null
+  }
+}
+
+async function loadPlugin(entry: string, bundle: StartupBundle | null) {
   let stage = 'load';
   try {
     // Acquire plugin
     const url = `https://plugins/${entry}`;
-    const plugin: Plugin = await import(url);
+    const plugin: Plugin = await (bundle?.load(entry.replace(/\\/g, '/')) ?? import(url));
 
     // Init immediately
     if (typeof plugin.init === 'function') {
@@ -54,14 +93,21 @@ async function loadPlugin(entry: string) {
         const meta = { name: pluginName };
         initContext['meta'] = meta;
       }
-      await plugin.init(initContext);
+      await measure(entry, 'init', () => plugin.init!(initContext));
     }
 
     // Register load
-    if (typeof plugin.load === 'function') {
-      window.addEventListener('load', plugin.load);
-    } else if (typeof plugin.default === 'function') {
-      window.addEventListener('load', plugin.default);
+    const load = typeof plugin.load === 'function' ? plugin.load
+      : typeof plugin.default === 'function' ? plugin.default : null;
+
+    if (load !== null) {
+      const run = (e: Event) => measure(entry, 'load', () => load(e));
+      if (document.readyState === 'complete') {
+        // Loaded after the page, like a handler it's not awaited.
+        run(new Event('load'));
+      } else {
+        window.addEventListener('load', run);
+      }
     }
 
     const msg = `Loaded plugin "${entry}".`;
@@ -72,10 +118,41 @@ async function loadPlugin(entry: string) {
   }
 }
 
-// Load all plugins asynchronously
-const waitable = Promise.all(
-  plugins.map(loadPlugin)
-);
+function prerequisites(entry: string) {
+  return (dependencies.get(entry) ?? []).filter(dep => plugins.includes(dep))
+}
+
+// Demoted plugins are loaded once the page is idle, in the background,
+// and so are the plugins depending on them.
+const deferred = new Set<string>()
+for (const entry of plugins) {
+  if (isDemoted(entry) || prerequisites(entry).some(dep => deferred.has(dep))) {
+    deferred.add(entry)
+  }
+}
+
+const bundled = loadBundle()
+const pageLoaded = new Promise(resolve => window.addEventListener('load', resolve, { once: true }))
+
+// Load all plugins asynchronously, each one as soon as its prerequisites are initialized.
+const loaded = new Map<string, Promise<void>>()
+for (const entry of plugins) {
+  const waits = prerequisites(entry).map(dep => loaded.get(dep))
+
+  if (deferred.has(entry)) {
+    loaded.set(entry, Promise.all([bundled, pageLoaded, ...waits]).then(([bundle]) =>
+      window.Pengu.scheduler.postTask(() => loadPlugin(entry, bundle), { priority: 'background' })))
+  } else {
+    loaded.set(entry, Promise.all([bundled, ...waits]).then(([bundle]) => loadPlugin(entry, bundle)))
+  }
+}
+
+const waitable = Promise.all(plugins
+  .filter(entry => !deferred.has(entry))
+  .map(entry => loaded.get(entry)));
+
+// Load handlers run in the same event, the usage is saved after them.
+Promise.all([pageLoaded, ...loaded.values()]).then(() => setTimeout(commitUsage, 0))
 
 // Listen for the first rcp, it's also the first listener
 rcp.preInit('rcp-fe-common-libs', async function () {
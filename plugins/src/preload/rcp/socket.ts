@@ -1,4 +1,6 @@
 import { rcp } from './hooks';
+import { native } from '../api/native';
+import { noteClientEvent } from '../api/scheduler';
 
 interface EventData {
   data: any;
@@ -18,15 +20,30 @@ rcp.preInit('rcp-fe-common-libs', async function (provider) {
   const { _endpoint } = provider.context.socket;
   ws = new WebSocket(_endpoint, 'wamp');
   ws.addEventListener('open', () => {
+    if (native.BeginEventRecord()) {
+      ws.send(JSON.stringify([5, 'OnJsonApiEvent']));
+      ws.addEventListener('message', recordMessage);
+    }
     for (const e of eventQueue.splice(0, eventQueue.length)) {
       ws.send(JSON.stringify([5, e]));
     }
   });
   ws.addEventListener('message', handleMessage);
-  window.addEventListener('beforeunload', () => ws.close());
+  window.addEventListener('beforeunload', () => {
+    native.EndEventRecord();
+    ws.close();
+  });
 });
 
+// Only the catch-all topic is recorded, specific topics would duplicate it.
+function recordMessage(e: MessageEvent<string>) {
+  if (e.data.startsWith('[8,"OnJsonApiEvent",')) {
+    native.RecordEvent(e.data);
+  }
+}
+
 function handleMessage(e: MessageEvent<string>) {
+  noteClientEvent();
   const [type, endpoint, data] = JSON.parse(e.data);
   if (type === 8 && listenersMap.has(endpoint)) {
     const listeners = listenersMap.get(endpoint)!;
@@ -1,35 +1,5 @@
-const GLOBAL_STYLE = `
-*:not(.store-loading):not(.spinner):not([animated]):not(.lol-loading-screen-spinner):not(.lol-uikit-vignette-celebration-layer *), *:before, *:after {
-  transition: none !important;
-  transition-property: none !important;
-  /* animation: none !important; */
-}`;
-
-const SHADOW_STYLE = `
-*:not(.spinner):not([animated]), *:before, *:after {
-  transition: none !important;
-  transition-property: none !important;
-  /* animation: none !important; */
-}`;
-
+// Transitions are disabled natively, see core/src/renderer/styles.cc.
 function load() {
-  const style = document.createElement('style');
-  style.textContent = GLOBAL_STYLE;
-  document.body.appendChild(style);
-
-  const createElement = document.createElement;
-  document.createElement = function (name, options?) {
-    const elm = createElement.call(this, name, options);
-
-    if (elm.shadowRoot) {
-      const style = document.createElement('style');
-      style.textContent = SHADOW_STYLE;
-      elm.shadowRoot.appendChild(style);
-    }
-
-    return elm;
-  };
-
   fetch('/lol-settings/v1/local/lol-user-experience', {
     method: 'PATCH',
     headers: {
@@ -0,0 +1,43 @@
+import { native } from './api/native'
+
+// The UI (CommandBar, Toaster, Welcome) is a separate chunk,
+// it's loaded after the page or when a plugin first uses its API.
+
+let views: Promise<unknown> | undefined
+
+function loadViews() {
+  return views ??= import(/* @vite-ignore */ __VIEWS_URL__)
+}
+
+function lazy(name: 'Toast' | 'CommandBar', methods: string[]) {
+  const stub = {}
+  for (const method of methods) {
+    stub[method] = function (...args: any[]) {
+      return loadViews().then(() => {
+        // The chunk replaces the stub with the real API.
+        if (window[name] !== stub) {
+          return window[name][method](...args)
+        }
+      })
+    }
+  }
+  window[name] = stub as any
+}
+
+// The chunk can't reach the natives, it takes the search once loaded.
+Object.defineProperty(window, '__search', {
+  configurable: true,
+  value: {
+    create: native.CreateSearchIndex,
+    set: native.SearchIndexSet,
+    remove: native.SearchIndexRemove,
+    query: native.SearchIndexQuery,
+  } satisfies NativeSearch
+})
+
+lazy('Toast', ['success', 'error', 'promise'])
+lazy('CommandBar', ['addAction', 'show', 'update'])
+
+window.addEventListener('load', loadViews)
+
+export { }
@@ -1,11 +1,21 @@
 // internal types
 
+declare const __VIEWS_URL__: string
+
 interface Plugin {
   init?: (context: PluginContext) => any
-  load?: () => any
+  load?: (event: Event) => any
   default?: Function | any
 }
 
+// Native fuzzy search, handed to the views chunk.
+interface NativeSearch {
+  create: (name: string) => void
+  set: (name: string, id: number, text: string) => void
+  remove: (name: string, id: number) => void
+  query: (name: string, query: string, limit?: number) => number[]
+}
+
 interface RcpAnnouceEvent extends CustomEvent {
   errorHandler: () => any
   registrationHandler: (registrar: (e) => Promise<any>) => Promise<any> | void
@@ -202,6 +212,114 @@ interface DataStore {
   remove: (key: string) => boolean
 }
 
+type DocIndexValue = string | number
+
+interface DocQueryOptions {
+  gt?: DocIndexValue
+  gte?: DocIndexValue
+  lt?: DocIndexValue
+  lte?: DocIndexValue
+  reverse?: boolean
+  limit?: number
+}
+
+interface DocQueryResult {
+  key: string
+  // the indexed field, or the key
+  value: DocIndexValue
+  doc: any
+}
+
+interface DocumentStore {
+  name: string
+
+  /**
+   * Insert or replace a document, it must be JSON serializable.
+   * 
+   * @since v1.2.0
+   */
+  put: (key: string, doc: any) => Promise<boolean>
+
+  /**
+   * Get a document, `undefined` if not found.
+   * 
+   * @since v1.2.0
+   */
+  get: (key: string) => Promise<any>
+
+  /**
+   * Delete a document.
+   * 
+   * @since v1.2.0
+   */
+  delete: (key: string) => Promise<boolean>
+
+  /**
+   * Index a string or number field, nested fields are dotted, e.g `stats.kills`.
+   * Indexes are kept with the store, creating an existing index does nothing.
+   * 
+   * @since v1.2.0
+   */
+  createIndex: (field: string) => Promise<boolean>
+
+  /**
+   * The number of documents.
+   * 
+   * @since v1.2.0
+   */
+  count: () => Promise<number>
+
+  /**
+   * Iterate documents in order of an indexed field, or of their keys
+   * if no index is given. Numbers sort before strings, documents
+   * without the field are skipped.
+   * 
+   * @since v1.2.0
+   * @example
+   * ```js
+   * for await (const { key, doc } of store.query('champion', { gte: 'Lux', lte: 'Lux', limit: 20 })) {
+   *   console.log(key, doc.stats)
+   * }
+   * ```
+   */
+  query: (index?: string, options?: DocQueryOptions) => AsyncIterableIterator<DocQueryResult>
+
+  /**
+   * Like `query()` without reading the documents.
+   * 
+   * @since v1.2.0
+   */
+  keys: (index?: string, options?: DocQueryOptions) => AsyncIterableIterator<DocQueryResult>
+
+  /**
+   * Close this opened store, other opens of it stay usable.
+   * It's also closed when the page is unloaded.
+   * 
+   * @since v1.2.0
+   */
+  close: () => void
+}
+
+interface DocStore {
+  /**
+   * Open or create a document store for large plugin data, e.g match history.
+   * Documents stay on disk, only keys and indexes are kept in memory.
+   * It's rejected if another process has the store open.
+   * 
+   * ### Params
+   * - `name` - The store name, can be a path like `my-plugin/matches`.
+   * 
+   * @since v1.2.0
+   * @example
+   * ```js
+   * const store = await DocStore.open('my-plugin/matches')
+   * await store.createIndex('champion')
+   * await store.put(String(match.gameId), match)
+   * ```
+   */
+  open: (name: string) => Promise<DocumentStore>
+}
+
 interface ApplyEffectFn {
   (type: 'transparent' | 'blurbehind' | 'acrylic' | 'unified', options?: { color: string }): void
   (type: 'mica', options?: { material?: 'auto' | 'mica' | 'acrylic' | 'tabbed' }): void
@@ -312,6 +430,78 @@ interface Pengu {
    * ```
    */
   isMac: boolean
+
+  /**
+   * A cooperative scheduler for plugin work. Tasks run by priority in short
+   * slices between frames, background tasks are deferred while the client
+   * is busy (e.g. entering champ select).
+   * 
+   * @since v1.2.0
+   * @example
+   * ```js
+   * await Pengu.scheduler.postTask(() => patchDom(), { priority: 'user-blocking' })
+   * 
+   * for (const item of items) {
+   *   process(item)
+   *   await Pengu.scheduler.yield('background')
+   * }
+   * ```
+   */
+  scheduler: PenguScheduler
+
+  /**
+   * Send many LCU or Riot Client requests in one. They run concurrently in
+   * the browser process and each result is handed back as soon as it's done.
+   * 
+   * ### Params
+   * - `requests` - Objects with a `uri`, relative for the LCU or `https://riotclient/...`,
+   *   and an optional `method` (`GET` by default).
+   * - `onResponse` - Called with each response as it arrives, in completion order.
+   * 
+   * Resolves with the responses in request order.
+   * 
+   * @since v1.2.0
+   * @example
+   * ```js
+   * const [summoner, region] = await Pengu.batch([
+   *   { uri: '/lol-summoner/v1/current-summoner' },
+   *   { uri: 'https://riotclient/riotclient/region-locale' },
+   * ])
+   * console.log(await summoner.json())
+   * ```
+   */
+  batch: (requests: { method?: string, uri: string }[],
+    onResponse?: (response: Response, index: number) => void) => Promise<Response[]>
+}
+
+type TaskPriority = 'user-blocking' | 'normal' | 'background'
+
+interface PenguScheduler {
+  /**
+   * Queue a task, the returned promise settles with its result.
+   * Async callbacks are only sliced up to their first `await`.
+   * 
+   * ### Params
+   * - `callback` - The task function.
+   * - `options.priority` - `'user-blocking'`, `'normal'` (default) or `'background'`.
+   * - `options.signal` - Abort the task while it's still queued.
+   */
+  postTask: <T>(callback: () => T | Promise<T>, options?: { priority?: TaskPriority, signal?: AbortSignal }) => Promise<T>
+
+  /**
+   * Resolves in a later slice, call it between chunks of a long loop.
+   */
+  yield: (priority?: TaskPriority) => Promise<void>
+
+  /**
+   * Whether the client is busy, background tasks are deferred meanwhile.
+   */
+  isBusy: () => boolean
+
+  /**
+   * Monotonic time in milliseconds, with the native clock.
+   */
+  now: () => number
 }
 
 interface Rcp {
@@ -594,6 +784,7 @@ interface PluginFS {
 declare interface Window {
 
   DataStore: DataStore;
+  DocStore: DocStore;
   CommandBar: CommandBar;
   Toast: Toast;
   Effect: Effect;
@@ -1,41 +1,28 @@
 import { For, Show, createEffect, createMemo, on, onCleanup, onMount } from 'solid-js';
-import Fuse from 'fuse.js';
 import { useRoot, VisualState } from './root';
 import { SearchItem } from './SearchItem';
+import { actionSearch } from './search';
 import { evaluate } from './utils';
 
-function evalAction(action: Action, path: string | string[]): string {
-  if (Array.isArray(path))
-    path = path[0];
-  if (path === 'name' || path === 'group')
-    return evaluate(action[path]);
-  else
-    return action[path as string];
-}
-
 export function SearchResults() {
 
   let containerRef: HTMLDivElement;
   const { search, actions, activeIndex, setActiveIndex, setVisualState, hidden } = useRoot();
 
+  // Indexed when the actions change, not on every keystroke.
+  const indexedActions = createMemo(() => {
+    const list = actions();
+    actionSearch.update(list);
+    return list;
+  }, undefined, { equals: false });
+
   const filteredItems = createMemo(() => {
     if (search().length === 0) {
       return actions()
         .filter(item => !item.hidden);
     }
 
-    const fuse = new Fuse(actions(), {
-      distance: 200,
-      threshold: 0.4,
-      includeScore: true,
-      keys: ['name', 'tags', 'group'],
-      getFn: evalAction
-    });
-
-    return fuse.search(search())
-      .filter(item => !item.item.hidden || (item.item.hidden && item.score! > 0))
-      .sort((a, b) => b.score! - a.score!)
-      .map(item => item.item);
+    return actionSearch.query(indexedActions(), search());
   });
 
   function shouldShowCategory(item: Action, index: number) {
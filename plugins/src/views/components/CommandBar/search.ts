@@ -0,0 +1,77 @@
+import Fuse from 'fuse.js';
+import { evaluate } from './utils';
+
+// @ts-ignore
+const native: NativeSearch | undefined = window.__search;
+// @ts-ignore
+delete window.__search;
+
+const INDEX_NAME = 'commandbar';
+const MAX_RESULTS = 100;
+
+function evalAction(action: Action, path: string | string[]): string {
+  if (Array.isArray(path))
+    path = path[0];
+  if (path === 'name' || path === 'group')
+    return evaluate(action[path]);
+  else
+    return action[path as string];
+}
+
+function getSearchText(action: Action) {
+  return [evaluate(action.name), action.tags?.join(' ') ?? '', evaluate(action.group)].join('\n');
+}
+
+// Native index, only changed items are sent again.
+function createNativeSearch(search: NativeSearch) {
+  let texts: string[] = [];
+  search.create(INDEX_NAME);
+
+  function update(actions: Action[]) {
+    for (let i = 0; i < actions.length; i++) {
+      const text = getSearchText(actions[i]);
+      if (texts[i] !== text) {
+        search.set(INDEX_NAME, i, text);
+        texts[i] = text;
+      }
+    }
+    for (let i = actions.length; i < texts.length; i++) {
+      search.remove(INDEX_NAME, i);
+    }
+    texts.length = actions.length;
+  }
+
+  function query(actions: Action[], query: string) {
+    return search.query(INDEX_NAME, query, MAX_RESULTS)
+      .map(id => actions[id])
+      .filter(Boolean);
+  }
+
+  return { update, query };
+}
+
+// In the browser dev server.
+function createFuseSearch() {
+  let fuse: Fuse<Action> | undefined;
+
+  function update(actions: Action[]) {
+    fuse = new Fuse(actions, {
+      distance: 200,
+      threshold: 0.4,
+      includeScore: true,
+      keys: ['name', 'tags', 'group'],
+      getFn: evalAction
+    });
+  }
+
+  function query(actions: Action[], query: string) {
+    return fuse!.search(query)
+      .filter(item => !item.item.hidden || (item.item.hidden && item.score! > 0))
+      .sort((a, b) => b.score! - a.score!)
+      .map(item => item.item);
+  }
+
+  return { update, query };
+}
+
+export const actionSearch = native ? createNativeSearch(native) : createFuseSearch();
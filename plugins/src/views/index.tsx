@@ -35,4 +35,10 @@ async function mount() {
 }
 
 customElements.define(rootId, PenguRoot);
-window.addEventListener('load', mount);
\ No newline at end of file
+
+// Loaded on demand by the preload, the page may be ready already.
+if (document.readyState === 'complete') {
+  mount();
+} else {
+  window.addEventListener('load', mount);
+}
\ No newline at end of file
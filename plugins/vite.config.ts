@@ -1,7 +1,7 @@
 import path from 'node:path';
 import fs from 'node:fs/promises';
 import { defineConfig } from 'vite';
-import { build } from 'esbuild';
+import { build, BuildOptions } from 'esbuild';
 
 // Vite plugins
 import mkcert from 'vite-plugin-mkcert';
@@ -30,16 +30,17 @@ export default defineConfig(({ command, mode }) => {
       assetsInlineLimit: 1024 * 64,
       minify: !dev,
       modulePreload: false,
+      // The UI chunk, the preload is built in closeBundle().
       lib: {
-        name: 'preload',
-        entry: 'src/index.ts',
-        formats: ['iife']
+        entry: 'src/views/index.tsx',
+        formats: ['es']
       },
       rollupOptions: {
         output: {
-          format: 'iife',
+          format: 'es',
           sourcemap: dev ? 'inline' : false,
-          entryFileNames: 'preload.js'
+          entryFileNames: 'views.js',
+          inlineDynamicImports: true
         }
       }
     },
@@ -68,12 +69,7 @@ export default defineConfig(({ command, mode }) => {
           return code.replace(/\/src\//g, `https://localhost:${port}/src/`)
         },
         async configResolved() {
-          await build({
-            entryPoints: [root('src/preload/index.ts')],
-            outfile: root('dist/preload.js'),
-            bundle: true,
-            format: 'iife',
-            sourcemap: 'inline',
+          await buildPreload(true, `https://localhost:${port}/src/views/index.tsx`, {
             footer: {
               'js': generateDevLoader(port)
             }
@@ -85,22 +81,42 @@ export default defineConfig(({ command, mode }) => {
         apply: 'build',
         enforce: 'post',
         async closeBundle() {
-          const code = await fs.readFile(root('dist/preload.js'), 'utf-8');
-          const header = generateHeader(code, 'preload_script');
-          await fs.writeFile(root('dist/preload.g.h'), header, 'utf-8');
+          await buildPreload(dev, 'https://plugins/@/views.js');
+
+          const preload = await fs.readFile(root('dist/preload.js'), 'utf-8');
+          await fs.writeFile(root('dist/preload.g.h'), generateHeader(preload, 'preload_script'), 'utf-8');
+
+          const views = await fs.readFile(root('dist/views.js'), 'utf-8');
+          await fs.writeFile(root('dist/views.g.h'), generateHeader(views, 'views_script'), 'utf-8');
         }
       }
     ]
   }
 });
 
+// Minimal bootstrap: APIs, RCP hooks and the plugin loader.
+// The views chunk is imported from `viewsUrl` on first use.
+function buildPreload(dev: boolean, viewsUrl: string, options: BuildOptions = {}) {
+  return build({
+    entryPoints: [root('src/preload/index.ts')],
+    outfile: root('dist/preload.js'),
+    bundle: true,
+    format: 'iife',
+    minify: !dev,
+    legalComments: 'none',
+    sourcemap: dev ? 'inline' : false,
+    define: {
+      '__VIEWS_URL__': JSON.stringify(viewsUrl)
+    },
+    ...options
+  });
+}
+
 function generateDevLoader(port: number) {
   const template = function (port) {
     document.addEventListener('DOMContentLoaded', async () => {
       // @ts-ignore
       await import(`https://localhost:${port}/@vite/client`);
-      // @ts-ignore
-      await import(`https://localhost:${port}/src/views/index.tsx`);
     });
   }
   return `!(${template.toString()})(${port});`;